@@ -0,0 +1,138 @@
+#include "src/index.hpp"
+#include "src/serializer.hpp"
+#include "src/intersection.hpp"
+#include "src/postingBitmap.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+
+/*
+Benchmark das listas de palavras densas em PostingBitmap contra as listas
+ordenadas decodificadas do arquivo.
+
+O corpus sintético tem palavras com densidades de 1/2 a 1/64 dos documentos,
+sorteadas de forma independente, e uma palavra presente em uma faixa contínua
+de documentos (contêineres de faixas). O índice é gravado e aberto como no
+comando buscar (Serializer::open). Para cada palavra, mostra a memória da
+lista decodificada e do bitmap; para cada par de palavras, o tempo de AND,
+OR e AND NOT com as listas (decodificação + PostingIntersector) e com os
+bitmaps (leitura + núcleos dos contêineres + conversão do resultado para
+IDs), conferindo que os resultados são iguais.
+
+Uso: bench/bitmapBench [documentos] [repeticoes]
+*/
+
+using namespace std;
+namespace fs = filesystem;
+
+/**
+ * Mede o tempo médio de execução de uma função em microssegundos.
+ */
+template <typename Function>
+double measure(size_t repetitions, Function function) {
+    auto start = chrono::steady_clock::now();
+    for (size_t r = 0; r < repetitions; ++r) {
+        function();
+    }
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+int main(int argc, char* argv[]) {
+    size_t documents = argc > 1 ? stoul(argv[1]) : 500000;
+    size_t repetitions = argc > 2 ? stoul(argv[2]) : 20;
+
+    // Palavras e a fração dos documentos em que aparecem
+    vector<pair<string, size_t>> words = {{"metade", 2}, {"quarto", 4}, {"oitavo", 8}, {"dezesseis", 16},
+                                          {"trinta_e_dois", 32}, {"sessenta_e_quatro", 64}};
+    mt19937_64 random(42);
+    Index built;
+    for (size_t d = 0; d < documents; ++d) {
+        int docId = built.addDocument("doc" + to_string(d) + ".txt");
+        for (const auto& [word, ratio] : words) {
+            if (random() % ratio == 0) {
+                built.addWordToDocument(word, docId);
+            }
+        }
+        if (d >= documents / 5 && d < documents / 2) {
+            built.addWordToDocument("faixa", docId);
+        }
+    }
+    words.push_back({"faixa", 0});
+    built.freeze();
+    fs::path indexFile = fs::temp_directory_path() / "bitmapBench.dat";
+    Serializer::serialize(built, indexFile.string());
+    built = Index();
+    Index index = Serializer::open(indexFile.string());
+
+    cout << fixed << setprecision(1);
+    cout << documents << " documentos\n";
+    cout << "Memória por palavra (lista decodificada / bitmap):\n";
+    for (const auto& entry : words) {
+        vector<uint32_t> scratch;
+        PostingSpan list = index.getPostings(entry.first, scratch);
+        PostingBitmap bitmap;
+        if (!index.getPostingBitmap(entry.first, bitmap)) {
+            cerr << "Erro: a palavra " << entry.first << " não tem bitmap no índice\n";
+            return 1;
+        }
+        cout << "  " << setw(18) << left << entry.first << right << setw(8) << list.size() << " docs: "
+             << setw(9) << list.size() * sizeof(uint32_t) / 1024.0 << " KiB / " << setw(8)
+             << bitmap.memoryUsage() / 1024.0 << " KiB\n";
+    }
+
+    cout << "Pares de palavras (us por operação, listas / bitmaps):\n";
+    vector<pair<string, string>> pairs = {{"metade", "quarto"}, {"quarto", "oitavo"}, {"oitavo", "dezesseis"},
+                                          {"metade", "sessenta_e_quatro"}, {"faixa", "metade"},
+                                          {"trinta_e_dois", "sessenta_e_quatro"}};
+    for (const auto& [first, second] : pairs) {
+        vector<uint32_t> firstScratch;
+        vector<uint32_t> secondScratch;
+        vector<uint32_t> expected[3];
+        vector<uint32_t> obtained[3];
+        const char* names[3] = {"AND", "OR", "AND NOT"};
+        double listMicros[3];
+        double bitmapMicros[3];
+        for (int op = 0; op < 3; ++op) {
+            listMicros[op] = measure(repetitions, [&]() {
+                PostingSpan a = index.getPostings(first, firstScratch);
+                PostingSpan b = index.getPostings(second, secondScratch);
+                vector<uint32_t>& out = expected[op];
+                out.resize(a.size() + b.size());
+                size_t count = 0;
+                if (op == 0) {
+                    count = PostingIntersector::intersect(a, b, out.data());
+                } else if (op == 1) {
+                    count = static_cast<size_t>(set_union(a.begin(), a.end(), b.begin(), b.end(), out.begin()) - out.begin());
+                } else {
+                    count = PostingIntersector::difference(a, b, out.data());
+                }
+                out.resize(count);
+            });
+            bitmapMicros[op] = measure(repetitions, [&]() {
+                PostingBitmap a;
+                PostingBitmap b;
+                index.getPostingBitmap(first, a);
+                index.getPostingBitmap(second, b);
+                PostingBitmap result = op == 0   ? PostingBitmap::intersect(a, b)
+                                       : op == 1 ? PostingBitmap::unite(a, b)
+                                                 : PostingBitmap::difference(a, b);
+                obtained[op] = result.toVector();
+            });
+            if (expected[op] != obtained[op]) {
+                cerr << "Erro: resultados diferentes em " << first << " " << names[op] << " " << second << "\n";
+                return 1;
+            }
+        }
+        cout << "  " << first << " / " << second << ":\n";
+        for (int op = 0; op < 3; ++op) {
+            cout << "    " << setw(7) << left << names[op] << right << setw(9) << listMicros[op] << " / " << setw(8)
+                 << bitmapMicros[op] << "  (" << setprecision(2) << listMicros[op] / bitmapMicros[op] << "x, "
+                 << setprecision(1) << expected[op].size() << " docs)\n";
+        }
+    }
+    fs::remove(indexFile);
+    return 0;
+}
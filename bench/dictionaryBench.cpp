@@ -0,0 +1,221 @@
+#include "src/termDictionary.hpp"
+#include "src/textProcessor.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <malloc.h>
+
+/*
+Benchmark do dicionário de termos: compara o TermDictionary (arena + Robin
+Hood, IDs uint32_t) com o layout anterior do índice, um unordered_map<string,
+uint32_t> (uma alocação por nó e outra por palavra longa).
+
+Para cada escala, mede:
+- memória do dicionário (heap alocado, pelo mallinfo2), em bytes por termo;
+- vazão da construção: cada ocorrência do texto é procurada e, se nova,
+  inserida, como no Indexer;
+- vazão da consulta: cada ocorrência do texto é procurada (acertos), mais a
+  mesma quantidade de palavras ausentes (falhas).
+
+A escala 1 é o vocabulário do corpus (data/machado). Nas demais, como no
+indexBench, uma em cada 64 ocorrências vira uma palavra rara sintética, com
+20000 palavras raras distintas por unidade de escala, e todas as palavras
+raras entram no dicionário.
+
+Uso: bench/dictionaryBench [diretorio] [escalas, ex.: 1,10,100]
+*/
+
+using namespace std;
+namespace fs = filesystem;
+
+// Uma em cada RARE_WORD_RATE ocorrências é uma palavra rara sintética
+static const unsigned RARE_WORD_RATE = 64;
+// Palavras raras distintas por unidade de escala
+static const unsigned RARE_WORDS_PER_SCALE = 20000;
+
+/**
+ * Mede o tempo de execução de uma função em segundos.
+ */
+template <typename Function>
+double measure(Function function) {
+    auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Bytes alocados no heap no momento.
+ */
+size_t heapBytes() {
+    return mallinfo2().uordblks;
+}
+
+/**
+ * Sequência de palavras guardada em um único buffer (sem uma string por
+ * ocorrência, para não pesar na memória medida).
+ */
+struct WordStream {
+    string bytes;
+    vector<uint32_t> starts;
+
+    void push(string_view word) {
+        starts.push_back(static_cast<uint32_t>(bytes.size()));
+        bytes.append(word);
+    }
+
+    size_t size() const {
+        return starts.size();
+    }
+
+    string_view operator[](size_t i) const {
+        size_t end = i + 1 < starts.size() ? starts[i + 1] : bytes.size();
+        return string_view(bytes.data() + starts[i], end - starts[i]);
+    }
+};
+
+/**
+ * Resultado de um dicionário em uma escala.
+ */
+struct Result {
+    size_t terms = 0;
+    size_t bytes = 0;
+    double buildSeconds = 0;
+    double hitSeconds = 0;
+    double missSeconds = 0;
+};
+
+/**
+ * Mede o layout anterior: unordered_map<string, uint32_t>.
+ */
+Result runMap(const WordStream& vocabulary, const WordStream& text, const WordStream& absent, size_t& sink) {
+    Result result;
+    size_t before = heapBytes();
+    auto* map = new unordered_map<string, uint32_t>();
+    result.buildSeconds = measure([&]() {
+        for (size_t i = 0; i < vocabulary.size(); ++i) {
+            map->emplace(string(vocabulary[i]), static_cast<uint32_t>(map->size()));
+        }
+        string key;
+        for (size_t i = 0; i < text.size(); ++i) {
+            key.assign(text[i]);
+            sink += map->emplace(key, static_cast<uint32_t>(map->size())).first->second;
+        }
+    });
+    result.terms = map->size();
+    result.bytes = heapBytes() - before;
+    string key;
+    result.hitSeconds = measure([&]() {
+        for (size_t i = 0; i < text.size(); ++i) {
+            key.assign(text[i]);
+            sink += map->find(key)->second;
+        }
+    });
+    result.missSeconds = measure([&]() {
+        for (size_t i = 0; i < absent.size(); ++i) {
+            key.assign(absent[i]);
+            sink += map->count(key);
+        }
+    });
+    delete map;
+    return result;
+}
+
+/**
+ * Mede o TermDictionary.
+ */
+Result runDictionary(const WordStream& vocabulary, const WordStream& text, const WordStream& absent, size_t& sink) {
+    Result result;
+    size_t before = heapBytes();
+    auto* dictionary = new TermDictionary();
+    result.buildSeconds = measure([&]() {
+        for (size_t i = 0; i < vocabulary.size(); ++i) {
+            dictionary->intern(vocabulary[i]);
+        }
+        for (size_t i = 0; i < text.size(); ++i) {
+            sink += dictionary->intern(text[i]);
+        }
+    });
+    result.terms = dictionary->size();
+    result.bytes = heapBytes() - before;
+    result.hitSeconds = measure([&]() {
+        for (size_t i = 0; i < text.size(); ++i) {
+            sink += dictionary->find(text[i]);
+        }
+    });
+    result.missSeconds = measure([&]() {
+        for (size_t i = 0; i < absent.size(); ++i) {
+            sink += dictionary->find(absent[i]) == TermDictionary::NOT_FOUND;
+        }
+    });
+    delete dictionary;
+    return result;
+}
+
+/**
+ * Escreve uma linha de resultado: builds é a quantidade de palavras
+ * procuradas ou inseridas na construção, occurrences a de cada consulta.
+ */
+void print(const string& name, const Result& result, size_t builds, size_t occurrences) {
+    double millions = occurrences / 1e6;
+    cout << "  " << name << ": " << result.terms << " termos, " << result.bytes / 1024 << " KB ("
+         << result.bytes / result.terms << " B/termo), construção " << builds / 1e6 / result.buildSeconds
+         << " M/s, acertos " << millions / result.hitSeconds << " M/s, falhas "
+         << millions / result.missSeconds << " M/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    string directory = argc > 1 ? argv[1] : "data/machado";
+    string scaleList = argc > 2 ? argv[2] : "1,10,100";
+
+    TextProcessor textProcessor;
+    WordStream corpus;
+    for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            ifstream file(entry.path(), ios::binary);
+            stringstream buffer;
+            buffer << file.rdbuf();
+            textProcessor.forEachToken(buffer.str(), [&](const string& token) { corpus.push(token); });
+        }
+    }
+    if (corpus.size() == 0) {
+        cerr << "Erro: corpus vazio: " << directory << "\n";
+        return 1;
+    }
+
+    size_t sink = 0;
+    stringstream scales(scaleList);
+    for (string item; getline(scales, item, ',');) {
+        unsigned scale = static_cast<unsigned>(stoul(item));
+        mt19937_64 random(42 + scale);
+
+        // Texto com as palavras raras, o vocabulário raro inteiro e as palavras ausentes
+        WordStream text;
+        WordStream vocabulary;
+        WordStream absent;
+        unsigned rareCount = scale > 1 ? scale * RARE_WORDS_PER_SCALE : 0;
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            if (rareCount > 0 && random() % RARE_WORD_RATE == 0) {
+                text.push("raro" + to_string(random() % rareCount));
+            } else {
+                text.push(corpus[i]);
+            }
+            absent.push(string(corpus[i]) + "xq");
+        }
+        for (unsigned r = 0; r < rareCount; ++r) {
+            vocabulary.push("raro" + to_string(r));
+        }
+
+        Result previous = runMap(vocabulary, text, absent, sink);
+        Result current = runDictionary(vocabulary, text, absent, sink);
+        cout << "Escala " << scale << " (" << text.size() << " ocorrências):\n";
+        size_t builds = vocabulary.size() + text.size();
+        print("unordered_map<string>", previous, builds, text.size());
+        print("TermDictionary       ", current, builds, text.size());
+    }
+    cout << "(checksum " << sink << ")\n";
+    return 0;
+}
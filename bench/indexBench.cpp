@@ -0,0 +1,390 @@
+#include "src/index.hpp"
+#include "src/textProcessor.hpp"
+#include "src/indexer.hpp"
+#include "src/serializer.hpp"
+#include "src/queryProcessor.hpp"
+#include "src/searchEngine.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+Benchmark dos caminhos críticos de construção, carga e consulta do índice.
+
+Para cada escala, mede:
+- vazão do tokenizador (TextProcessor::process), em MB/s;
+- tempo e pico de memória (RSS) do Indexer::indexDirectory, incluindo o freeze;
+- tempo do Serializer::serialize e do Serializer::deserialize;
+- latência (p50/p90/p99/máxima e histograma) do querySingle e do queryMultiple,
+  sobre o índice aberto como no comando buscar (Serializer::open).
+
+A escala 1 é o próprio corpus (data/machado). As demais são geradas: cada
+documento sintético tem o tamanho de um documento do corpus e é formado por
+palavras sorteadas com a mesma distribuição de frequências do corpus, mais
+uma fração de palavras raras cujo vocabulário cresce com a escala. A semente
+é fixa, então o corpus gerado é sempre o mesmo.
+
+Cada escala roda em um processo filho, para que o pico de RSS de uma não
+contamine a seguinte. O resultado é um documento JSON na saída padrão.
+
+Uso: bench/indexBench [--corpus <dir>] [--escalas 1,10,100,1000] [--temp <dir>]
+*/
+
+using namespace std;
+namespace fs = filesystem;
+
+// Quantidade de consultas de cada tipo por escala
+static const size_t QUERY_COUNT = 1000;
+// Uma em cada RARE_WORD_RATE palavras geradas é uma palavra rara sintética
+static const unsigned RARE_WORD_RATE = 64;
+// Palavras raras distintas por unidade de escala
+static const unsigned RARE_WORDS_PER_SCALE = 20000;
+
+/**
+ * Mede o tempo de execução de uma função em segundos.
+ */
+template <typename Function>
+double measure(Function function) {
+    auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Pico de memória residente do processo, em KB.
+ */
+long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * Memória residente atual do processo, em KB (0 se indisponível).
+ */
+long currentRssKb() {
+    ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * Lê o conteúdo completo de um arquivo.
+ */
+string readFile(const fs::path& path) {
+    ifstream file(path, ios::binary);
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+/**
+ * Lista os arquivos .txt de um diretório, recursivamente e em ordem.
+ */
+vector<fs::path> listTexts(const string& directory) {
+    vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            files.push_back(entry.path());
+        }
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+/**
+ * Palavras (sem normalização) e tamanhos dos documentos do corpus original,
+ * usados para gerar os corpora sintéticos e as consultas.
+ */
+struct CorpusModel {
+    vector<string> words;
+    vector<size_t> documentSizes;
+};
+
+CorpusModel loadModel(const string& directory) {
+    CorpusModel model;
+    for (const fs::path& path : listTexts(directory)) {
+        string content = readFile(path);
+        model.documentSizes.push_back(content.size());
+        istringstream tokens(content);
+        for (string word; tokens >> word;) {
+            model.words.push_back(word);
+        }
+    }
+    if (model.words.empty()) {
+        throw runtime_error("Corpus vazio: " + directory);
+    }
+    return model;
+}
+
+/**
+ * Gera o corpus sintético de uma escala em directory.
+ */
+void generateCorpus(const CorpusModel& model, unsigned scale, const fs::path& directory) {
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    mt19937_64 random(42 + scale);
+    uniform_int_distribution<size_t> pick(0, model.words.size() - 1);
+    uniform_int_distribution<unsigned> rare(0, scale * RARE_WORDS_PER_SCALE - 1);
+
+    size_t documents = model.documentSizes.size() * scale;
+    string content;
+    for (size_t d = 0; d < documents; ++d) {
+        size_t target = model.documentSizes[d % model.documentSizes.size()];
+        content.clear();
+        for (size_t w = 0; content.size() < target; ++w) {
+            if (random() % RARE_WORD_RATE == 0) {
+                content += "raro" + to_string(rare(random));
+            } else {
+                content += model.words[pick(random)];
+            }
+            content += (w % 12 == 11) ? '\n' : ' ';
+        }
+        ostringstream name;
+        name << "doc" << setw(7) << setfill('0') << d << ".txt";
+        ofstream file(directory / name.str(), ios::binary);
+        file << content;
+    }
+}
+
+/**
+ * Sorteia consultas com termos tirados do corpus (mesma distribuição de
+ * frequências), já normalizados e sem stop words.
+ */
+vector<vector<string>> sampleQueries(const CorpusModel& model, const TextProcessor& textProcessor,
+                                     size_t termsPerQuery, unsigned seed) {
+    mt19937_64 random(seed);
+    uniform_int_distribution<size_t> pick(0, model.words.size() - 1);
+    vector<vector<string>> queries;
+    while (queries.size() < QUERY_COUNT) {
+        vector<string> query;
+        while (query.size() < termsPerQuery) {
+            string term = TextProcessor::normalizeWord(model.words[pick(random)]);
+            if (!term.empty() && !textProcessor.isStopWord(term)) {
+                query.push_back(term);
+            }
+        }
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+/**
+ * Escreve em JSON a distribuição de latências (em microssegundos):
+ * percentis e histograma em faixas de potências de 2.
+ */
+void writeLatencies(ostream& out, vector<double> micros, size_t hits) {
+    sort(micros.begin(), micros.end());
+    auto percentile = [&](double p) {
+        return micros[min(micros.size() - 1, static_cast<size_t>(p * micros.size()))];
+    };
+    out << "{\"queries\": " << micros.size() << ", \"with_results\": " << hits
+        << ", \"p50_us\": " << percentile(0.50) << ", \"p90_us\": " << percentile(0.90)
+        << ", \"p99_us\": " << percentile(0.99) << ", \"max_us\": " << micros.back()
+        << ", \"histogram_us\": {";
+    size_t i = 0;
+    bool first = true;
+    for (double limit = 1; i < micros.size(); limit *= 2) {
+        size_t count = 0;
+        while (i < micros.size() && micros[i] <= limit) {
+            ++count;
+            ++i;
+        }
+        if (count > 0) {
+            out << (first ? "" : ", ") << "\"<=" << static_cast<long long>(limit) << "\": " << count;
+            first = false;
+        }
+    }
+    out << "}}";
+}
+
+/**
+ * Executa todas as medições de uma escala e escreve o objeto JSON em out.
+ */
+void runScale(unsigned scale, const string& directory, const CorpusModel& model, const string& indexFile,
+              ostream& out) {
+    TextProcessor textProcessor;
+
+    // Indexação primeiro, para que o pico de RSS seja o dela. A memória herdada
+    // do processo pai (modelo do corpus) aparece em baseline_rss_kb
+    long baselineKb = currentRssKb();
+    Index index;
+    double indexSeconds = measure([&]() {
+        Indexer indexer(index, textProcessor);
+        indexer.indexDirectory(directory);
+        index.freeze();
+    });
+    long indexPeakKb = peakRssKb();
+
+    size_t bytes = 0;
+    size_t tokens = 0;
+    double tokenizerSeconds = 0;
+    vector<fs::path> files = listTexts(directory);
+    for (const fs::path& path : files) {
+        string content = readFile(path);
+        bytes += content.size();
+        tokenizerSeconds += measure([&]() { tokens += textProcessor.process(content).size(); });
+    }
+
+    double serializeSeconds = measure([&]() { Serializer::serialize(index, indexFile); });
+    size_t words = index.getAllWords().size();
+    index = Index();
+    double deserializeSeconds = measure([&]() { Index loaded = Serializer::deserialize(indexFile); });
+
+    Index opened = Serializer::open(indexFile);
+    QueryProcessor queryProcessor(opened);
+    vector<double> singleMicros;
+    size_t singleHits = 0;
+    for (const auto& query : sampleQueries(model, textProcessor, 1, 7)) {
+        singleMicros.push_back(1e6 * measure([&]() {
+            singleHits += queryProcessor.querySingle(query[0]).empty() ? 0 : 1;
+        }));
+    }
+    vector<double> multipleMicros;
+    size_t multipleHits = 0;
+    mt19937 random(11);
+    vector<vector<string>> pairs = sampleQueries(model, textProcessor, 2, 13);
+    vector<vector<string>> triples = sampleQueries(model, textProcessor, 3, 17);
+    for (size_t i = 0; i < QUERY_COUNT; ++i) {
+        const vector<string>& query = (random() % 2 == 0) ? pairs[i] : triples[i];
+        multipleMicros.push_back(1e6 * measure([&]() {
+            multipleHits += queryProcessor.queryMultiple(query).empty() ? 0 : 1;
+        }));
+    }
+
+    double megabytes = bytes / (1024.0 * 1024.0);
+    out << fixed << setprecision(3);
+    out << "    {\"scale\": " << scale << ", \"corpus\": \"" << directory << "\", \"documents\": " << files.size()
+        << ", \"bytes\": " << bytes << ", \"tokens\": " << tokens << ", \"words\": " << words << ",\n"
+        << "     \"tokenizer_process\": {\"seconds\": " << tokenizerSeconds
+        << ", \"mb_per_s\": " << megabytes / tokenizerSeconds << "},\n"
+        << "     \"index_directory\": {\"seconds\": " << indexSeconds << ", \"peak_rss_kb\": " << indexPeakKb
+        << ", \"baseline_rss_kb\": " << baselineKb << "},\n"
+        << "     \"serialize\": {\"seconds\": " << serializeSeconds
+        << ", \"bytes\": " << fs::file_size(indexFile) << "},\n"
+        << "     \"deserialize\": {\"seconds\": " << deserializeSeconds << "},\n"
+        << "     \"query_single\": ";
+    writeLatencies(out, singleMicros, singleHits);
+    out << ",\n     \"query_multiple\": ";
+    writeLatencies(out, multipleMicros, multipleHits);
+    out << "}";
+}
+
+/**
+ * Roda uma escala em um processo filho e retorna o JSON produzido.
+ */
+string runScaleInChild(unsigned scale, const string& directory, const CorpusModel& model, const string& indexFile) {
+    int channel[2];
+    if (pipe(channel) != 0) {
+        throw runtime_error("Não foi possível criar o pipe");
+    }
+    cout.flush();
+    pid_t child = fork();
+    if (child < 0) {
+        throw runtime_error("Não foi possível criar o processo filho");
+    }
+    if (child == 0) {
+        close(channel[0]);
+        ostringstream out;
+        int status = 0;
+        try {
+            runScale(scale, directory, model, indexFile, out);
+        } catch (const exception& e) {
+            cerr << "Erro na escala " << scale << ": " << e.what() << "\n";
+            status = 1;
+        }
+        string json = out.str();
+        size_t written = 0;
+        while (written < json.size()) {
+            ssize_t n = write(channel[1], json.data() + written, json.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        _exit(status);
+    }
+
+    close(channel[1]);
+    string json;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(channel[0], buffer, sizeof(buffer))) > 0) {
+        json.append(buffer, static_cast<size_t>(n));
+    }
+    close(channel[0]);
+    int status;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw runtime_error("Falha na escala " + to_string(scale));
+    }
+    return json;
+}
+
+int main(int argc, char* argv[]) {
+    string corpus = "data/machado";
+    string scalesArgument = "1,10";
+    fs::path temporary = fs::temp_directory_path() / "indiceBench";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--corpus") {
+            corpus = argv[i + 1];
+        } else if (option == "--escalas") {
+            scalesArgument = argv[i + 1];
+        } else if (option == "--temp") {
+            temporary = argv[i + 1];
+        } else {
+            cerr << "Uso: bench/indexBench [--corpus <dir>] [--escalas 1,10,100,1000] [--temp <dir>]\n";
+            return 1;
+        }
+    }
+
+    vector<unsigned> scales;
+    istringstream list(scalesArgument);
+    for (string item; getline(list, item, ',');) {
+        unsigned scale;
+        if (!SearchEngine::parsePositive(item, scale)) {
+            cerr << "Erro: escala inválida: " << item << "\n";
+            return 1;
+        }
+        scales.push_back(scale);
+    }
+
+    try {
+        CorpusModel model = loadModel(corpus);
+        fs::create_directories(temporary);
+        string indexFile = (temporary / "index.dat").string();
+
+        cout << "{\n  \"benchmark\": \"indice\",\n  \"corpus\": \"" << corpus << "\",\n  \"results\": [\n";
+        for (size_t s = 0; s < scales.size(); ++s) {
+            string directory = corpus;
+            if (scales[s] > 1) {
+                fs::path generated = temporary / ("escala" + to_string(scales[s]));
+                cerr << "Gerando corpus sintético (escala " << scales[s] << ") em " << generated << "\n";
+                generateCorpus(model, scales[s], generated);
+                directory = generated.string();
+            }
+            cerr << "Medindo escala " << scales[s] << "\n";
+            cout << runScaleInChild(scales[s], directory, model, indexFile)
+                 << (s + 1 < scales.size() ? ",\n" : "\n");
+            if (scales[s] > 1) {
+                fs::remove_all(directory);
+            }
+        }
+        cout << "  ]\n}\n";
+        fs::remove_all(temporary);
+    } catch (const exception& e) {
+        cerr << "Erro: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "src/intersection.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+
+/*
+Benchmark da interseção de postings em pares de listas com tamanhos desiguais.
+Para cada razão entre os tamanhos, mede intercalação linear, galloping,
+comparação em blocos (SSE2) e a escolha adaptativa do PostingIntersector,
+conferindo que todos produzem o mesmo resultado.
+Em seguida, compara a união de k listas (expansão de um padrão com curingas)
+acumulada uma lista por vez (unitePairwise), unindo sempre as duas menores
+(uniteSmallestFirst) e com a intercalação de k vias de um heap (uniteKWay), de
+onde vem o limite PostingIntersector::SMALLEST_FIRST_LISTS do uniteAll.
+
+Uso: bench/intersectionBench [tamanho_da_lista_maior] [repeticoes]
+*/
+
+using namespace std;
+
+/**
+ * Gera uma lista ordenada, sem repetições, com count IDs em [1, universe].
+ */
+vector<uint32_t> randomPostings(size_t count, uint32_t universe, mt19937& rng) {
+    vector<uint32_t> ids;
+    ids.reserve(count + count / 8);
+    uniform_int_distribution<uint32_t> distribution(1, universe);
+    while (ids.size() < count) {
+        size_t missing = count - ids.size();
+        for (size_t i = 0; i < missing + missing / 8 + 16; ++i) {
+            ids.push_back(distribution(rng));
+        }
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    }
+    shuffle(ids.begin(), ids.end(), rng);
+    ids.resize(count);
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+/**
+ * Mede o tempo médio (em microssegundos) de uma interseção.
+ */
+template <typename Function>
+double measure(int repetitions, Function function) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        function();
+    }
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+int main(int argc, char* argv[]) {
+    size_t largeSize = argc > 1 ? stoul(argv[1]) : 1000000;
+    int repetitions = argc > 2 ? stoi(argv[2]) : 20;
+    uint32_t universe = static_cast<uint32_t>(largeSize * 4);
+    mt19937 rng(42);
+
+    vector<uint32_t> large = randomPostings(largeSize, universe, rng);
+    vector<uint32_t> output(largeSize);
+
+#ifdef __SSE2__
+    const char* blocks = "blocos SSE2";
+#else
+    const char* blocks = "blocos (escalar)";
+#endif
+    cout << "Lista maior: " << largeSize << " IDs em [1, " << universe << "], "
+         << repetitions << " repetições (tempo médio em µs)\n";
+    cout << setw(8) << "razão" << setw(10) << "menor" << setw(12) << "resultado"
+         << setw(12) << "linear" << setw(12) << "galloping" << setw(18) << blocks
+         << setw(12) << "adaptativo" << "\n";
+
+    for (size_t ratio : {1, 2, 4, 8, 16, 32, 64, 256, 1024, 8192}) {
+        vector<uint32_t> small = randomPostings(max<size_t>(1, largeSize / ratio), universe, rng);
+        PostingSpan a(small);
+        PostingSpan b(large);
+
+        size_t expected = PostingIntersector::intersectLinear(a, b, output.data());
+        vector<uint32_t> reference(output.begin(), output.begin() + expected);
+        auto check = [&](size_t count) {
+            if (count != expected || !equal(reference.begin(), reference.end(), output.begin())) {
+                cerr << "Erro: resultado divergente na razão " << ratio << "\n";
+                exit(1);
+            }
+        };
+        check(PostingIntersector::intersectGalloping(a, b, output.data()));
+        check(PostingIntersector::intersectBlocks(a, b, output.data()));
+        check(PostingIntersector::intersect(a, b, output.data()));
+
+        double linear = measure(repetitions, [&]() { PostingIntersector::intersectLinear(a, b, output.data()); });
+        double galloping = measure(repetitions, [&]() { PostingIntersector::intersectGalloping(a, b, output.data()); });
+        double block = measure(repetitions, [&]() { PostingIntersector::intersectBlocks(a, b, output.data()); });
+        double adaptive = measure(repetitions, [&]() { PostingIntersector::intersect(a, b, output.data()); });
+
+        cout << fixed << setprecision(1)
+             << setw(8) << ratio << setw(10) << small.size() << setw(12) << expected
+             << setw(12) << linear << setw(12) << galloping << setw(18) << block
+             << setw(12) << adaptive << "\n";
+    }
+
+    cout << "\nUnião de k listas com " << largeSize << " IDs no total (tempo médio em µs)\n";
+    cout << setw(8) << "k" << setw(12) << "resultado" << setw(12) << "em pares" << setw(12) << "menores"
+         << setw(12) << "k vias" << "\n";
+    PostingIntersector intersector;
+    for (size_t k : {2, 8, 16, 32, 64, 128, 512, 2048}) {
+        vector<vector<uint32_t>> lists;
+        vector<PostingSpan> spans;
+        for (size_t i = 0; i < k; ++i) {
+            lists.push_back(randomPostings(max<size_t>(1, largeSize / k), universe, rng));
+        }
+        spans.assign(lists.begin(), lists.end());
+
+        PostingSpan expected = intersector.uniteKWay(spans);
+        vector<uint32_t> current(expected.begin(), expected.end());
+        for (int strategy = 0; strategy < 2; ++strategy) {
+            PostingSpan result =
+                strategy == 0 ? intersector.unitePairwise(spans) : intersector.uniteSmallestFirst(spans);
+            if (!equal(current.begin(), current.end(), result.begin(), result.end())) {
+                cerr << "Erro: união divergente com k = " << k << "\n";
+                exit(1);
+            }
+        }
+
+        double pairs = measure(repetitions, [&]() { intersector.unitePairwise(spans); });
+        double smallest = measure(repetitions, [&]() { intersector.uniteSmallestFirst(spans); });
+        double kWay = measure(repetitions, [&]() { intersector.uniteKWay(spans); });
+        cout << fixed << setprecision(1) << setw(8) << k << setw(12) << current.size() << setw(12) << pairs
+             << setw(12) << smallest << setw(12) << kWay << "\n";
+    }
+    return 0;
+}
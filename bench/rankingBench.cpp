@@ -0,0 +1,199 @@
+#include "src/index.hpp"
+#include "src/textProcessor.hpp"
+#include "src/serializer.hpp"
+#include "src/queryProcessor.hpp"
+#include "src/intersection.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+
+/*
+Benchmark das buscas ranqueadas disjuntivas (palavras ligadas por OR, topK 10),
+medindo o caminho inteiro, das listas de postings aos K melhores, de três formas:
+- exaustiva: a união das listas (como a do planejador) e a pontuação de todas
+  as postings das palavras;
+- união + poda: a mesma união, pontuada pelo rankDocuments com a poda
+  (MaxScore com os limites dos blocos de postings);
+- cursores com poda: rankDisjunction, que tira os candidatos direto dos
+  cursores das listas, sem montar a união (o caminho de buscar --rank com OR).
+Confere que as três dão o mesmo resultado.
+
+O corpus tem muitos documentos curtos (50 a 400 palavras) com palavras
+sorteadas com a distribuição de frequências de data/machado, como nas coleções
+em que palavras comuns (casa, tempo) estão na maior parte dos documentos. O
+índice é gravado e aberto como no comando buscar (Serializer::open). As
+palavras das consultas são sorteadas com a mesma distribuição.
+
+Para cada tamanho de consulta, mostra a latência (p50/p90/p99) das três
+formas e, dos cursores com poda, quantas postings foram pontuadas, a fração
+das postings que nem foram decodificadas (blocos pulados) e quantas vezes o
+tempo total é menor que o da forma exaustiva.
+
+Uso: bench/rankingBench [diretorio] [documentos] [tamanhos, ex.: 2,4,8,16]
+*/
+
+using namespace std;
+namespace fs = filesystem;
+
+// Consultas por tamanho
+static const size_t QUERY_COUNT = 200;
+// Documentos mais relevantes pedidos
+static const size_t TOP_K = 10;
+
+/**
+ * Mede o tempo de execução de uma função em microssegundos.
+ */
+template <typename Function>
+double measure(Function function) {
+    auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * União das listas das palavras, como o planejador entrega uma consulta OR
+ * ao rankDocuments.
+ */
+vector<uint32_t> unite(const Index& index, const vector<string>& words) {
+    vector<vector<uint32_t>> scratch(words.size());
+    vector<PostingSpan> lists;
+    for (size_t i = 0; i < words.size(); ++i) {
+        lists.push_back(index.getPostings(words[i], scratch[i]));
+    }
+    PostingIntersector intersector;
+    PostingSpan united = intersector.uniteAll(lists);
+    return vector<uint32_t>(united.begin(), united.end());
+}
+
+/**
+ * Indica se as duas buscas devolveram os mesmos documentos, com as mesmas pontuações.
+ */
+bool sameDocuments(const RankedResults& a, const RankedResults& b) {
+    bool same = a.documents.size() == b.documents.size();
+    for (size_t i = 0; same && i < a.documents.size(); ++i) {
+        same = a.documents[i].filename == b.documents[i].filename && a.documents[i].score == b.documents[i].score;
+    }
+    return same;
+}
+
+/**
+ * Percentil de uma lista de latências já ordenada.
+ */
+double percentile(const vector<double>& sorted, double p) {
+    return sorted[min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+/**
+ * Escreve os percentis de uma lista de latências.
+ */
+void printLatencies(const string& name, vector<double> micros) {
+    sort(micros.begin(), micros.end());
+    cout << "  " << name << ": p50 " << percentile(micros, 0.50) << " us, p90 " << percentile(micros, 0.90)
+         << " us, p99 " << percentile(micros, 0.99) << " us\n";
+}
+
+int main(int argc, char* argv[]) {
+    string directory = argc > 1 ? argv[1] : "data/machado";
+    size_t documents = argc > 2 ? stoul(argv[2]) : 50000;
+    string sizeList = argc > 3 ? argv[3] : "2,4,8,16";
+
+    TextProcessor textProcessor;
+    vector<string> corpus;
+    for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            ifstream file(entry.path(), ios::binary);
+            stringstream buffer;
+            buffer << file.rdbuf();
+            textProcessor.forEachToken(buffer.str(), [&](const string& token) { corpus.push_back(token); });
+        }
+    }
+    if (corpus.empty()) {
+        cerr << "Erro: corpus vazio: " << directory << "\n";
+        return 1;
+    }
+
+    mt19937_64 random(42);
+    uniform_int_distribution<size_t> pick(0, corpus.size() - 1);
+    uniform_int_distribution<size_t> length(50, 400);
+    Index built;
+    for (size_t d = 0; d < documents; ++d) {
+        int docId = built.addDocument("doc" + to_string(d) + ".txt");
+        for (size_t w = length(random); w > 0; --w) {
+            built.addWordToDocument(corpus[pick(random)], docId);
+        }
+    }
+    built.freeze();
+    fs::path indexFile = fs::temp_directory_path() / "rankingBench.dat";
+    Serializer::serialize(built, indexFile.string());
+    built = Index();
+    Index index = Serializer::open(indexFile.string());
+
+    QueryProcessor exhaustive(index);
+    exhaustive.setPruning(false);
+    QueryProcessor pruned(index);
+    Statistics::enable();
+
+    cout << fixed << setprecision(1);
+    cout << documents << " documentos, " << index.getAllWords().size() << " palavras, topK " << TOP_K << "\n";
+    stringstream sizes(sizeList);
+    for (string item; getline(sizes, item, ',');) {
+        size_t termCount = stoul(item);
+        vector<double> exhaustiveMicros;
+        vector<double> unitedMicros;
+        vector<double> prunedMicros;
+        uint64_t scored = 0;
+        uint64_t skipped = 0;
+        uint64_t postings = 0;
+        for (size_t q = 0; q < QUERY_COUNT; ++q) {
+            vector<string> words;
+            while (words.size() < termCount) {
+                const string& word = corpus[pick(random)];
+                if (find(words.begin(), words.end(), word) == words.end()) {
+                    words.push_back(word);
+                }
+            }
+            for (const string& word : words) {
+                postings += index.getDocumentFrequency(word);
+            }
+
+            // Caminho completo de cada forma, das listas de postings aos K melhores
+            RankedResults expected;
+            RankedResults united;
+            RankedResults results;
+            exhaustiveMicros.push_back(measure([&]() {
+                expected = exhaustive.rankDocuments(unite(index, words), words, TOP_K);
+            }));
+            unitedMicros.push_back(measure([&]() { united = pruned.rankDocuments(unite(index, words), words, TOP_K); }));
+            uint64_t scoredBefore = Statistics::value(Statistics::POSTINGS_SCORED);
+            uint64_t skippedBefore = Statistics::value(Statistics::POSTINGS_SKIPPED);
+            prunedMicros.push_back(measure([&]() { results = pruned.rankDisjunction(words, TOP_K); }));
+            scored += Statistics::value(Statistics::POSTINGS_SCORED) - scoredBefore;
+            skipped += Statistics::value(Statistics::POSTINGS_SKIPPED) - skippedBefore;
+
+            if (!sameDocuments(expected, united) || !sameDocuments(expected, results)) {
+                cerr << "Erro: a poda mudou o resultado da consulta " << q << " com " << termCount << " palavras\n";
+                return 1;
+            }
+        }
+
+        cout << termCount << " palavras:\n";
+        printLatencies("exaustiva         ", exhaustiveMicros);
+        printLatencies("união + poda      ", unitedMicros);
+        printLatencies("cursores com poda ", prunedMicros);
+        double total = 0;
+        double totalPruned = 0;
+        for (size_t q = 0; q < QUERY_COUNT; ++q) {
+            total += exhaustiveMicros[q];
+            totalPruned += prunedMicros[q];
+        }
+        cout << "  postings pontuadas: " << scored << ", não decodificadas: " << skipped << " ("
+             << 100.0 * skipped / max<uint64_t>(1, postings) << "%), tempo total "
+             << setprecision(2) << total / totalPruned << "x menor\n" << setprecision(1);
+    }
+    fs::remove(indexFile);
+    return 0;
+}
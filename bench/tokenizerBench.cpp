@@ -0,0 +1,240 @@
+#include "src/textProcessor.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
+
+/*
+Microbenchmark do tokenizador: compara a vazão (MB/s) do TextProcessor::process
+atual com a implementação anterior (istringstream + normalizeWord com strings
+temporárias, que só conhecia acentos com o byte 0xC3 e pontuação ASCII),
+reproduzida abaixo como referência, e o tamanho do vocabulário gerado por cada
+uma. Confere que as palavras das duas só diferem onde a anterior deixava
+passar caracteres não ASCII (aspas curvas, travessões, maiúsculas acentuadas
+fora da tabela) e que process() e forEachToken() produzem as mesmas palavras.
+Compara também a lista de stop words embutida (hash perfeito montado na
+compilação) com a mesma lista carregada de data/stopwords.txt (unordered_set):
+as palavras produzidas devem ser as mesmas.
+
+Uso: bench/tokenizerBench [diretorio] [repeticoes]
+*/
+
+using namespace std;
+namespace fs = filesystem;
+
+// Implementação anterior do TextProcessor::process, mantida aqui apenas para comparação.
+class LegacyTokenizer {
+private:
+    const unordered_set<string>& stopWords;
+
+    static bool isPunctuation(char c) {
+        return (c >= 33 && c <= 47) || (c >= 58 && c <= 64) ||
+               (c >= 91 && c <= 96) || (c >= 123 && c <= 126);
+    }
+
+    static string toLowerAndRemoveAccents(const string& str) {
+        string result;
+        for (size_t i = 0; i < str.size(); i++) {
+            unsigned char c = str[i];
+            if (c == 0xC3 && i + 1 < str.size()) {
+                unsigned char next = str[i + 1];
+                char folded = 0;
+                switch (next) {
+                    case 0xA1: case 0xA0: case 0xA2: case 0xA3: case 0xA4:
+                    case 0x81: case 0x80: case 0x82: case 0x83: case 0x84: folded = 'a'; break;
+                    case 0xA9: case 0xA8: case 0xAA: case 0xAB:
+                    case 0x89: case 0x88: case 0x8A: case 0x8B: folded = 'e'; break;
+                    case 0xAD: case 0xAC: case 0xAE: case 0xAF:
+                    case 0x8D: case 0x8C: case 0x8E: case 0x8F: folded = 'i'; break;
+                    case 0xB3: case 0xB2: case 0xB4: case 0xB5: case 0xB6:
+                    case 0x93: case 0x92: case 0x94: case 0x95: case 0x96: folded = 'o'; break;
+                    case 0xBA: case 0xB9: case 0xBB: case 0xBC:
+                    case 0x9A: case 0x99: case 0x9B: case 0x9C: folded = 'u'; break;
+                    case 0xA7: case 0x87: folded = 'c'; break;
+                }
+                if (folded != 0) {
+                    result += folded;
+                    i++;
+                } else {
+                    result += static_cast<char>(c);
+                }
+            } else if (c >= 'A' && c <= 'Z') {
+                result += static_cast<char>(c + 32);
+            } else {
+                result += static_cast<char>(c);
+            }
+        }
+        return result;
+    }
+
+public:
+    explicit LegacyTokenizer(const unordered_set<string>& words) : stopWords(words) {}
+
+    static string normalizeWord(const string& word) {
+        string result;
+        for (char c : word) {
+            if (!isPunctuation(c)) {
+                result += c;
+            }
+        }
+        return toLowerAndRemoveAccents(result);
+    }
+
+    vector<string> process(const string& text) const {
+        vector<string> tokens;
+        istringstream iss(text);
+        string token;
+        while (iss >> token) {
+            tokens.push_back(token);
+        }
+        vector<string> result;
+        for (const string& t : tokens) {
+            string normalized = normalizeWord(t);
+            if (!normalized.empty() && stopWords.find(normalized) == stopWords.end()) {
+                result.push_back(normalized);
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * Mede o tempo de execução de uma função em segundos.
+ */
+template <typename Function>
+double measure(Function function) {
+    auto start = chrono::steady_clock::now();
+    function();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    string directory = argc > 1 ? argv[1] : "data/machado";
+    int repetitions = argc > 2 ? stoi(argv[2]) : 5;
+
+    TextProcessor textProcessor;
+    TextProcessor loadedProcessor;
+    if (!loadedProcessor.loadStopWords("data/stopwords.txt")) {
+        cerr << "Erro: Não foi possível carregar o arquivo data/stopwords.txt\n";
+        return 1;
+    }
+    unordered_set<string> stopWords;
+    ifstream stopFile("data/stopwords.txt");
+    for (string word; stopFile >> word;) {
+        string normalized = LegacyTokenizer::normalizeWord(word);
+        if (!normalized.empty()) {
+            stopWords.insert(normalized);
+        }
+    }
+    LegacyTokenizer legacy(stopWords);
+
+    vector<string> texts;
+    size_t totalBytes = 0;
+    for (const auto& entry : fs::recursive_directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            ifstream file(entry.path());
+            stringstream buffer;
+            buffer << file.rdbuf();
+            texts.push_back(buffer.str());
+            totalBytes += texts.back().size();
+        }
+    }
+
+    // Vocabulário de cada tokenizador; as palavras só podem diferir quando a
+    // anterior tem bytes não ASCII
+    unordered_set<string> legacyWords;
+    unordered_set<string> currentWords;
+    for (const string& text : texts) {
+        vector<string> before = legacy.process(text);
+        vector<string> after = textProcessor.process(text);
+        vector<string> streamed;
+        textProcessor.forEachToken(text, [&](const string& token) { streamed.push_back(token); });
+        if (streamed != after) {
+            cerr << "Erro: process() e forEachToken() divergem\n";
+            return 1;
+        }
+        if (loadedProcessor.process(text) != after) {
+            cerr << "Erro: as stop words embutidas e as carregadas do arquivo divergem\n";
+            return 1;
+        }
+        legacyWords.insert(before.begin(), before.end());
+        currentWords.insert(after.begin(), after.end());
+    }
+    auto isAscii = [](const string& word) {
+        return all_of(word.begin(), word.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+    };
+    for (const string& word : legacyWords) {
+        if (isAscii(word) && currentWords.count(word) == 0) {
+            cerr << "Erro: a palavra ASCII '" << word << "' sumiu do vocabulário\n";
+            return 1;
+        }
+    }
+    size_t legacyNonAscii = count_if(legacyWords.begin(), legacyWords.end(), [&](const string& w) { return !isAscii(w); });
+    size_t currentNonAscii = count_if(currentWords.begin(), currentWords.end(), [&](const string& w) { return !isAscii(w); });
+
+    size_t sink = 0;
+    double legacySeconds = measure([&]() {
+        for (int r = 0; r < repetitions; ++r) {
+            for (const string& text : texts) {
+                sink += legacy.process(text).size();
+            }
+        }
+    });
+    double processSeconds = measure([&]() {
+        for (int r = 0; r < repetitions; ++r) {
+            for (const string& text : texts) {
+                sink += textProcessor.process(text).size();
+            }
+        }
+    });
+    double streamSeconds = measure([&]() {
+        for (int r = 0; r < repetitions; ++r) {
+            for (const string& text : texts) {
+                textProcessor.forEachToken(text, [&](const string& token) { sink += token.size(); });
+            }
+        }
+    });
+    double loadedSeconds = measure([&]() {
+        for (int r = 0; r < repetitions; ++r) {
+            for (const string& text : texts) {
+                loadedProcessor.forEachToken(text, [&](const string& token) { sink += token.size(); });
+            }
+        }
+    });
+
+    // Custo só da consulta às stop words, sobre todas as palavras do corpus
+    vector<string> tokens;
+    TextProcessor allWords;
+    allWords.loadStopWords("/dev/null");
+    for (const string& text : texts) {
+        allWords.forEachToken(text, [&](const string& token) { tokens.push_back(token); });
+    }
+    double perfectSeconds = measure([&]() {
+        for (const string& token : tokens) {
+            sink += textProcessor.isStopWord(token);
+        }
+    });
+    double loadedLookupSeconds = measure([&]() {
+        for (const string& token : tokens) {
+            sink += loadedProcessor.isStopWord(token);
+        }
+    });
+
+    double megabytes = static_cast<double>(totalBytes) * repetitions / (1024.0 * 1024.0);
+    cout << "Corpus: " << directory << " (" << texts.size() << " arquivos, "
+         << totalBytes / 1024 << " KB, " << repetitions << " repetições)\n";
+    cout << "  anterior (istringstream)   : " << megabytes / legacySeconds << " MB/s\n";
+    cout << "  process()                  : " << megabytes / processSeconds << " MB/s\n";
+    cout << "  forEachToken() (streaming) : " << megabytes / streamSeconds << " MB/s\n";
+    cout << "  forEachToken() (lista lida): " << megabytes / loadedSeconds << " MB/s\n";
+    cout << "  stop words, hash perfeito  : " << perfectSeconds * 1e9 / tokens.size() << " ns/palavra\n";
+    cout << "  stop words, unordered_set  : " << loadedLookupSeconds * 1e9 / tokens.size() << " ns/palavra\n";
+    cout << "  vocabulário anterior       : " << legacyWords.size() << " palavras (" << legacyNonAscii
+         << " com bytes não ASCII)\n";
+    cout << "  vocabulário atual          : " << currentWords.size() << " palavras (" << currentNonAscii
+         << " com bytes não ASCII)\n";
+    cout << "  (checksum " << sink << ")\n";
+    return 0;
+}
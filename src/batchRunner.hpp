@@ -0,0 +1,154 @@
+#ifndef BATCHRUNNER_HPP
+#define BATCHRUNNER_HPP
+
+#include "searchEngine.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <iomanip>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Resumo de uma execução em lote: quantidade de consultas, tempo total e a
+ * latência de cada consulta, em microssegundos.
+ */
+struct BatchSummary {
+    size_t queries = 0;
+    unsigned threads = 0;
+    double seconds = 0;
+    vector<uint64_t> micros;
+};
+
+/**
+ * Modo lote (comando lote): executa as consultas de um arquivo, uma por
+ * linha, sobre um índice aberto uma única vez.
+ *
+ * As linhas têm a sintaxe do comando buscar, como no modo servidor, e as
+ * respostas são as mesmas do servidor (o texto do buscar seguido de
+ * "FIM <tempo> ms"), escritas na ordem das linhas. Cada thread pega a próxima
+ * consulta de um contador compartilhado e grava a resposta na posição dela;
+ * a thread que chamou run escreve as respostas assim que elas (e as
+ * anteriores) ficam prontas. O índice, as stop words e o SearchEngine são
+ * somente leitura, então as threads não disputam nada além do contador e da
+ * trava das respostas prontas.
+ */
+class BatchRunner {
+private:
+    // Executor das buscas (compartilhado, somente leitura)
+    const SearchEngine& engine;
+    // Threads que executam as consultas
+    unsigned numThreads;
+
+public:
+    BatchRunner(const SearchEngine& searchEngine, unsigned threads)
+        : engine(searchEngine), numThreads(max(threads, 1u)) {}
+
+    /**
+     * Lê as consultas de in, executa-as em paralelo e escreve as respostas em
+     * out, na ordem das linhas. Linhas vazias também são consultas (com uma
+     * resposta de erro), para que a N-ésima resposta e a N-ésima latência
+     * sejam sempre as da N-ésima linha.
+     * Retorna o tempo total e as latências.
+     */
+    BatchSummary run(istream& in, ostream& out) const {
+        vector<string> queries;
+        for (string line; getline(in, line);) {
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == string::npos) {
+                queries.emplace_back();
+                continue;
+            }
+            size_t last = line.find_last_not_of(" \t\r");
+            queries.push_back(line.substr(first, last - first + 1));
+        }
+
+        BatchSummary summary;
+        summary.queries = queries.size();
+        summary.threads = static_cast<unsigned>(min<size_t>(numThreads, max<size_t>(queries.size(), 1)));
+        summary.micros.assign(queries.size(), 0);
+        vector<string> responses(queries.size());
+        vector<char> done(queries.size(), 0);
+        mutex doneMutex;
+        condition_variable ready;
+        atomic<size_t> nextQuery(0);
+
+        auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (unsigned t = 0; t < summary.threads; ++t) {
+            threads.emplace_back([&]() {
+                size_t i;
+                while ((i = nextQuery.fetch_add(1)) < queries.size()) {
+                    auto begin = chrono::steady_clock::now();
+                    ostringstream response;
+                    engine.searchLine(queries[i], response);
+                    uint64_t micros = static_cast<uint64_t>(
+                        chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - begin).count());
+                    response << "FIM " << fixed << setprecision(3) << micros / 1000.0 << " ms\n";
+                    summary.micros[i] = micros;
+                    responses[i] = response.str();
+                    {
+                        lock_guard<mutex> lock(doneMutex);
+                        done[i] = 1;
+                    }
+                    ready.notify_one();
+                }
+            });
+        }
+
+        // Escreve cada resposta assim que ela e as anteriores estão prontas
+        for (size_t i = 0; i < queries.size(); ++i) {
+            {
+                unique_lock<mutex> lock(doneMutex);
+                ready.wait(lock, [&]() { return done[i] != 0; });
+            }
+            out << responses[i];
+            string().swap(responses[i]);
+        }
+        out << flush;
+        for (thread& t : threads) {
+            t.join();
+        }
+        summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return summary;
+    }
+
+    /**
+     * Escreve a vazão (consultas/s) e a distribuição das latências.
+     */
+    static void printSummary(const BatchSummary& summary, ostream& out) {
+        out << fixed << setprecision(3);
+        out << "Consultas executadas: " << summary.queries << " em " << summary.seconds << " s com "
+            << summary.threads << (summary.threads == 1 ? " thread" : " threads");
+        if (summary.seconds > 0) {
+            out << " (" << setprecision(1) << summary.queries / summary.seconds << " consultas/s)"
+                << setprecision(3);
+        }
+        out << "\n";
+        if (summary.micros.empty()) {
+            return;
+        }
+        vector<uint64_t> sorted(summary.micros);
+        sort(sorted.begin(), sorted.end());
+        uint64_t total = 0;
+        for (uint64_t micros : sorted) {
+            total += micros;
+        }
+        auto percentile = [&](double p) {
+            return sorted[min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))] / 1000.0;
+        };
+        out << "Latência (ms): média " << total / 1000.0 / sorted.size() << ", p50 " << percentile(0.50)
+            << ", p90 " << percentile(0.90) << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+            << ", máxima " << sorted.back() / 1000.0 << "\n";
+    }
+};
+
+#endif
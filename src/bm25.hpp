@@ -0,0 +1,64 @@
+#ifndef BM25_HPP
+#define BM25_HPP
+
+#include <cmath>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Função de ranqueamento BM25 (Okapi).
+ * score(t, d) = idf(t) * tf * (k1 + 1) / (tf + k1 * (1 - b + b * |d| / média))
+ * com idf(t) = ln(1 + (N - df + 0.5) / (df + 0.5)).
+ */
+class BM25Scorer {
+private:
+    // Quantidade de documentos do índice
+    double numDocuments;
+    // Tamanho médio dos documentos (0 se o índice não armazena tamanhos)
+    double averageLength;
+    // Saturação da frequência
+    double k1;
+    // Peso da normalização pelo tamanho do documento
+    double b;
+
+public:
+    BM25Scorer(size_t documents, double avgLength, double k1Param = 1.2, double bParam = 0.75)
+        : numDocuments(static_cast<double>(documents)), averageLength(avgLength), k1(k1Param), b(bParam) {}
+
+    /**
+     * Peso de uma palavra que aparece em docFreq documentos.
+     */
+    double idf(size_t docFreq) const {
+        double df = static_cast<double>(docFreq);
+        return log(1.0 + (numDocuments - df + 0.5) / (df + 0.5));
+    }
+
+    /**
+     * Contribuição de uma palavra com peso idf e frequência tf em um documento
+     * de tamanho length. Sem tamanhos armazenados, todos contam como tamanho médio.
+     */
+    double score(double idfWeight, uint32_t tf, uint32_t length) const {
+        double relativeLength = averageLength > 0.0 ? length / averageLength : 1.0;
+        double frequency = static_cast<double>(tf);
+        return idfWeight * frequency * (k1 + 1.0) / (frequency + k1 * (1.0 - b + b * relativeLength));
+    }
+};
+
+/**
+ * Estatísticas da coleção inteira para o BM25, quando cada índice consultado
+ * é só uma parte dela (um shard): sem elas, cada shard pontuaria com a
+ * própria quantidade de documentos e a própria frequência das palavras, e as
+ * pontuações de shards diferentes não seriam comparáveis.
+ */
+struct CollectionStatistics {
+    size_t documentCount = 0;
+    double averageLength = 0.0;
+    // Quantidade de documentos da coleção que contêm a palavra
+    function<size_t(const string&)> documentFrequency;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef BOOLEANQUERY_HPP
+#define BOOLEANQUERY_HPP
+
+#include "queryProcessor.hpp"
+#include "wildcardPattern.hpp"
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Nó da árvore de uma consulta booleana.
+ * Folhas: TERM (uma palavra), PHRASE (frase exata), PATTERN (palavra com
+ * curingas, expandida nas palavras do dicionário) e FUZZY (palavra da busca
+ * aproximada, expandida nas palavras a até distance edições); nós internos:
+ * AND e OR (dois ou mais filhos) e NOT (um filho).
+ */
+struct QueryNode {
+    enum Type { TERM, PHRASE, PATTERN, FUZZY, AND, OR, NOT };
+
+    Type type;
+    // Texto como digitado (folhas), usado nas mensagens e no plano
+    string text;
+    // Palavra normalizada (TERM e FUZZY) ou padrão normalizado (PATTERN)
+    string word;
+    // Palavras normalizadas da frase (PHRASE)
+    Phrase phrase;
+    // Palavras do dicionário que casam com o padrão (PATTERN e FUZZY)
+    vector<string> expansions;
+    // Quantidade máxima de edições (FUZZY)
+    uint32_t distance = 0;
+    vector<QueryNode> children;
+};
+
+/**
+ * Analisador da linguagem de consulta booleana:
+ *
+ *   consulta := e (OR e)*
+ *   e        := nao ([AND] nao)*
+ *   nao      := NOT nao | "(" consulta ")" | termo | padrão | "frase"
+ *
+ * Os operadores são escritos em maiúsculas, em inglês ou em português
+ * (AND/E, OR/OU, NOT/NÃO/NAO); termos vizinhos sem operador são ligados por
+ * AND. Os parênteses podem vir colados aos termos: (casa OR lar) NOT velho.
+ * As folhas guardam só o texto; a normalização fica com quem usa a árvore.
+ */
+class BooleanQueryParser {
+private:
+    // Símbolos da consulta
+    enum TokenType { WORD, QUOTED, OPERATOR_AND, OPERATOR_OR, OPERATOR_NOT, OPEN, CLOSE, END };
+
+    struct Token {
+        TokenType type;
+        string text;
+    };
+
+    vector<Token> tokens;
+    size_t next;
+
+public:
+    /**
+     * Indica se os termos usam operadores booleanos, parênteses ou curingas.
+     * Sem eles a consulta é a busca simples (AND implícito entre os termos).
+     */
+    static bool isBoolean(const vector<string>& terms) {
+        for (const string& term : terms) {
+            if (term.find_first_of(" \t") != string::npos) {
+                continue;
+            }
+            if (isOperator(term) || term.find_first_of("()") != string::npos || WildcardPattern::hasWildcard(term)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Indica se a palavra é um operador booleano.
+     */
+    static bool isOperator(const string& word) {
+        return operatorOf(word) != WORD;
+    }
+
+    /**
+     * Monta a árvore da consulta a partir dos termos (frases já agrupadas por
+     * SearchEngine::parseArguments, sem as aspas).
+     * Lança uma exceção com a descrição do erro se a sintaxe for inválida.
+     */
+    static QueryNode parse(const vector<string>& terms) {
+        BooleanQueryParser parser(terms);
+        QueryNode root = parser.parseOr();
+        if (parser.peek().type == CLOSE) {
+            throw runtime_error("Parêntese ')' sem o '(' correspondente");
+        }
+        return root;
+    }
+
+private:
+    explicit BooleanQueryParser(const vector<string>& terms) : next(0) {
+        for (const string& term : terms) {
+            if (term.find_first_of(" \t") != string::npos) {
+                tokens.push_back({QUOTED, term});
+                continue;
+            }
+            TokenType type = operatorOf(term);
+            if (type != WORD) {
+                tokens.push_back({type, term});
+                continue;
+            }
+            // Separa os parênteses colados ao termo
+            size_t first = term.find_first_not_of('(');
+            if (first == string::npos) {
+                first = term.size();
+            }
+            size_t last = term.find_last_not_of(')');
+            last = (last == string::npos || last < first) ? first : last + 1;
+            for (size_t i = 0; i < first; ++i) {
+                tokens.push_back({OPEN, "("});
+            }
+            if (last > first) {
+                string word = term.substr(first, last - first);
+                tokens.push_back({operatorOf(word), word});
+            }
+            for (size_t i = last; i < term.size(); ++i) {
+                tokens.push_back({CLOSE, ")"});
+            }
+        }
+        tokens.push_back({END, ""});
+    }
+
+    /**
+     * Retorna o tipo do operador escrito em term, ou WORD se não for um operador.
+     */
+    static TokenType operatorOf(const string& term) {
+        if (term == "AND" || term == "E") {
+            return OPERATOR_AND;
+        }
+        if (term == "OR" || term == "OU") {
+            return OPERATOR_OR;
+        }
+        if (term == "NOT" || term == "NÃO" || term == "NAO") {
+            return OPERATOR_NOT;
+        }
+        return WORD;
+    }
+
+    const Token& peek() const {
+        return tokens[next];
+    }
+
+    /**
+     * Junta os filhos em um nó do tipo informado (ou retorna o único filho).
+     */
+    static QueryNode combine(QueryNode::Type type, vector<QueryNode> children) {
+        if (children.size() == 1) {
+            return move(children[0]);
+        }
+        QueryNode node;
+        node.type = type;
+        node.children = move(children);
+        return node;
+    }
+
+    QueryNode parseOr() {
+        vector<QueryNode> children;
+        children.push_back(parseAnd());
+        while (peek().type == OPERATOR_OR) {
+            ++next;
+            children.push_back(parseAnd());
+        }
+        return combine(QueryNode::OR, move(children));
+    }
+
+    QueryNode parseAnd() {
+        vector<QueryNode> children;
+        children.push_back(parseNot());
+        while (true) {
+            TokenType type = peek().type;
+            if (type == OPERATOR_AND) {
+                ++next;
+            } else if (type != WORD && type != QUOTED && type != OPERATOR_NOT && type != OPEN) {
+                break;
+            }
+            children.push_back(parseNot());
+        }
+        return combine(QueryNode::AND, move(children));
+    }
+
+    QueryNode parseNot() {
+        const Token& token = peek();
+        switch (token.type) {
+            case OPERATOR_NOT: {
+                ++next;
+                QueryNode node;
+                node.type = QueryNode::NOT;
+                node.children.push_back(parseNot());
+                return node;
+            }
+            case OPEN: {
+                ++next;
+                QueryNode node = parseOr();
+                if (peek().type != CLOSE) {
+                    throw runtime_error("Parêntese '(' sem o ')' correspondente");
+                }
+                ++next;
+                return node;
+            }
+            case WORD:
+            case QUOTED: {
+                ++next;
+                QueryNode node;
+                node.type = token.type == QUOTED ? QueryNode::PHRASE
+                            : WildcardPattern::hasWildcard(token.text) ? QueryNode::PATTERN
+                                                                        : QueryNode::TERM;
+                node.text = token.text;
+                return node;
+            }
+            case END:
+                throw runtime_error("Consulta terminada onde se esperava um termo");
+            default:
+                throw runtime_error("Esperava um termo antes de '" + token.text + "'");
+        }
+    }
+};
+
+#endif
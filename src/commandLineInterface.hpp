@@ -5,10 +5,18 @@
 #include "textProcessor.hpp"
 #include "indexer.hpp"
 #include "serializer.hpp"
-#include "queryProcessor.hpp"
+#include "indexUpdater.hpp"
+#include "shardedIndex.hpp"
+#include "spimiBuilder.hpp"
+#include "searchEngine.hpp"
+#include "queryServer.hpp"
+#include "batchRunner.hpp"
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
+#include <thread>
+#include <memory>
 
 using namespace std;
 
@@ -35,20 +43,170 @@ public:
             showUsage();
             return;
         }
+
+        // --stats e --stats=json (construir, buscar e lote) podem aparecer em qualquer posição
+        bool stats = false;
+        bool statsJson = false;
+        if (args[0] == "construir" || args[0] == "buscar" || args[0] == "lote") {
+            extractStatistics(stats, statsJson);
+        }
         
         if (args[0] == "construir") {
-            if (args.size() != 2) {
+            string directoryPath;
+            unsigned threads = 0;
+            unsigned shards = 0;
+            unsigned readMegabytes = Indexer::DEFAULT_READ_BUDGET >> 20;
+            unsigned memoryMegabytes = 0;
+            bool positions = false;
+            bool offsets = false;
+            for (size_t i = 1; i < args.size(); ++i) {
+                if (args[i] == "--threads") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], threads)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--memoria") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], memoryMegabytes)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--shards") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], shards)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--leitura") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], readMegabytes)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--posicoes") {
+                    positions = true;
+                } else if (args[i] == "--trechos") {
+                    offsets = true;
+                } else if (directoryPath.empty()) {
+                    directoryPath = args[i];
+                } else {
+                    showUsage();
+                    return;
+                }
+            }
+            if (directoryPath.empty()) {
                 showUsage();
                 return;
             }
-            buildIndex(args[1]);
+            // Sem --threads, um índice único usa uma thread e um dividido, uma por shard
+            if (threads == 0) {
+                threads = max(shards, 1u);
+            }
+            size_t readBudget = static_cast<size_t>(readMegabytes) << 20;
+            size_t memoryBudget = static_cast<size_t>(memoryMegabytes) << 20;
+            if (shards > 0) {
+                buildShards(directoryPath, shards, threads, positions, offsets, readBudget, memoryBudget, stats,
+                            statsJson);
+            } else {
+                buildIndex(directoryPath, threads, positions, offsets, readBudget, memoryBudget, stats, statsJson);
+            }
+        } else if (args[0] == "atualizar") {
+            string directoryPath;
+            unsigned threads = 1;
+            unsigned readMegabytes = Indexer::DEFAULT_READ_BUDGET >> 20;
+            bool compact = false;
+            for (size_t i = 1; i < args.size(); ++i) {
+                if (args[i] == "--threads") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], threads)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--leitura") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], readMegabytes)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--compactar") {
+                    compact = true;
+                } else if (directoryPath.empty()) {
+                    directoryPath = args[i];
+                } else {
+                    showUsage();
+                    return;
+                }
+            }
+            if (directoryPath.empty()) {
+                showUsage();
+                return;
+            }
+            updateIndex(directoryPath, threads, compact, static_cast<size_t>(readMegabytes) << 20);
         } else if (args[0] == "buscar") {
-            if (args.size() < 2) {
+            SearchOptions options;
+            vector<string> terms;
+            if (!SearchEngine::parseArguments(vector<string>(args.begin() + 1, args.end()), terms, options)) {
+                showUsage();
+                return;
+            }
+            search(terms, options, stats, statsJson);
+        } else if (args[0] == "servir") {
+            unsigned threads = thread::hardware_concurrency();
+            string socketPath;
+            unsigned cacheMegabytes = 64;
+            for (size_t i = 1; i < args.size(); ++i) {
+                if (args[i] == "--threads") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], threads)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--cache") {
+                    if (i + 1 >= args.size()) {
+                        showUsage();
+                        return;
+                    }
+                    // 0 desliga o cache
+                    if (args[++i] == "0") {
+                        cacheMegabytes = 0;
+                    } else if (!parsePositive(args[i], cacheMegabytes)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--socket") {
+                    if (i + 1 >= args.size()) {
+                        showUsage();
+                        return;
+                    }
+                    socketPath = args[++i];
+                } else {
+                    showUsage();
+                    return;
+                }
+            }
+            serve(threads, socketPath, cacheMegabytes);
+        } else if (args[0] == "lote") {
+            unsigned threads = thread::hardware_concurrency();
+            string queryFile;
+            string outputFile;
+            for (size_t i = 1; i < args.size(); ++i) {
+                if (args[i] == "--threads") {
+                    if (i + 1 >= args.size() || !parsePositive(args[++i], threads)) {
+                        showUsage();
+                        return;
+                    }
+                } else if (args[i] == "--saida") {
+                    if (i + 1 >= args.size()) {
+                        showUsage();
+                        return;
+                    }
+                    outputFile = args[++i];
+                } else if (queryFile.empty()) {
+                    queryFile = args[i];
+                } else {
+                    showUsage();
+                    return;
+                }
+            }
+            if (queryFile.empty()) {
                 showUsage();
                 return;
             }
-            vector<string> terms(args.begin() + 1, args.end());
-            search(terms);
+            runBatch(queryFile, outputFile, threads, stats, statsJson);
         } else {
             showUsage();
         }
@@ -63,89 +221,281 @@ private:
      */
     void showUsage() const {
         cout << "Uso:\n";
-        cout << "  indice construir <caminho_do_diretorio>\n";
-        cout << "  indice buscar <termo_de_busca> [<termo2> ...]\n";
+        cout << "  indice construir <caminho_do_diretorio> [--threads N] [--shards N] [--posicoes] [--trechos] [--leitura MB] [--memoria MB] [--stats[=json]]\n";
+        cout << "  indice atualizar <caminho_do_diretorio> [--threads N] [--compactar] [--leitura MB]\n";
+        cout << "  indice buscar [--rank] [--top K] [--trechos] [--explain] [--fuzzy[=k]] [--stats[=json]] <termo_de_busca> [<termo2> ...] [\"frase exata\" ...]\n";
+        cout << "  indice buscar [--explain] [--expansoes N] [--stats[=json]] '<consulta com AND, OR, NOT, parênteses e curingas * ?>'\n";
+        cout << "  indice servir [--threads N] [--socket <caminho>] [--cache MB]\n";
+        cout << "  indice lote <arquivo_de_consultas> [--threads N] [--saida <arquivo>] [--stats[=json]]\n";
     }
     
     /**
-     * Constrói o índice a partir de um diretório.
+     * Remove dos argumentos as opções --stats (relatório em texto) e
+     * --stats=json, indicando quais apareceram.
+     */
+    void extractStatistics(bool& stats, bool& json) {
+        vector<string> kept;
+        for (const string& arg : args) {
+            if (arg == "--stats" || arg == "--stats=json") {
+                stats = true;
+                json = json || arg == "--stats=json";
+            } else {
+                kept.push_back(arg);
+            }
+        }
+        args = move(kept);
+    }
+
+    /**
+     * Converte um argumento em inteiro positivo.
+     * Retorna false se o texto não for um número maior que zero.
      */
-    void buildIndex(const string& directoryPath) {
+    static bool parsePositive(const string& text, unsigned& value) {
+        return SearchEngine::parsePositive(text, value);
+    }
+
+    /**
+     * Constrói o índice a partir de um diretório, usando a quantidade de threads informada.
+     * Com positions, guarda também as posições das palavras (buscas por frase);
+     * com offsets, os deslocamentos das primeiras ocorrências (buscar --trechos).
+     * readBudget limita a memória dos buffers de leitura dos arquivos. Com
+     * memoryBudget (em bytes; 0 é sem limite), o índice é construído pelo
+     * SpimiBuilder, em partes gravadas em disco e intercaladas no final.
+     * Com stats, escreve em cerr o relatório de estatísticas (em JSON com statsJson).
+     */
+    void buildIndex(const string& directoryPath, unsigned threads, bool positions, bool offsets, size_t readBudget,
+                    size_t memoryBudget, bool stats, bool statsJson) {
         try {
+            if (stats) {
+                Statistics::enable();
+            }
             Index index;
-            TextProcessor textProcessor;
-            if (!textProcessor.loadStopWords("data/stopwords.txt")) {
-                cerr << "Erro: Não foi possível carregar o arquivo data/stopwords.txt\n";
-                return;
+            if (positions) {
+                index.enablePositions();
             }
+            if (offsets) {
+                index.enableOffsets();
+            }
+            TextProcessor textProcessor;
             
-            Indexer indexer(index, textProcessor);
-            indexer.indexDirectory(directoryPath);
-            
-            Serializer::serialize(index, "index.dat");
+            vector<string> previousShards = ShardManifest::shardPaths("index.dat");
+            size_t words;
+            if (memoryBudget > 0) {
+                SpimiBuilder builder(index, textProcessor, threads, readBudget, memoryBudget);
+                words = builder.build(Indexer::listFiles(directoryPath), "index.dat");
+            } else {
+                Indexer indexer(index, textProcessor, threads, readBudget);
+                indexer.indexDirectory(directoryPath);
+                index.freeze();
+                Serializer::serialize(index, "index.dat");
+                words = index.getAllWords().size();
+            }
+            // Segmentos delta e shards do índice anterior não valem para o novo
+            Serializer::removeDeltas("index.dat");
+            ShardedIndex::removeShards(previousShards);
             
             cout << "Índice construído e salvo em index.dat\n";
             cout << "Documentos indexados: " << index.getAllDocumentIds().size() << "\n";
-            cout << "Palavras únicas no índice: " << index.getAllWords().size() << "\n";
+            cout << "Palavras únicas no índice: " << words << "\n";
+            if (stats) {
+                Statistics::report(cerr, statsJson, index.memoryUsage());
+            }
         } catch (const exception& e) {
             cerr << "Erro durante a indexação: " << e.what() << endl;
         }
     }
     
     /**
-     * Realiza uma busca por termos no índice.
-     * Ignora stop words na busca, mas não interrompe a busca se encontrar stop words.
+     * Constrói um índice dividido em até numShards shards (index.dat passa a
+     * ser o manifesto), construídos em paralelo com as threads informadas.
+     * Os demais parâmetros são os de buildIndex.
      */
-    void search(const vector<string>& terms) {
+    void buildShards(const string& directoryPath, unsigned numShards, unsigned threads, bool positions,
+                     bool offsets, size_t readBudget, size_t memoryBudget, bool stats, bool statsJson) {
         try {
-            Index index = Serializer::deserialize("index.dat");
-            QueryProcessor queryProcessor(index);
-            
-            // Carrega stop words para filtrar os termos de busca
+            if (stats) {
+                Statistics::enable();
+            }
             TextProcessor textProcessor;
-            if (!textProcessor.loadStopWords("data/stopwords.txt")) {
-                cerr << "Aviso: Não foi possível carregar stop words, buscando com todos os termos.\n";
+            ShardManifest manifest =
+                ShardedIndex::build(directoryPath, "index.dat", numShards, threads, positions, offsets, readBudget,
+                                    memoryBudget, textProcessor);
+
+            size_t documents = 0;
+            cout << "Índice construído em " << manifest.shards.size() << " shards (manifesto em index.dat)\n";
+            for (const ShardEntry& shard : manifest.shards) {
+                cout << "  " << shard.filename << ": documentos " << shard.firstId << " a "
+                     << shard.firstId + shard.documents - 1 << "\n";
+                documents += shard.documents;
             }
-            
-            // Normaliza e filtra os termos de busca (remove stop words)
-            vector<string> normalizedTerms;
-            for (const string& term : terms) {
-                string normalized = TextProcessor::normalizeWord(term);
-                
-                // Ignora stop words, mas mantém outros termos
-                if (!normalized.empty() && !textProcessor.isStopWord(normalized)) {
-                    normalizedTerms.push_back(normalized);
+            cout << "Documentos indexados: " << documents << "\n";
+            if (stats) {
+                Statistics::report(cerr, statsJson, {});
+            }
+        } catch (const exception& e) {
+            cerr << "Erro durante a indexação: " << e.what() << endl;
+        }
+    }
+
+    /**
+     * Abre o índice para consultas: os shards de um índice dividido, na ordem
+     * do manifesto, ou o índice único.
+     */
+    static vector<Index> openIndexes(const string& filename) {
+        if (ShardManifest::isManifest(filename)) {
+            return ShardedIndex::open(filename);
+        }
+        vector<Index> indexes;
+        indexes.push_back(Serializer::open(filename));
+        return indexes;
+    }
+
+    /**
+     * Memória de todos os índices abertos, somada por item.
+     */
+    static vector<MemoryItem> memoryUsage(const vector<Index>& indexes) {
+        vector<MemoryItem> items;
+        for (const Index& index : indexes) {
+            for (const MemoryItem& item : index.memoryUsage()) {
+                auto same = find_if(items.begin(), items.end(), [&](const MemoryItem& m) { return m.key == item.key; });
+                if (same == items.end()) {
+                    items.push_back(item);
                 } else {
-                    cout << "Aviso: Termo '" << term << "' é uma stop word e será ignorado na busca.\n";
+                    same->bytes += item.bytes;
                 }
             }
-            
-            // Se todos os termos eram stop words, informa o usuário
-            if (normalizedTerms.empty()) {
-                cout << "Todos os termos de busca são stop words. Nenhum documento será retornado.\n";
-                return;
+        }
+        return items;
+    }
+
+    /**
+     * Atualiza o índice com as alterações do diretório desde a última
+     * construção ou atualização, gravando-as em um segmento delta.
+     */
+    void updateIndex(const string& directoryPath, unsigned threads, bool compact, size_t readBudget) {
+        if (ShardManifest::isManifest("index.dat")) {
+            cerr << "Erro durante a atualização: o índice está dividido em shards, que não são atualizados "
+                    "de forma incremental\n";
+            cerr << "Execute novamente: indice construir <diretorio> --shards N\n";
+            return;
+        }
+        try {
+            TextProcessor textProcessor;
+            IndexUpdater updater("index.dat", textProcessor, threads, readBudget);
+            UpdateSummary summary = updater.update(directoryPath, compact);
+
+            cout << "Arquivos novos: " << summary.added << ", modificados: " << summary.modified
+                 << ", removidos: " << summary.removed << ", inalterados: "
+                 << summary.unchanged + summary.touched << "\n";
+            if (summary.deltaFile.empty()) {
+                cout << "Nenhuma alteração; o índice já está atualizado\n";
+            } else {
+                cout << "Alterações salvas em " << summary.deltaFile << "\n";
             }
+            if (summary.compacted) {
+                cout << "Segmentos compactados em index.dat\n";
+            }
+        } catch (const exception& e) {
+            cerr << "Erro durante a atualização: " << e.what() << endl;
+            cerr << "Execute primeiro: indice construir <diretorio>\n";
+        }
+    }
+
+    /**
+     * Realiza uma busca por termos no índice.
+     * Ignora stop words na busca, mas não interrompe a busca se encontrar stop words.
+     * Com options.ranked, mostra apenas os options.topK documentos mais relevantes (BM25).
+     * Com stats, escreve em cerr o relatório de estatísticas (em JSON com statsJson).
+     */
+    void search(const vector<string>& terms, const SearchOptions& options, bool stats, bool statsJson) {
+        try {
+            if (stats) {
+                Statistics::enable();
+            }
+            vector<Index> indexes = openIndexes("index.dat");
             
-            vector<string> results;
-            if (normalizedTerms.size() == 1) {
-                results = queryProcessor.querySingle(normalizedTerms[0]);
-            } else {
-                results = queryProcessor.queryMultiple(normalizedTerms);
+            // Stop words embutidas, para filtrar os termos de busca
+            TextProcessor textProcessor;
+            
+            SearchEngine engine(indexes, textProcessor);
+            engine.search(terms, options, cout);
+            if (stats) {
+                Statistics::report(cerr, statsJson, memoryUsage(indexes));
             }
+        } catch (const exception& e) {
+            cerr << "Erro durante a busca: " << e.what() << endl;
+            cerr << "Execute primeiro: indice construir <diretorio>\n";
+        }
+    }
+
+    /**
+     * Carrega o índice uma única vez e atende consultas pela
+     * entrada padrão ou, se socketPath for informado, por um socket Unix.
+     * As consultas compartilham um cache de cacheMegabytes MB (0 desliga).
+     */
+    void serve(unsigned threads, const string& socketPath, unsigned cacheMegabytes) {
+        try {
+            vector<Index> indexes = openIndexes("index.dat");
+            
+            TextProcessor textProcessor;
             
-            if (results.empty()) {
-                cout << "Nenhum documento encontrado.\n";
+            unique_ptr<QueryCache> cache;
+            if (cacheMegabytes > 0) {
+                cache = make_unique<QueryCache>(static_cast<size_t>(cacheMegabytes) << 20);
+            }
+            SearchEngine engine(indexes, textProcessor, cache.get());
+            QueryServer server(engine, threads, cache.get());
+            if (socketPath.empty()) {
+                cerr << "Servidor pronto: uma consulta por linha (\"sair\" para encerrar).\n";
+                server.serveStream(cin, cout);
             } else {
-                cout << "Documentos encontrados (" << results.size() << "):\n";
-                for (const string& filename : results) {
-                    cout << "  " << filename << endl;
-                }
+                cerr << "Servidor escutando em " << socketPath << " (\"desligar\" para encerrar).\n";
+                server.serveSocket(socketPath);
             }
+            server.printSummary(cerr);
         } catch (const exception& e) {
-            cerr << "Erro durante a busca: " << e.what() << endl;
+            cerr << "Erro no servidor: " << e.what() << endl;
             cerr << "Execute primeiro: indice construir <diretorio>\n";
         }
     }
+
+    /**
+     * Carrega o índice uma única vez e executa as consultas do arquivo, uma
+     * por linha, com as threads informadas (BatchRunner). As respostas vão,
+     * na ordem das linhas, para outputFile (ou a saída padrão, se vazio); a
+     * vazão e a distribuição das latências vão para a saída de erros.
+     */
+    void runBatch(const string& queryFile, const string& outputFile, unsigned threads, bool stats, bool statsJson) {
+        try {
+            if (stats) {
+                Statistics::enable();
+            }
+            ifstream queries(queryFile);
+            if (!queries) {
+                throw runtime_error("Não foi possível abrir o arquivo de consultas: " + queryFile);
+            }
+            ofstream file;
+            if (!outputFile.empty()) {
+                file.open(outputFile);
+                if (!file) {
+                    throw runtime_error("Não foi possível criar o arquivo de saída: " + outputFile);
+                }
+            }
+            vector<Index> indexes = openIndexes("index.dat");
+
+            TextProcessor textProcessor;
+
+            SearchEngine engine(indexes, textProcessor);
+            BatchRunner runner(engine, threads);
+            BatchSummary summary = runner.run(queries, outputFile.empty() ? cout : file);
+            BatchRunner::printSummary(summary, cerr);
+            if (stats) {
+                Statistics::report(cerr, statsJson, memoryUsage(indexes));
+            }
+        } catch (const exception& e) {
+            cerr << "Erro no modo lote: " << e.what() << endl;
+        }
+    }
 };
 
 #endif
\ No newline at end of file
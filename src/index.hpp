@@ -6,16 +6,202 @@
 #include <set>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <functional>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <string_view>
+#include "mappedIndex.hpp"
+#include "wildcardPattern.hpp"
+#include "levenshteinAutomaton.hpp"
+#include "termDictionary.hpp"
+#include "postingSpan.hpp"
+#include "positionalList.hpp"
+#include "postingCursor.hpp"
+#include "statistics.hpp"
 
 using namespace std;
 /**
  * Classe que representa o índice invertido.
  * Armazena mapeamentos de palavras para documentos e vice-versa.
+ *
+ * Um índice aberto com Serializer::open sobre um arquivo versão 2 é somente
+ * leitura: as consultas são respondidas diretamente do arquivo mapeado em memória.
+ * Se houver segmentos delta (gravados por "atualizar"), as consultas enxergam o
+ * arquivo base mais os deltas, sem os documentos removidos (tombstones). Os IDs
+ * de cada delta são maiores que os de todos os segmentos anteriores, então as
+ * postings de uma palavra continuam ordenadas ao concatenar os segmentos.
  */
 class Index {
+public:
+    /**
+     * Lista de postings da fase de construção: documentos e a frequência da
+     * palavra em cada um. Ocorrências repetidas no documento inserido por último
+     * apenas incrementam a frequência; a ordenação final é feita no congelamento.
+     * Em um índice posicional, positions guarda as posições de cada ocorrência,
+     * na ordem das postings (frequencies[i] posições para o documento i). Com
+     * deslocamentos, offsets guarda os das primeiras ocorrências da mesma forma
+     * (OccurrenceOffsets::countFor(frequencies[i]) para o documento i).
+     */
+    struct PostingBuilder {
+        vector<uint32_t> docIds;
+        vector<uint32_t> frequencies;
+        vector<uint32_t> positions;
+        vector<uint32_t> offsets;
+
+        void add(uint32_t docId, uint32_t count = 1) {
+            if (!docIds.empty() && docIds.back() == docId) {
+                frequencies.back() += count;
+            } else {
+                docIds.push_back(docId);
+                frequencies.push_back(count);
+            }
+        }
+
+        void addAt(uint32_t docId, uint32_t position) {
+            add(docId);
+            positions.push_back(position);
+        }
+
+        /**
+         * Guarda o deslocamento em bytes da ocorrência adicionada por último
+         * (add ou addAt), se ela está entre as primeiras do documento.
+         */
+        void addOffset(uint32_t offset) {
+            if (frequencies.back() <= OccurrenceOffsets::LIMIT) {
+                offsets.push_back(offset);
+            }
+        }
+
+        void append(const PostingBuilder& other) {
+            docIds.insert(docIds.end(), other.docIds.begin(), other.docIds.end());
+            frequencies.insert(frequencies.end(), other.frequencies.begin(), other.frequencies.end());
+            positions.insert(positions.end(), other.positions.begin(), other.positions.end());
+            offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+        }
+    };
+
+    /**
+     * Dicionário parcial da fase de construção: as palavras ficam internadas
+     * em um TermDictionary e a lista de postings de cada uma é a posição do
+     * seu ID em postings. Procurar uma palavra não aloca memória.
+     */
+    struct PartialPostings {
+        TermDictionary terms;
+        vector<PostingBuilder> postings;
+
+        /**
+         * Retorna as postings da palavra, criando uma lista vazia se ela é nova.
+         */
+        PostingBuilder& operator[](string_view word) {
+            return at(terms.intern(word));
+        }
+
+        /**
+         * Igual a operator[], com o hash (TermDictionary::hashOf) já calculado.
+         */
+        PostingBuilder& postingsOf(string_view word, uint64_t hash) {
+            return at(terms.intern(word, hash));
+        }
+
+        /**
+         * Incorpora outro dicionário parcial: as listas de palavras novas são
+         * movidas sem cópia e as das palavras já presentes são concatenadas.
+         * O outro dicionário fica vazio ao final.
+         */
+        void merge(PartialPostings& other) {
+            postings.reserve(postings.size() + other.postings.size());
+            for (uint32_t id = 0; id < other.postings.size(); ++id) {
+                uint32_t target = terms.intern(other.terms.term(id));
+                if (target == postings.size()) {
+                    postings.push_back(move(other.postings[id]));
+                } else {
+                    postings[target].append(other.postings[id]);
+                }
+            }
+            other.clear();
+        }
+
+        /**
+         * Reserva espaço para pelo menos count palavras.
+         */
+        void reserve(size_t count) {
+            terms.reserve(count, 0);
+            postings.reserve(count);
+        }
+
+        size_t size() const {
+            return postings.size();
+        }
+
+        bool empty() const {
+            return postings.empty();
+        }
+
+        void clear() {
+            terms.clear();
+            postings = vector<PostingBuilder>();
+        }
+
+    private:
+        PostingBuilder& at(uint32_t id) {
+            if (id == postings.size()) {
+                postings.emplace_back();
+            }
+            return postings[id];
+        }
+    };
+
 private:
-    // Índice invertido: palavra -> conjunto de IDs de documentos que contêm a palavra
-    unordered_map<string, set<int>> invertedIndex;
+    // Posição de uma lista de postings dentro da arena do índice congelado
+    struct PostingRange {
+        uint64_t offset;
+        uint32_t count;
+        // Início das posições da palavra em positionArena (índice posicional)
+        uint64_t positionOffset;
+        // Início dos deslocamentos das ocorrências da palavra em offsetArena
+        uint64_t offsetStart;
+    };
+
+    // Fase de construção: palavra -> documentos que contêm a palavra (com frequências)
+    PartialPostings invertedIndex;
+
+    // Fase de consulta: palavras internadas em ordem alfabética, então o ID de
+    // uma palavra é sua posição no dicionário ordenado (buscas por prefixo e
+    // serialização percorrem os IDs em ordem)
+    TermDictionary frozenTerms;
+
+    // Faixa de postings na arena de cada palavra (posição = ID em frozenTerms)
+    vector<PostingRange> frozenRanges;
+
+    // Todas as listas de postings do índice congelado, contíguas e ordenadas
+    vector<uint32_t> postingArena;
+
+    // Frequência da palavra em cada documento, paralela a postingArena
+    vector<uint32_t> frequencyArena;
+
+    // Posições de todas as ocorrências, na ordem das postings (índice posicional)
+    vector<uint32_t> positionArena;
+
+    // Deslocamentos das primeiras ocorrências, na ordem das postings (construir --trechos)
+    vector<uint32_t> offsetArena;
+
+    // Indica se o índice guarda as posições das palavras
+    bool positional;
+
+    // Indica se o índice guarda os deslocamentos das primeiras ocorrências
+    bool withOffsets;
+
+    // Quantidade de palavras indexadas em cada documento (posição = ID)
+    vector<uint32_t> documentLengths;
+
+    // Soma dos tamanhos de todos os documentos
+    uint64_t totalLength;
+
+    // Indica se o índice já foi congelado (fase de consulta)
+    bool frozen;
 
     // Mapeamento de ID do documento para o nome do arquivo
     unordered_map<int, string> idToFile;
@@ -26,14 +212,208 @@ private:
     // Próximo ID a ser atribuído a um documento
     int nextId;
 
+    // Arquivo de índice mapeado em memória (somente leitura), quando houver
+    shared_ptr<const MappedIndex> mapped;
+
+    // Segmentos delta sobre o arquivo mapeado, do mais antigo para o mais novo
+    vector<shared_ptr<const MappedIndex>> deltas;
+
+    // Documentos de segmentos anteriores removidos (tombstones), ordenados
+    vector<uint32_t> removedIds;
+
+    // Metadados dos arquivos indexados (fase de construção)
+    vector<FileMetadata> fileMetadata;
+
+    // Número do último segmento delta incorporado ao índice
+    uint64_t segmentSequence;
+
+    /**
+     * Retorna a faixa de postings da palavra no índice congelado, ou nullptr.
+     */
+    const PostingRange* rangeOf(string_view word) const {
+        uint32_t id = frozenTerms.find(word);
+        return id == TermDictionary::NOT_FOUND ? nullptr : &frozenRanges[id];
+    }
+
+    /**
+     * Retorna o ID da primeira palavra do índice congelado, a partir de first,
+     * que não é menor que value (busca binária sobre os IDs, que seguem a
+     * ordem alfabética).
+     */
+    uint32_t lowerBoundTerm(string_view value, uint32_t first = 0) const {
+        uint32_t count = static_cast<uint32_t>(frozenTerms.size()) - first;
+        while (count > 0) {
+            uint32_t step = count / 2;
+            if (frozenTerms.term(first + step) < value) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    /**
+     * Impede alterações em um índice mapeado em memória ou já congelado.
+     */
+    void requireWritable() const {
+        if (mapped) {
+            throw runtime_error("Índice mapeado em memória é somente leitura");
+        }
+        if (frozen) {
+            throw runtime_error("Índice congelado não aceita novas palavras ou documentos");
+        }
+    }
+
+    /**
+     * Ordena por documento uma lista de postings fora de ordem, somando as
+     * frequências de documentos repetidos.
+     */
+    static void normalize(PostingBuilder& postings) {
+        vector<uint32_t>& ids = postings.docIds;
+        if (adjacent_find(ids.begin(), ids.end(), greater_equal<uint32_t>()) == ids.end()) {
+            return;
+        }
+        vector<size_t> order(ids.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ids[a] < ids[b]; });
+
+        // Início das posições de cada posting antes da reordenação
+        vector<size_t> starts;
+        if (!postings.positions.empty()) {
+            starts.resize(ids.size());
+            size_t start = 0;
+            for (size_t i = 0; i < ids.size(); ++i) {
+                starts[i] = start;
+                start += postings.frequencies[i];
+            }
+        }
+
+        // O mesmo para os deslocamentos das ocorrências
+        vector<size_t> offsetStarts;
+        if (!postings.offsets.empty()) {
+            offsetStarts.resize(ids.size());
+            size_t start = 0;
+            for (size_t i = 0; i < ids.size(); ++i) {
+                offsetStarts[i] = start;
+                start += OccurrenceOffsets::countFor(postings.frequencies[i]);
+            }
+        }
+
+        PostingBuilder sorted;
+        uint32_t keptOffsets = 0;
+        for (size_t i : order) {
+            bool repeated = !sorted.docIds.empty() && sorted.docIds.back() == ids[i];
+            sorted.add(ids[i], postings.frequencies[i]);
+            if (!starts.empty()) {
+                auto first = postings.positions.begin() + starts[i];
+                sorted.positions.insert(sorted.positions.end(), first, first + postings.frequencies[i]);
+            }
+            if (!offsetStarts.empty()) {
+                // Um documento repetido fica só com os primeiros deslocamentos
+                keptOffsets = repeated ? keptOffsets : 0;
+                uint32_t count = min(OccurrenceOffsets::countFor(postings.frequencies[i]),
+                                     OccurrenceOffsets::LIMIT - keptOffsets);
+                auto first = postings.offsets.begin() + offsetStarts[i];
+                sorted.offsets.insert(sorted.offsets.end(), first, first + count);
+                keptOffsets += count;
+            }
+        }
+        postings = move(sorted);
+    }
+
+    /**
+     * Acrescenta um segmento delta ao índice mapeado, incorporando seus
+     * tombstones e atualizando o total de palavras dos documentos vivos.
+     */
+    void addDelta(shared_ptr<const MappedIndex> delta) {
+        if (deltas.empty()) {
+            totalLength = mapped->getTotalLength();
+        }
+        totalLength += delta->getTotalLength();
+        vector<uint32_t> removed;
+        delta->forEachRecord<uint32_t>(MappedIndex::SECTION_TOMBSTONES, [&](uint32_t docId) {
+            if (!isRemoved(docId)) {
+                totalLength -= segmentOf(static_cast<int>(docId)).getDocumentLength(static_cast<int>(docId));
+                removed.push_back(docId);
+            }
+        });
+        deltas.push_back(move(delta));
+
+        sort(removed.begin(), removed.end());
+        vector<uint32_t> merged;
+        merged.reserve(removedIds.size() + removed.size());
+        merge(removedIds.begin(), removedIds.end(), removed.begin(), removed.end(), back_inserter(merged));
+        removedIds = move(merged);
+    }
+
+    /**
+     * Indica se o documento foi removido por algum segmento delta.
+     */
+    bool isRemoved(uint32_t docId) const {
+        return binary_search(removedIds.begin(), removedIds.end(), docId);
+    }
+
+    /**
+     * Retorna o segmento (base ou delta) que contém o ID de documento.
+     */
+    const MappedIndex& segmentOf(int docId) const {
+        for (size_t i = deltas.size(); i-- > 0;) {
+            if (deltas[i]->documentCount() > 0 && static_cast<int64_t>(deltas[i]->minDocumentId()) <= docId) {
+                return *deltas[i];
+            }
+        }
+        return *mapped;
+    }
+
+    /**
+     * Percorre a lista de postings da palavra em todos os segmentos, em ordem
+     * de ID, chamando callback(docId, frequência, posições codificadas) para os
+     * documentos não removidos.
+     */
+    template <typename Callback>
+    void forEachLivePosting(const string& word, Callback callback) const {
+        size_t removed = 0;
+        auto visit = [&](const MappedIndex& segment) {
+            MappedIndex::WordInfo info;
+            if (!segment.findWord(word, info)) {
+                return;
+            }
+            segment.forEachPositionedPosting(info, [&](int docId, uint32_t frequency,
+                                                       const EncodedPositions& positions) {
+                uint32_t id = static_cast<uint32_t>(docId);
+                while (removed < removedIds.size() && removedIds[removed] < id) {
+                    ++removed;
+                }
+                if (removed == removedIds.size() || removedIds[removed] != id) {
+                    callback(id, frequency, positions);
+                }
+            });
+        };
+        visit(*mapped);
+        for (const auto& delta : deltas) {
+            visit(*delta);
+        }
+    }
+
 public:
-    Index() : nextId(1) {}
+    Index() : positional(false), withOffsets(false), totalLength(0), frozen(false), nextId(1), segmentSequence(0) {}
+
+    // Não copiável (as arenas podem ser grandes); apenas movido
+    Index(const Index&) = delete;
+    Index& operator=(const Index&) = delete;
+    Index(Index&&) = default;
+    Index& operator=(Index&&) = default;
 
     /**
      * Adiciona um documento ao índice e retorna seu ID.
      * Se o documento já existe, retorna o ID existente.
      */
     int addDocument(const string& filename) {
+        requireWritable();
         if (fileToId.find(filename) != fileToId.end()) {
             return fileToId[filename];
         }
@@ -44,24 +424,626 @@ public:
         return docId;
     }
     
+    /**
+     * Faz com que os próximos documentos recebam IDs a partir de firstId.
+     * Usado ao construir um segmento delta, cujos IDs devem ser maiores que
+     * os de todos os segmentos anteriores.
+     */
+    void setFirstDocumentId(int firstId) {
+        requireWritable();
+        nextId = max(nextId, firstId);
+    }
+
+    /**
+     * Registra um documento de um segmento anterior como removido (tombstone).
+     */
+    void removeDocument(int docId) {
+        requireWritable();
+        uint32_t id = static_cast<uint32_t>(docId);
+        auto it = lower_bound(removedIds.begin(), removedIds.end(), id);
+        if (it == removedIds.end() || *it != id) {
+            removedIds.insert(it, id);
+        }
+    }
+
+    /**
+     * Registra o tamanho, a data de modificação e o hash do arquivo de um documento.
+     * Um segmento delta pode registrar metadados de documentos anteriores.
+     */
+    void addFileMetadata(const FileMetadata& metadata) {
+        requireWritable();
+        fileMetadata.push_back(metadata);
+    }
+
+    /**
+     * Define o número do segmento delta que este índice representa.
+     */
+    void setSegmentSequence(uint64_t sequence) {
+        requireWritable();
+        segmentSequence = sequence;
+    }
+
+    /**
+     * Passa a guardar a posição de cada ocorrência das palavras (índice posicional).
+     * Deve ser chamado antes de inserir palavras.
+     */
+    void enablePositions() {
+        requireWritable();
+        positional = true;
+    }
+
+    /**
+     * Indica se o índice guarda as posições das palavras nos documentos.
+     */
+    bool hasPositions() const {
+        return mapped ? mapped->hasPositions() : positional;
+    }
+
+    /**
+     * Passa a guardar os deslocamentos em bytes das primeiras ocorrências das
+     * palavras em cada documento (OccurrenceOffsets), usados nos trechos dos
+     * resultados. Deve ser chamado antes de inserir palavras.
+     */
+    void enableOffsets() {
+        requireWritable();
+        withOffsets = true;
+    }
+
+    /**
+     * Indica se o índice guarda os deslocamentos das primeiras ocorrências.
+     */
+    bool hasOffsets() const {
+        return mapped ? mapped->hasOffsets() : withOffsets;
+    }
+
     /**
      * Adiciona uma palavra a um documento no índice.
      * Se a palavra não existia, é criada uma nova entrada.
      */
-    void addWordToDocument(const string& word, int docId) {
-        invertedIndex[word].insert(docId);
+    void addWordToDocument(string_view word, int docId) {
+        requireWritable();
+        invertedIndex[word].add(static_cast<uint32_t>(docId));
+        addDocumentLength(docId, 1);
+    }
+
+    /**
+     * Adiciona a ocorrência de uma palavra na posição informada de um documento
+     * (índice posicional). As posições de um documento devem vir em ordem crescente.
+     */
+    void addWordToDocument(string_view word, int docId, uint32_t position) {
+        requireWritable();
+        invertedIndex[word].addAt(static_cast<uint32_t>(docId), position);
+        addDocumentLength(docId, 1);
+    }
+
+    /**
+     * Adiciona a ocorrência de uma palavra a um documento, com a posição (guardada
+     * se o índice é posicional) e o deslocamento em bytes da palavra no arquivo
+     * (guardado se enableOffsets foi chamado). As ocorrências de um documento
+     * devem vir em ordem.
+     */
+    void addOccurrence(string_view word, int docId, uint32_t position, uint32_t offset) {
+        requireWritable();
+        PostingBuilder& postings = invertedIndex[word];
+        if (positional) {
+            postings.addAt(static_cast<uint32_t>(docId), position);
+        } else {
+            postings.add(static_cast<uint32_t>(docId));
+        }
+        if (withOffsets) {
+            postings.addOffset(offset);
+        }
+        addDocumentLength(docId, 1);
+    }
+
+    /**
+     * Soma palavras ao tamanho de um documento. Usado por quem insere postings
+     * diretamente (mergePostings) em vez de addWordToDocument.
+     */
+    void addDocumentLength(int docId, uint32_t count) {
+        requireWritable();
+        if (documentLengths.size() <= static_cast<size_t>(docId)) {
+            documentLengths.resize(static_cast<size_t>(docId) + 1, 0);
+        }
+        documentLengths[docId] += count;
+        totalLength += count;
+    }
+
+    /**
+     * Incorpora ao índice um dicionário parcial (palavra -> documentos).
+     * As listas de palavras ainda inexistentes são movidas sem cópia; para as
+     * palavras já presentes, as listas de documentos são concatenadas.
+     * O dicionário parcial fica vazio ao final. Os tamanhos dos documentos
+     * devem ser informados à parte com addDocumentLength.
+     */
+    void mergePostings(PartialPostings& partial) {
+        requireWritable();
+        invertedIndex.merge(partial);
+    }
+
+    /**
+     * Reserva espaço no dicionário para pelo menos a quantidade de palavras informada.
+     */
+    void reserveWords(size_t count) {
+        invertedIndex.reserve(count);
+    }
+
+    /**
+     * Encerra a fase de construção: ordena cada lista de postings e copia todas
+     * (e suas frequências) para arenas contíguas de uint32_t, em ordem
+     * alfabética das palavras, que são internadas de novo nessa ordem (o ID
+     * de uma palavra passa a ser sua posição no dicionário ordenado).
+     * Depois disso o índice passa a aceitar apenas consultas.
+     */
+    void freeze() {
+        if (mapped || frozen) {
+            return;
+        }
+        ScopedTimer timer(Statistics::FREEZE);
+
+        size_t total = 0;
+        size_t totalPositions = 0;
+        size_t totalOffsets = 0;
+        for (PostingBuilder& postings : invertedIndex.postings) {
+            normalize(postings);
+            total += postings.docIds.size();
+            totalPositions += postings.positions.size();
+            totalOffsets += postings.offsets.size();
+        }
+
+        const TermDictionary& terms = invertedIndex.terms;
+        vector<uint32_t> order(terms.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return terms.term(a) < terms.term(b); });
+
+        postingArena.reserve(total);
+        frequencyArena.reserve(total);
+        positionArena.reserve(totalPositions);
+        offsetArena.reserve(totalOffsets);
+        frozenTerms.reserve(terms.size(), terms.byteCount());
+        frozenRanges.reserve(terms.size());
+        for (uint32_t id : order) {
+            PostingBuilder& postings = invertedIndex.postings[id];
+            PostingRange range = {postingArena.size(), static_cast<uint32_t>(postings.docIds.size()),
+                                  positionArena.size(), offsetArena.size()};
+            postingArena.insert(postingArena.end(), postings.docIds.begin(), postings.docIds.end());
+            frequencyArena.insert(frequencyArena.end(), postings.frequencies.begin(), postings.frequencies.end());
+            positionArena.insert(positionArena.end(), postings.positions.begin(), postings.positions.end());
+            offsetArena.insert(offsetArena.end(), postings.offsets.begin(), postings.offsets.end());
+            frozenTerms.intern(terms.term(id));
+            frozenRanges.push_back(range);
+            // Libera a lista assim que copiada, para não dobrar o pico de memória
+            postings = PostingBuilder();
+        }
+        invertedIndex.clear();
+        frozen = true;
+    }
+
+    /**
+     * Memória aproximada do dicionário e das listas em construção (capacidade
+     * dos vetores). Percorre todas as palavras; é medida entre lotes de
+     * arquivos, não a cada inserção.
+     */
+    size_t buildingMemory() const {
+        if (invertedIndex.empty()) {
+            return 0;
+        }
+        size_t building = invertedIndex.terms.memoryBytes() + invertedIndex.postings.capacity() * sizeof(PostingBuilder);
+        for (const PostingBuilder& postings : invertedIndex.postings) {
+            building += (postings.docIds.capacity() + postings.frequencies.capacity() +
+                         postings.positions.capacity() + postings.offsets.capacity()) * sizeof(uint32_t);
+        }
+        return building;
+    }
+
+    /**
+     * Entrega as listas em construção em ordem alfabética das palavras,
+     * chamando callback(palavra, postings) com cada lista já ordenada como no
+     * congelamento, e as descarta, liberando a memória; os documentos (nomes,
+     * tamanhos e metadados) continuam no índice, que segue recebendo palavras.
+     * É assim que a construção com orçamento de memória grava suas partes.
+     */
+    template <typename Callback>
+    void drainPostings(Callback callback) {
+        requireWritable();
+        const TermDictionary& terms = invertedIndex.terms;
+        vector<uint32_t> order(terms.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return terms.term(a) < terms.term(b); });
+        for (uint32_t id : order) {
+            PostingBuilder& postings = invertedIndex.postings[id];
+            normalize(postings);
+            callback(terms.term(id), static_cast<const PostingBuilder&>(postings));
+            postings = PostingBuilder();
+        }
+        invertedIndex.clear();
+    }
+
+    /**
+     * Indica se o índice está pronto para consultas (congelado ou mapeado).
+     */
+    bool isFrozen() const {
+        return frozen || mapped != nullptr;
     }
    
     /**
-     * Retorna o conjunto de IDs de documentos que contêm a palavra.
-     * Se a palavra não existe, retorna um conjunto vazio.
+     * Retorna os IDs de documentos (ordenados) que contêm a palavra, sem cópia.
+     * Em um índice congelado a visão aponta para a arena; em um índice mapeado
+     * as postings são decodificadas em scratch, que deve sobreviver à visão.
+     * Se a palavra não existe, retorna uma visão vazia.
+     * Lança uma exceção se o índice ainda estiver na fase de construção.
      */
-    set<int> getDocumentsForWord(const string& word) const {
-        auto it = invertedIndex.find(word);
-        if (it != invertedIndex.end()) {
-            return it->second;
+    PostingSpan getPostings(const string& word, vector<uint32_t>& scratch) const {
+        ScopedTimer timer(Statistics::POSTINGS_LOOKUP);
+        if (mapped && !deltas.empty()) {
+            scratch.clear();
+            forEachLivePosting(word, [&](uint32_t docId, uint32_t, const EncodedPositions&) {
+                scratch.push_back(docId);
+            });
+            return PostingSpan(scratch);
+        }
+        if (mapped) {
+            return mapped->getPostings(word, scratch);
+        }
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+        if (const PostingRange* range = rangeOf(word)) {
+            return PostingSpan(postingArena.data() + range->offset, range->count);
+        }
+        return PostingSpan();
+    }
+
+    /**
+     * Retorna os documentos que contêm a palavra e a frequência dela em cada um,
+     * sem cópia no índice congelado (ver getPostings).
+     */
+    PostingList getPostingList(const string& word, PostingScratch& scratch) const {
+        ScopedTimer timer(Statistics::POSTINGS_LOOKUP);
+        if (mapped && !deltas.empty()) {
+            scratch.docIds.clear();
+            scratch.frequencies.clear();
+            forEachLivePosting(word, [&](uint32_t docId, uint32_t frequency, const EncodedPositions&) {
+                scratch.docIds.push_back(docId);
+                scratch.frequencies.push_back(frequency);
+            });
+            return {PostingSpan(scratch.docIds), PostingSpan(scratch.frequencies)};
+        }
+        if (mapped) {
+            return mapped->getPostingList(word, scratch);
+        }
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+        PostingList list;
+        if (const PostingRange* range = rangeOf(word)) {
+            list.docIds = PostingSpan(postingArena.data() + range->offset, range->count);
+            list.frequencies = PostingSpan(frequencyArena.data() + range->offset, range->count);
+        }
+        return list;
+    }
+
+    /**
+     * Indica se getPostingBitmap pode ler listas em PostingBitmap: o índice
+     * foi aberto de um arquivo com a seção de bitmaps e não tem segmentos delta.
+     */
+    bool hasPostingBitmaps() const {
+        return mapped && deltas.empty() && mapped->hasPostingBitmaps();
+    }
+
+    /**
+     * Lê a lista da palavra em PostingBitmap, sem decodificar as postings,
+     * quando a palavra é densa e o arquivo guarda a lista nesse formato (ver
+     * hasPostingBitmaps). Retorna false caso contrário; a lista continua
+     * disponível em getPostings.
+     */
+    bool getPostingBitmap(const string& word, PostingBitmap& bitmap) const {
+        if (!hasPostingBitmaps()) {
+            return false;
+        }
+        ScopedTimer timer(Statistics::POSTINGS_LOOKUP);
+        return mapped->getPostingBitmap(word, bitmap);
+    }
+
+    /**
+     * Abre um cursor sobre a lista da palavra (ver PostingCursor). Quando o
+     * arquivo mapeado guarda os blocos da lista, nada é decodificado aqui: cada
+     * bloco é decodificado quando o cursor chega a ele. Caso contrário a lista
+     * é lida inteira e, com bounds, os resumos dos blocos são calculados dela.
+     */
+    PostingCursor getPostingCursor(const string& word, bool bounds) const {
+        if (mapped && deltas.empty()) {
+            vector<PostingBlock> blocks;
+            if (mapped->getPostingBlocks(word, blocks)) {
+                return PostingCursor(*mapped, move(blocks), getDocumentFrequency(word));
+            }
+        }
+        PostingScratch scratch;
+        PostingList list = getPostingList(word, scratch);
+        vector<PostingBlock> blocks;
+        if (bounds) {
+            blocks.reserve(PostingBlocks::countFor(list.docIds.size()));
+            PostingBlocks::summarize(list, [&](uint32_t docId) {
+                return getDocumentLength(static_cast<int>(docId));
+            }, blocks);
+        }
+        return PostingCursor(list, move(scratch), move(blocks));
+    }
+
+    /**
+     * Retorna os documentos que contêm a palavra, com as frequências e o acesso
+     * às posições de cada documento, decodificadas só quando pedidas
+     * (PositionalList::positions). Os buffers de scratch devem sobreviver à lista.
+     * Lança uma exceção se o índice não guarda posições.
+     */
+    PositionalList getPositionalList(const string& word, PositionScratch& scratch) const {
+        if (!hasPositions()) {
+            throw runtime_error("O índice não guarda posições; construa-o com construir --posicoes");
+        }
+        ScopedTimer timer(Statistics::POSTINGS_LOOKUP);
+        if (mapped && !deltas.empty()) {
+            scratch.docIds.clear();
+            scratch.frequencies.clear();
+            scratch.encoded.clear();
+            forEachLivePosting(word, [&](uint32_t docId, uint32_t frequency, const EncodedPositions& positions) {
+                scratch.docIds.push_back(docId);
+                scratch.frequencies.push_back(frequency);
+                scratch.encoded.push_back(positions);
+            });
+            PositionalList list;
+            list.docIds = PostingSpan(scratch.docIds);
+            list.frequencies = PostingSpan(scratch.frequencies);
+            list.encoded = scratch.encoded.data();
+            return list;
+        }
+        if (mapped) {
+            return mapped->getPositionalList(word, scratch);
+        }
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+
+        PositionalList list;
+        const PostingRange* found = rangeOf(word);
+        if (found == nullptr) {
+            return list;
+        }
+        const PostingRange& range = *found;
+        list.docIds = PostingSpan(postingArena.data() + range.offset, range.count);
+        list.frequencies = PostingSpan(frequencyArena.data() + range.offset, range.count);
+        scratch.rawOffsets.resize(range.count);
+        uint64_t start = 0;
+        for (size_t i = 0; i < range.count; ++i) {
+            scratch.rawOffsets[i] = start;
+            start += list.frequencies[i];
+        }
+        list.rawPositions = positionArena.data() + range.positionOffset;
+        list.rawOffsets = scratch.rawOffsets.data();
+        return list;
+    }
+
+    /**
+     * Para cada documento de docIds (em ordem crescente), preenche offsets[i]
+     * com os deslocamentos em bytes das primeiras ocorrências da palavra no
+     * arquivo (OccurrenceOffsets), ou o deixa vazio se a palavra não ocorre no
+     * documento. A lista da palavra é percorrida uma vez.
+     * Lança uma exceção se o índice não guarda deslocamentos.
+     */
+    void getOccurrenceOffsets(const string& word, const vector<uint32_t>& docIds,
+                              vector<vector<uint32_t>>& offsets) const {
+        if (!hasOffsets()) {
+            throw runtime_error("O índice não guarda os deslocamentos das palavras; construa-o com construir --trechos");
+        }
+        ScopedTimer timer(Statistics::POSTINGS_LOOKUP);
+        offsets.assign(docIds.size(), {});
+        size_t next = 0;
+        if (mapped) {
+            forEachLivePosting(word, [&](uint32_t docId, uint32_t frequency, const EncodedPositions& encoded) {
+                while (next < docIds.size() && docIds[next] < docId) {
+                    ++next;
+                }
+                if (next < docIds.size() && docIds[next] == docId) {
+                    encoded.decodeOffsets(frequency, offsets[next]);
+                }
+            });
+            return;
+        }
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+        const PostingRange* range = rangeOf(word);
+        if (range == nullptr) {
+            return;
+        }
+        const uint32_t* first = offsetArena.data() + range->offsetStart;
+        for (size_t i = 0; i < range->count && next < docIds.size(); ++i) {
+            uint32_t docId = postingArena[range->offset + i];
+            uint32_t count = OccurrenceOffsets::countFor(frequencyArena[range->offset + i]);
+            while (next < docIds.size() && docIds[next] < docId) {
+                ++next;
+            }
+            if (next < docIds.size() && docIds[next] == docId) {
+                offsets[next].assign(first, first + count);
+            }
+            first += count;
+        }
+    }
+
+    /**
+     * Retorna, em ordem alfabética, até limit palavras do dicionário que casam
+     * com o padrão. Só o intervalo de palavras com o prefixo literal do padrão
+     * é percorrido: busca binária no dicionário ordenado (arquivo mapeado ou
+     * IDs do índice congelado) mais o tamanho do intervalo. Com segmentos delta, cada
+     * segmento contribui com até limit palavras e o resultado é a união.
+     * Lança uma exceção se o índice ainda estiver na fase de construção.
+     */
+    vector<string> findWords(const WildcardPattern& pattern, size_t limit) const {
+        vector<string> words;
+        if (limit == 0) {
+            return words;
+        }
+        const string& prefix = pattern.prefix();
+        if (mapped) {
+            auto collect = [&](const MappedIndex& segment) {
+                size_t found = 0;
+                segment.forEachWordWithPrefix(prefix, [&](const string& word, const MappedIndex::WordInfo&) {
+                    if (pattern.matches(word)) {
+                        words.push_back(word);
+                        ++found;
+                    }
+                    return found < limit;
+                });
+            };
+            collect(*mapped);
+            if (!deltas.empty()) {
+                for (const auto& delta : deltas) {
+                    collect(*delta);
+                }
+                sort(words.begin(), words.end());
+                words.erase(unique(words.begin(), words.end()), words.end());
+                if (words.size() > limit) {
+                    words.resize(limit);
+                }
+            }
+            return words;
         }
-        return set<int>();
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+        for (uint32_t id = lowerBoundTerm(prefix); id < frozenTerms.size() && words.size() < limit; ++id) {
+            string_view word = frozenTerms.term(id);
+            if (word.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+            if (pattern.matches(word)) {
+                words.emplace_back(word);
+            }
+        }
+        return words;
+    }
+
+    /**
+     * Retorna, em ordem alfabética, até limit palavras do dicionário a no
+     * máximo maxDistance edições de word. O dicionário ordenado é percorrido
+     * por um autômato de Levenshtein que salta os intervalos de palavras cujo
+     * prefixo já está longe demais, como em um percurso de trie. Com segmentos
+     * delta, o resultado é a união dos segmentos.
+     * Lança uma exceção se o índice ainda estiver na fase de construção.
+     */
+    vector<string> findSimilarWords(const string& word, uint32_t maxDistance, size_t limit) const {
+        vector<string> words;
+        if (limit == 0) {
+            return words;
+        }
+        if (mapped) {
+            auto collect = [&](const MappedIndex& segment) {
+                LevenshteinAutomaton automaton(word, maxDistance);
+                size_t found = 0;
+                segment.scanWords("", [&](const string& candidate, const MappedIndex::WordInfo&, string& seek) {
+                    if (automaton.accepts(candidate, seek)) {
+                        words.push_back(candidate);
+                        ++found;
+                    }
+                    return found < limit;
+                });
+            };
+            collect(*mapped);
+            if (!deltas.empty()) {
+                for (const auto& delta : deltas) {
+                    collect(*delta);
+                }
+                sort(words.begin(), words.end());
+                words.erase(unique(words.begin(), words.end()), words.end());
+                if (words.size() > limit) {
+                    words.resize(limit);
+                }
+            }
+            return words;
+        }
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+        LevenshteinAutomaton automaton(word, maxDistance);
+        string seek;
+        uint32_t id = 0;
+        while (id < frozenTerms.size() && words.size() < limit) {
+            seek.clear();
+            string_view candidate = frozenTerms.term(id);
+            if (automaton.accepts(candidate, seek)) {
+                words.emplace_back(candidate);
+            }
+            id = seek.empty() ? id + 1 : lowerBoundTerm(seek, id + 1);
+        }
+        return words;
+    }
+
+    /**
+     * Retorna a quantidade de documentos que contêm a palavra, lida do
+     * dicionário sem decodificar a lista. Com segmentos delta é uma estimativa
+     * por cima: soma os segmentos e não desconta os documentos removidos.
+     */
+    size_t getDocumentFrequency(const string& word) const {
+        if (mapped) {
+            size_t count = 0;
+            MappedIndex::WordInfo info;
+            if (mapped->findWord(word, info)) {
+                count += info.docFreq;
+            }
+            for (const auto& delta : deltas) {
+                if (delta->findWord(word, info)) {
+                    count += info.docFreq;
+                }
+            }
+            return count;
+        }
+        if (!frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes das consultas");
+        }
+        const PostingRange* range = rangeOf(word);
+        return range == nullptr ? 0 : range->count;
+    }
+
+    /**
+     * Retorna a quantidade de documentos indexados.
+     */
+    size_t getDocumentCount() const {
+        if (mapped) {
+            size_t count = mapped->documentCount();
+            for (const auto& delta : deltas) {
+                count += delta->documentCount();
+            }
+            return count - removedIds.size();
+        }
+        return idToFile.size();
+    }
+
+    /**
+     * Retorna o tamanho do documento (quantidade de palavras indexadas),
+     * ou 0 se desconhecido.
+     */
+    uint32_t getDocumentLength(int docId) const {
+        if (mapped) {
+            return segmentOf(docId).getDocumentLength(docId);
+        }
+        if (docId < 0 || static_cast<size_t>(docId) >= documentLengths.size()) {
+            return 0;
+        }
+        return documentLengths[docId];
+    }
+
+    /**
+     * Retorna o tamanho médio dos documentos, ou 0 se desconhecido.
+     */
+    double getAverageDocumentLength() const {
+        size_t count = getDocumentCount();
+        return count == 0 ? 0.0 : static_cast<double>(getTotalDocumentLength()) / count;
+    }
+
+    /**
+     * Retorna a soma dos tamanhos dos documentos.
+     */
+    uint64_t getTotalDocumentLength() const {
+        return (mapped && deltas.empty()) ? mapped->getTotalLength() : totalLength;
     }
     
     /**
@@ -69,6 +1051,12 @@ public:
      * Se o ID não existe, retorna string vazia.
      */
     string getFileName(int docId) const {
+        if (mapped) {
+            if (docId < 0 || isRemoved(static_cast<uint32_t>(docId))) {
+                return "";
+            }
+            return segmentOf(docId).getFileName(docId);
+        }
         auto it = idToFile.find(docId);
         if (it != idToFile.end()) {
             return it->second;
@@ -81,6 +1069,17 @@ public:
      * Se o arquivo não existe, retorna -1.
      */
     int getFileId(const string& filename) const {
+        if (mapped) {
+            // Um arquivo modificado aparece em vários segmentos; vale o mais novo
+            for (size_t i = deltas.size() + 1; i-- > 0;) {
+                const MappedIndex& segment = (i == 0) ? *mapped : *deltas[i - 1];
+                int docId = segment.getFileId(filename);
+                if (docId >= 0 && !isRemoved(static_cast<uint32_t>(docId))) {
+                    return docId;
+                }
+            }
+            return -1;
+        }
         auto it = fileToId.find(filename);
         if (it != fileToId.end()) {
             return it->second;
@@ -93,6 +1092,18 @@ public:
      */
     set<int> getAllDocumentIds() const {
         set<int> allIds;
+        if (mapped) {
+            auto visit = [&](int docId, string_view) {
+                if (!isRemoved(static_cast<uint32_t>(docId))) {
+                    allIds.insert(allIds.end(), docId);
+                }
+            };
+            mapped->forEachDocument(visit);
+            for (const auto& delta : deltas) {
+                delta->forEachDocument(visit);
+            }
+            return allIds;
+        }
         for (const auto& pair : idToFile) {
             allIds.insert(pair.first);
         }
@@ -104,13 +1115,158 @@ public:
      */
     vector<string> getAllWords() const {
         vector<string> words;
-        for (const auto& pair : invertedIndex) {
-            words.push_back(pair.first);
+        if (mapped) {
+            words.reserve(mapped->wordCount());
+            mapped->forEachWord([&](const string& word, const MappedIndex::WordInfo&) { words.push_back(word); });
+            if (!deltas.empty()) {
+                // Palavras presentes em mais de um segmento aparecem uma vez
+                for (const auto& delta : deltas) {
+                    delta->forEachWord([&](const string& word, const MappedIndex::WordInfo&) { words.push_back(word); });
+                }
+                sort(words.begin(), words.end());
+                words.erase(unique(words.begin(), words.end()), words.end());
+            }
+            return words;
+        }
+        words.reserve(invertedIndex.size() + frozenTerms.size());
+        for (uint32_t id = 0; id < invertedIndex.terms.size(); ++id) {
+            words.emplace_back(invertedIndex.terms.term(id));
+        }
+        for (uint32_t id = 0; id < frozenTerms.size(); ++id) {
+            words.emplace_back(frozenTerms.term(id));
         }
         return words;
     }
     
+    /**
+     * Retorna os metadados dos arquivos dos documentos não removidos, ordenados
+     * por ID. Quando um documento tem metadados em vários segmentos, vale o
+     * registro do segmento mais novo. Documentos sem metadados (índices
+     * gerados por versões anteriores) não aparecem.
+     */
+    vector<FileMetadata> getFileMetadata() const {
+        vector<FileMetadata> latest;
+        auto collect = [&](const FileMetadata& metadata) {
+            if (!isRemoved(metadata.docId)) {
+                latest.push_back(metadata);
+            }
+        };
+        if (mapped) {
+            mapped->forEachRecord<FileMetadata>(MappedIndex::SECTION_FILE_METADATA, collect);
+            for (const auto& delta : deltas) {
+                delta->forEachRecord<FileMetadata>(MappedIndex::SECTION_FILE_METADATA, collect);
+            }
+        } else {
+            for_each(fileMetadata.begin(), fileMetadata.end(), collect);
+        }
+
+        // Ordenação estável: entre registros do mesmo documento, o último é o mais novo
+        stable_sort(latest.begin(), latest.end(), [](const FileMetadata& a, const FileMetadata& b) {
+            return a.docId < b.docId;
+        });
+        vector<FileMetadata> result;
+        result.reserve(latest.size());
+        for (const FileMetadata& metadata : latest) {
+            if (!result.empty() && result.back().docId == metadata.docId) {
+                result.back() = metadata;
+            } else {
+                result.push_back(metadata);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Retorna o ID que o próximo documento (ou o próximo segmento delta) deve
+     * usar: maior que qualquer ID já gravado, inclusive de documentos removidos.
+     */
+    int getNextDocumentId() const {
+        if (!mapped) {
+            return nextId;
+        }
+        uint32_t maxId = mapped->maxDocumentId();
+        for (const auto& delta : deltas) {
+            maxId = max(maxId, delta->maxDocumentId());
+        }
+        return static_cast<int>(maxId) + 1;
+    }
+
+    /**
+     * Indica se o índice foi aberto de um arquivo versão 2 mapeado em memória.
+     */
+    bool isMapped() const {
+        return mapped != nullptr;
+    }
+
+    /**
+     * Retorna a quantidade de segmentos delta sobre o arquivo base.
+     */
+    size_t getDeltaCount() const {
+        return deltas.size();
+    }
+
+    /**
+     * Retorna o número do último segmento delta incorporado ao índice.
+     */
+    uint64_t getSegmentSequence() const {
+        if (!mapped) {
+            return segmentSequence;
+        }
+        return deltas.empty() ? mapped->segmentSequence() : deltas.back()->segmentSequence();
+    }
+
+    /**
+     * Memória aproximada de cada estrutura do índice, para o relatório de
+     * estatísticas (--stats): capacidade dos vetores e, nas tabelas hash, nós
+     * e baldes estimados. Arquivos mapeados contam pelo tamanho, embora só as
+     * páginas já lidas ocupem memória de fato. Estruturas vazias são omitidas.
+     */
+    vector<MemoryItem> memoryUsage() const {
+        // Nó de unordered_map: próximo nó, valor e hash guardado
+        const size_t nodeOverhead = sizeof(void*) + sizeof(size_t);
+        auto heapBytes = [](const string& text) {
+            return text.capacity() > 15 ? text.capacity() + 1 : 0;
+        };
+
+        size_t building = buildingMemory();
+        size_t names = 0;
+        if (!idToFile.empty()) {
+            names = (idToFile.bucket_count() + fileToId.bucket_count()) * sizeof(void*) +
+                    idToFile.size() * (sizeof(pair<const int, string>) + nodeOverhead) +
+                    fileToId.size() * (sizeof(pair<const string, int>) + nodeOverhead);
+            for (const auto& entry : idToFile) {
+                names += heapBytes(entry.second);
+            }
+            for (const auto& entry : fileToId) {
+                names += heapBytes(entry.first);
+            }
+        }
+        size_t mappedBytes = mapped ? mapped->byteCount() : 0;
+        for (const auto& delta : deltas) {
+            mappedBytes += delta->byteCount();
+        }
+
+        vector<MemoryItem> items = {
+            {"construcao", "dicionário e postings da construção", building},
+            {"dicionario", "dicionário de termos", frozenTerms.empty() ? 0 : frozenTerms.memoryBytes()},
+            {"faixas_postings", "faixas das postings", frozenRanges.capacity() * sizeof(PostingRange)},
+            {"postings", "postings", postingArena.capacity() * sizeof(uint32_t)},
+            {"frequencias", "frequências", frequencyArena.capacity() * sizeof(uint32_t)},
+            {"posicoes", "posições", positionArena.capacity() * sizeof(uint32_t)},
+            {"deslocamentos", "deslocamentos das ocorrências", offsetArena.capacity() * sizeof(uint32_t)},
+            {"tamanhos_documentos", "tamanhos dos documentos", documentLengths.capacity() * sizeof(uint32_t)},
+            {"nomes_arquivos", "nomes dos arquivos", names},
+            {"metadados", "metadados e tombstones",
+             fileMetadata.capacity() * sizeof(FileMetadata) + removedIds.capacity() * sizeof(uint32_t)},
+            {"arquivos_mapeados", "arquivos mapeados (base e deltas)", mappedBytes},
+        };
+        items.erase(remove_if(items.begin(), items.end(), [](const MemoryItem& item) { return item.bytes == 0; }),
+                    items.end());
+        return items;
+    }
+
     friend class Serializer;
+    friend class IndexFileWriter;
 };
 
-#endif
\ No newline at end of file
+#endif
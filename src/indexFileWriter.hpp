@@ -0,0 +1,476 @@
+#ifndef INDEXFILEWRITER_HPP
+#define INDEXFILEWRITER_HPP
+
+#include "index.hpp"
+#include "mappedIndex.hpp"
+#include "varByte.hpp"
+#include "postingBlocks.hpp"
+#include "postingBitmap.hpp"
+#include "positionalList.hpp"
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+
+using namespace std;
+
+/**
+ * Grava um arquivo de índice versão 2 (ver IndexFileHeader) palavra por
+ * palavra, em ordem alfabética. Os documentos (nomes, tamanhos, metadados e
+ * tombstones) vêm do Index informado; a lista de cada palavra é entregue
+ * entre beginWord e endWord, em uma ou mais partes em ordem de ID
+ * (addPostings).
+ *
+ * É usado por Serializer::serialize, com as listas do índice congelado, e
+ * pela construção com orçamento de memória (SpimiBuilder), com as listas
+ * reunidas das partes gravadas em disco. Com spool, as postings, as posições
+ * e os deslocamentos, que crescem com a coleção, são descarregados em arquivos
+ * temporários ao lado do índice a cada SPOOL_CHUNK bytes e copiados para ele
+ * no final; sem spool, ficam em memória. O arquivo gerado é o mesmo.
+ *
+ * O índice é gravado em "<arquivo>.tmp" e só substitui o arquivo no final de
+ * finish, com um rename: quem tem o índice antigo mapeado (servir, lote)
+ * continua lendo o arquivo antigo, e uma gravação interrompida não deixa um
+ * índice truncado no lugar dele.
+ */
+class IndexFileWriter {
+public:
+    // Bytes acumulados em memória antes de descarregar um fluxo no arquivo temporário
+    static constexpr size_t SPOOL_CHUNK = 1 << 20;
+
+    /**
+     * Prepara a gravação do índice em filename. O índice fornece os
+     * documentos; suas listas de postings não são lidas.
+     * Lança uma exceção se não conseguir abrir o arquivo.
+     */
+    IndexFileWriter(const Index& index, const string& filename, bool spool)
+        : index(index), filename(filename), temporary(filename + ".tmp"), file(temporary, ios::binary),
+          postings(spool ? filename + ".tmp.postings" : ""), positions(spool ? filename + ".tmp.posicoes" : ""),
+          offsets(spool ? filename + ".tmp.deslocamentos" : ""), wordCount(0), docFreq(0), posting(0),
+          lastDocId(0), lastPositionStart(0), lastOffsetStart(0), block({0, 0, UINT32_MAX, 0, 0}), blockFill(0),
+          dense(false) {
+        if (!file) {
+            throw runtime_error("Não foi possível abrir o arquivo para escrita: " + temporary);
+        }
+
+        vector<const pair<const int, string>*> documents;
+        documents.reserve(index.idToFile.size());
+        for (const auto& entry : index.idToFile) {
+            documents.push_back(&entry);
+        }
+        sort(documents.begin(), documents.end(), [](const auto* a, const auto* b) {
+            return a->first < b->first;
+        });
+
+        // Tabela de documentos e nomes dos arquivos
+        docTable.reserve(documents.size());
+        for (const auto* entry : documents) {
+            DocumentEntry doc;
+            doc.docId = static_cast<uint32_t>(entry->first);
+            doc.nameLength = static_cast<uint32_t>(entry->second.size());
+            doc.nameOffset = names.size();
+            docTable.push_back(doc);
+            names += entry->second;
+        }
+    }
+
+    ~IndexFileWriter() {
+        postings.remove();
+        positions.remove();
+        offsets.remove();
+        // Sem finish (ou se ele falhou), o arquivo parcial é descartado
+        file.close();
+        error_code ec;
+        filesystem::remove(temporary, ec);
+    }
+
+    IndexFileWriter(const IndexFileWriter&) = delete;
+    IndexFileWriter& operator=(const IndexFileWriter&) = delete;
+
+    /**
+     * Começa a lista de uma palavra, maior que a anterior, que terá count
+     * documentos ao todo.
+     */
+    void beginWord(string_view word, size_t count) {
+        size_t prefix = 0;
+        if (wordCount % MappedIndex::BLOCK_SIZE == 0) {
+            blockOffsets.push_back(dictionary.size());
+        } else {
+            size_t limit = min(previous.size(), word.size());
+            while (prefix < limit && previous[prefix] == word[prefix]) {
+                ++prefix;
+            }
+        }
+        VarByte::encode(prefix, dictionary);
+        VarByte::encode(word.size() - prefix, dictionary);
+        dictionary.append(word.substr(prefix));
+        VarByte::encode(count, dictionary);
+        VarByte::encode(postings.size(), dictionary);
+        if (count > PostingBlocks::SIZE) {
+            blockEntries.push_back({postings.size(), blocks.size()});
+        }
+        dense = PostingBitmap::isDense(count, docTable.size());
+        if (dense) {
+            bitmapEntries.push_back({postings.size(), bitmaps.size(), 0});
+        }
+        previous.assign(word.data(), word.size());
+        ++wordCount;
+        docFreq = count;
+        posting = 0;
+        lastDocId = 0;
+        lastPositionStart = 0;
+        lastOffsetStart = 0;
+        block = {0, 0, UINT32_MAX, 0, 0};
+        blockFill = 0;
+        denseDocIds.clear();
+    }
+
+    /**
+     * Acrescenta à palavra atual os documentos docIds (maiores que os já
+     * entregues), com a frequência de cada um e, conforme o índice, as
+     * posições (frequencies[i] por documento) e os deslocamentos das primeiras
+     * ocorrências (OccurrenceOffsets::countFor(frequencies[i]) por documento).
+     */
+    void addPostings(PostingSpan docIds, const uint32_t* frequencies, const uint32_t* wordPositions,
+                     const uint32_t* wordOffsets) {
+        bool summarize = docFreq > PostingBlocks::SIZE;
+        if (dense) {
+            denseDocIds.insert(denseDocIds.end(), docIds.begin(), docIds.end());
+        }
+        for (size_t j = 0; j < docIds.size(); ++j) {
+            if (summarize && blockFill == 0) {
+                block.postingsOffset = postings.size();
+            }
+            VarByte::encode(docIds[j] - lastDocId, postings.buffer);
+            VarByte::encode(frequencies[j], postings.buffer);
+            lastDocId = docIds[j];
+            if (index.positional) {
+                // Início das posições do documento, relativo ao da posting anterior
+                VarByte::encode(positions.size() - lastPositionStart, postings.buffer);
+                lastPositionStart = positions.size();
+                uint32_t lastPosition = 0;
+                for (uint32_t k = 0; k < frequencies[j]; ++k) {
+                    VarByte::encode(wordPositions[k] - lastPosition, positions.buffer);
+                    lastPosition = wordPositions[k];
+                }
+                wordPositions += frequencies[j];
+            }
+            if (index.withOffsets) {
+                // Início dos deslocamentos do documento, como o das posições
+                VarByte::encode(offsets.size() - lastOffsetStart, postings.buffer);
+                lastOffsetStart = offsets.size();
+                uint32_t lastOffset = 0;
+                for (uint32_t k = OccurrenceOffsets::countFor(frequencies[j]); k > 0; --k) {
+                    VarByte::encode(*wordOffsets - lastOffset, offsets.buffer);
+                    lastOffset = *wordOffsets++;
+                }
+            }
+            if (summarize) {
+                // Resumo do bloco, como em PostingBlocks::summarize
+                block.lastDocId = docIds[j];
+                block.maxFrequency = max(block.maxFrequency, frequencies[j]);
+                block.minLength = min(block.minLength, index.getDocumentLength(static_cast<int>(docIds[j])));
+                if (++blockFill == PostingBlocks::SIZE) {
+                    blocks.push_back(block);
+                    block = {0, 0, UINT32_MAX, 0, 0};
+                    blockFill = 0;
+                }
+            }
+        }
+        posting += docIds.size();
+        postings.spill();
+        positions.spill();
+        offsets.spill();
+    }
+
+    /**
+     * Termina a lista da palavra atual.
+     * Lança uma exceção se ela não teve a quantidade de documentos anunciada.
+     */
+    void endWord() {
+        if (posting != docFreq) {
+            throw runtime_error("Lista de postings com tamanho diferente do anunciado: " + previous);
+        }
+        if (blockFill > 0) {
+            blocks.push_back(block);
+        }
+        if (dense) {
+            PostingBitmapEntry& entry = bitmapEntries.back();
+            PostingBitmap::fromSorted(PostingSpan(denseDocIds)).serialize(bitmaps);
+            entry.size = bitmaps.size() - entry.offset;
+            denseDocIds = vector<uint32_t>();
+        }
+    }
+
+    /**
+     * Grava o arquivo: cabeçalho, tabelas, dicionário, postings e seções, e
+     * o coloca no lugar do anterior.
+     * Lança uma exceção se a gravação falhar.
+     */
+    void finish() {
+        // Seções opcionais, gravadas depois das postings
+        vector<pair<uint32_t, Spool*>> sections;
+        deque<Spool> built;
+        auto addSection = [&](uint32_t type, string content) {
+            built.emplace_back("");
+            built.back().buffer = move(content);
+            sections.emplace_back(type, &built.back());
+        };
+        addSection(MappedIndex::SECTION_DOCUMENT_LENGTHS, documentLengthsSection());
+        vector<FileMetadata> metadata = index.getFileMetadata();
+        if (!metadata.empty()) {
+            addSection(MappedIndex::SECTION_FILE_METADATA, recordsSection(metadata));
+        }
+        if (!index.removedIds.empty()) {
+            addSection(MappedIndex::SECTION_TOMBSTONES, recordsSection(index.removedIds));
+        }
+        if (index.positional) {
+            sections.emplace_back(MappedIndex::SECTION_POSITIONS, &positions);
+        }
+        if (index.segmentSequence > 0) {
+            addSection(MappedIndex::SECTION_SEGMENT, recordsSection(vector<uint64_t>{index.segmentSequence}));
+        }
+        if (!blockEntries.empty()) {
+            uint64_t count = blockEntries.size();
+            string section(reinterpret_cast<const char*>(&count), sizeof(count));
+            section += recordsSection(blockEntries);
+            section += recordsSection(blocks);
+            vector<PostingBlockEntry>().swap(blockEntries);
+            vector<PostingBlock>().swap(blocks);
+            addSection(MappedIndex::SECTION_POSTING_BLOCKS, move(section));
+        }
+        if (index.withOffsets) {
+            sections.emplace_back(MappedIndex::SECTION_OCCURRENCE_OFFSETS, &offsets);
+        }
+        if (!bitmapEntries.empty()) {
+            uint64_t count = bitmapEntries.size();
+            string section(reinterpret_cast<const char*>(&count), sizeof(count));
+            section += recordsSection(bitmapEntries);
+            section += bitmaps;
+            vector<PostingBitmapEntry>().swap(bitmapEntries);
+            string().swap(bitmaps);
+            addSection(MappedIndex::SECTION_POSTING_BITMAPS, move(section));
+        }
+
+        IndexFileHeader header = {};
+        copy(begin(MappedIndex::MAGIC), end(MappedIndex::MAGIC), header.magic);
+        header.version = MappedIndex::VERSION;
+        header.flags = MappedIndex::FLAG_FREQUENCIES | MappedIndex::FLAG_SECTIONS;
+        if (index.positional) {
+            header.flags |= MappedIndex::FLAG_POSITIONS;
+        }
+        if (index.withOffsets) {
+            header.flags |= MappedIndex::FLAG_OFFSETS;
+        }
+        header.blockSize = MappedIndex::BLOCK_SIZE;
+        header.numDocuments = docTable.size();
+        header.numWords = wordCount;
+        header.numBlocks = blockOffsets.size();
+        header.docTableOffset = sizeof(IndexFileHeader) + sizeof(uint64_t) + sections.size() * sizeof(SectionEntry);
+        header.namesOffset = header.docTableOffset + docTable.size() * sizeof(DocumentEntry);
+        // Alinha o índice de blocos em 8 bytes
+        header.blockIndexOffset = align8(header.namesOffset + names.size());
+        header.dictionaryOffset = header.blockIndexOffset + blockOffsets.size() * sizeof(uint64_t);
+        header.postingsOffset = header.dictionaryOffset + dictionary.size();
+
+        vector<SectionEntry> directory;
+        uint64_t offset = header.postingsOffset + postings.size();
+        for (const auto& section : sections) {
+            offset = align8(offset);
+            directory.push_back({section.first, 0, offset, section.second->size()});
+            offset += section.second->size();
+        }
+        header.fileSize = offset;
+
+        uint64_t numSections = directory.size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&numSections), sizeof(numSections));
+        file.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(SectionEntry));
+        file.write(reinterpret_cast<const char*>(docTable.data()), docTable.size() * sizeof(DocumentEntry));
+        file.write(names.data(), names.size());
+        writePadding(header.namesOffset + names.size());
+        file.write(reinterpret_cast<const char*>(blockOffsets.data()), blockOffsets.size() * sizeof(uint64_t));
+        file.write(dictionary.data(), dictionary.size());
+        postings.copyTo(file);
+        offset = header.postingsOffset + postings.size();
+        for (size_t i = 0; i < sections.size(); ++i) {
+            writePadding(offset);
+            sections[i].second->copyTo(file);
+            offset = directory[i].offset + directory[i].size;
+        }
+
+        file.close();
+        if (!file) {
+            throw runtime_error("Erro ao gravar o arquivo: " + temporary);
+        }
+        filesystem::rename(temporary, filename);
+    }
+
+    /**
+     * Quantidade de palavras já gravadas.
+     */
+    size_t size() const {
+        return wordCount;
+    }
+
+private:
+    /**
+     * Bytes gravados em sequência (postings, posições ou deslocamentos, ou o
+     * conteúdo de uma seção). Sem arquivo temporário, ficam todos em buffer;
+     * com ele, o buffer é descarregado no arquivo a cada SPOOL_CHUNK bytes.
+     */
+    class Spool {
+    public:
+        // Bytes ainda não descarregados
+        string buffer;
+
+        explicit Spool(const string& temporaryPath) : path(temporaryPath), flushed(0) {}
+
+        /**
+         * Quantidade total de bytes (descarregados e em buffer).
+         */
+        uint64_t size() const {
+            return flushed + buffer.size();
+        }
+
+        /**
+         * Descarrega o buffer no arquivo temporário, se houver um e o buffer
+         * tiver chegado a SPOOL_CHUNK bytes.
+         * Lança uma exceção se a gravação falhar.
+         */
+        void spill() {
+            if (path.empty() || buffer.size() < SPOOL_CHUNK) {
+                return;
+            }
+            if (!spooled.is_open()) {
+                spooled.open(path, ios::binary | ios::trunc);
+            }
+            spooled.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+            if (!spooled) {
+                throw runtime_error("Erro ao gravar o arquivo temporário: " + path);
+            }
+            flushed += buffer.size();
+            buffer.clear();
+        }
+
+        /**
+         * Copia todos os bytes, na ordem, para out.
+         * Lança uma exceção se o arquivo temporário não puder ser lido.
+         */
+        void copyTo(ofstream& out) {
+            if (flushed > 0) {
+                spooled.close();
+                ifstream in(path, ios::binary);
+                vector<char> chunk(SPOOL_CHUNK);
+                uint64_t remaining = flushed;
+                while (remaining > 0) {
+                    size_t count = static_cast<size_t>(min<uint64_t>(remaining, chunk.size()));
+                    if (!in.read(chunk.data(), static_cast<streamsize>(count))) {
+                        throw runtime_error("Erro ao ler o arquivo temporário: " + path);
+                    }
+                    out.write(chunk.data(), static_cast<streamsize>(count));
+                    remaining -= count;
+                }
+            }
+            out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        }
+
+        /**
+         * Apaga o arquivo temporário, se houver.
+         */
+        void remove() {
+            if (!path.empty()) {
+                spooled.close();
+                error_code ec;
+                filesystem::remove(path, ec);
+            }
+        }
+
+    private:
+        // Arquivo temporário (vazio: tudo em memória)
+        string path;
+        ofstream spooled;
+        // Bytes já gravados no arquivo temporário
+        uint64_t flushed;
+    };
+
+    // Índice que fornece os documentos
+    const Index& index;
+    string filename;
+    // Arquivo gravado, renomeado para filename no final
+    string temporary;
+    ofstream file;
+
+    // Tabela de documentos e nomes dos arquivos
+    vector<DocumentEntry> docTable;
+    string names;
+
+    // Dicionário com codificação de prefixo e postings em diferenças
+    vector<uint64_t> blockOffsets;
+    string dictionary;
+    Spool postings;
+    Spool positions;
+    Spool offsets;
+    vector<PostingBlockEntry> blockEntries;
+    vector<PostingBlock> blocks;
+    vector<PostingBitmapEntry> bitmapEntries;
+    string bitmaps;
+
+    // Palavra atual (a última de beginWord) e seu estado
+    size_t wordCount;
+    string previous;
+    size_t docFreq;
+    size_t posting;
+    uint32_t lastDocId;
+    uint64_t lastPositionStart;
+    uint64_t lastOffsetStart;
+    PostingBlock block;
+    size_t blockFill;
+    // Palavra densa: a lista é guardada para o bitmap (PostingBitmap::isDense)
+    bool dense;
+    vector<uint32_t> denseDocIds;
+
+    /**
+     * Arredonda um deslocamento para o próximo múltiplo de 8.
+     */
+    static uint64_t align8(uint64_t offset) {
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    /**
+     * Grava bytes zerados até que o deslocamento atual fique alinhado em 8.
+     */
+    void writePadding(uint64_t offset) {
+        static const char zeros[8] = {};
+        file.write(zeros, align8(offset) - offset);
+    }
+
+    /**
+     * Monta a seção de tamanhos: total de palavras seguido do tamanho de cada
+     * documento, na ordem da tabela de documentos.
+     */
+    string documentLengthsSection() const {
+        string section;
+        uint64_t total = index.totalLength;
+        section.append(reinterpret_cast<const char*>(&total), sizeof(total));
+        for (const DocumentEntry& doc : docTable) {
+            uint32_t length = index.getDocumentLength(static_cast<int>(doc.docId));
+            section.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        }
+        return section;
+    }
+
+    /**
+     * Copia registros de tamanho fixo para o conteúdo de uma seção.
+     */
+    template <typename Record>
+    static string recordsSection(const vector<Record>& records) {
+        return string(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    }
+};
+
+#endif
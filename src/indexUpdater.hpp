@@ -0,0 +1,178 @@
+#ifndef INDEXUPDATER_HPP
+#define INDEXUPDATER_HPP
+
+#include "index.hpp"
+#include "textProcessor.hpp"
+#include "indexer.hpp"
+#include "serializer.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Resumo de uma atualização incremental.
+ */
+struct UpdateSummary {
+    size_t added = 0;
+    size_t modified = 0;
+    size_t removed = 0;
+    size_t unchanged = 0;
+    // Arquivos com data de modificação nova, mas o mesmo conteúdo
+    size_t touched = 0;
+    // Segmento delta gravado (vazio se não houve alterações)
+    string deltaFile;
+    // Indica se os segmentos foram compactados no arquivo base
+    bool compacted = false;
+};
+
+/**
+ * Atualização incremental do índice a partir do diretório de documentos.
+ *
+ * Compara cada arquivo com os metadados gravados no índice (tamanho, data de
+ * modificação e hash do conteúdo): só os arquivos novos ou modificados são
+ * indexados, e os apagados ou modificados viram tombstones. As alterações são
+ * gravadas em um novo segmento delta ao lado do arquivo base, de modo que o
+ * custo depende do tamanho da alteração, e não do corpus (além de um stat por
+ * arquivo). O conteúdo só é lido quando o tamanho ou a data mudaram.
+ *
+ * A compactação reúne base e deltas em um novo arquivo base, sem os
+ * documentos removidos, e apaga os deltas.
+ */
+class IndexUpdater {
+public:
+    // Quantidade de segmentos delta a partir da qual a compactação é automática
+    static constexpr size_t MAX_DELTAS = 8;
+
+private:
+    // Arquivo base do índice
+    string indexPath;
+    // Processador de texto com as stop words carregadas
+    TextProcessor& textProcessor;
+    // Quantidade de threads usadas para indexar os arquivos alterados
+    unsigned numThreads;
+    // Memória para os buffers de leitura dos arquivos alterados
+    size_t readBudget;
+
+public:
+    IndexUpdater(const string& path, TextProcessor& tp, unsigned threads = 1,
+                 size_t readBytes = Indexer::DEFAULT_READ_BUDGET)
+        : indexPath(path), textProcessor(tp), numThreads(threads), readBudget(readBytes) {}
+
+    /**
+     * Atualiza o índice com o conteúdo atual do diretório. Com compact, ou quando
+     * há MAX_DELTAS segmentos delta, compacta os segmentos ao final.
+     * Lança uma exceção se o índice não guardar metadados dos arquivos.
+     */
+    UpdateSummary update(const string& directoryPath, bool compact) {
+        UpdateSummary summary;
+        Index current = Serializer::open(indexPath);
+        vector<FileMetadata> metadata = current.getFileMetadata();
+        if (!current.isMapped() || (metadata.empty() && current.getDocumentCount() > 0)) {
+            throw runtime_error("O índice não guarda os metadados dos arquivos (gerado por uma versão "
+                                "anterior); execute construir novamente");
+        }
+
+        unordered_map<string, int> liveIds;
+        for (int docId : current.getAllDocumentIds()) {
+            liveIds[current.getFileName(docId)] = docId;
+        }
+        unordered_map<int, FileMetadata> known;
+        for (const FileMetadata& entry : metadata) {
+            known[static_cast<int>(entry.docId)] = entry;
+        }
+
+        Index delta;
+        if (current.hasPositions()) {
+            delta.enablePositions();
+        }
+        if (current.hasOffsets()) {
+            delta.enableOffsets();
+        }
+        delta.setFirstDocumentId(current.getNextDocumentId());
+        delta.setSegmentSequence(current.getSegmentSequence() + 1);
+
+        vector<string> changed;
+        unordered_set<int> seen;
+        for (const string& filename : Indexer::listFiles(directoryPath)) {
+            auto it = liveIds.find(filename);
+            if (it == liveIds.end()) {
+                changed.push_back(filename);
+                ++summary.added;
+                continue;
+            }
+            int docId = it->second;
+            seen.insert(docId);
+
+            FileMetadata observed = {static_cast<uint32_t>(docId), 0, 0, Indexer::modificationTime(filename), 0};
+            error_code ec;
+            observed.size = filesystem::file_size(filename, ec);
+            auto previous = known.find(docId);
+            if (previous != known.end() && !ec && previous->second.size == observed.size &&
+                previous->second.modified == observed.modified) {
+                ++summary.unchanged;
+                continue;
+            }
+
+            // Tamanho ou data mudaram: compara o conteúdo
+            uint64_t size = 0;
+            uint64_t hash = 0;
+            if (previous != known.end() && previous->second.size == observed.size &&
+                Indexer::hashFile(filename, size, hash) &&
+                size == previous->second.size && hash == previous->second.hash) {
+                observed.size = size;
+                observed.hash = hash;
+                delta.addFileMetadata(observed);
+                ++summary.touched;
+                continue;
+            }
+            delta.removeDocument(docId);
+            changed.push_back(filename);
+            ++summary.modified;
+        }
+
+        for (const auto& entry : liveIds) {
+            if (seen.count(entry.second) == 0) {
+                delta.removeDocument(entry.second);
+                ++summary.removed;
+            }
+        }
+
+        bool hasChanges = summary.added + summary.modified + summary.removed + summary.touched > 0;
+        if (hasChanges) {
+            Indexer indexer(delta, textProcessor, numThreads, readBudget);
+            indexer.indexFiles(changed);
+            delta.freeze();
+            summary.deltaFile = Serializer::deltaFileName(indexPath, current.getSegmentSequence() + 1);
+            Serializer::serialize(delta, summary.deltaFile);
+        }
+
+        size_t deltas = current.getDeltaCount() + (hasChanges ? 1 : 0);
+        if (deltas > 0 && (compact || deltas >= MAX_DELTAS)) {
+            compactSegments();
+            summary.compacted = true;
+        }
+        return summary;
+    }
+
+    /**
+     * Reúne o arquivo base e os segmentos delta em um novo arquivo base.
+     * O novo arquivo é gravado ao lado e renomeado por cima do antigo
+     * (IndexFileWriter); como ele registra o último segmento incorporado,
+     * deltas que sobrarem de uma compactação interrompida são ignorados na
+     * abertura.
+     */
+    void compactSegments() {
+        {
+            Index merged = Serializer::open(indexPath);
+            Serializer::serialize(merged, indexPath);
+        }
+        Serializer::removeDeltas(indexPath);
+    }
+};
+
+#endif
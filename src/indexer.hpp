@@ -3,9 +3,19 @@
 
 #include "index.hpp"
 #include "textProcessor.hpp"
+#include "statistics.hpp"
 #include <filesystem>
-#include <fstream>
-#include <sstream>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 namespace fs = filesystem;
@@ -14,46 +24,358 @@ namespace fs = filesystem;
  * Classe responsável por indexar um diretório de documentos.
  * Utiliza o TextProcessor para processar o conteúdo dos arquivos
  * e preenche o índice invertido.
+ *
+ * Os arquivos são lidos em partes de tamanho fixo, e não inteiros: cada
+ * thread reaproveita um único buffer, e a memória usada na leitura fica
+ * limitada pelo orçamento informado, qualquer que seja o tamanho dos arquivos.
  */
 class Indexer {
+public:
+    // Orçamento padrão de memória para os buffers de leitura (todas as threads)
+    static constexpr size_t DEFAULT_READ_BUDGET = 8 << 20;
+    // Tamanho mínimo da parte lida de cada vez
+    static constexpr size_t MIN_CHUNK_SIZE = 64 << 10;
+
 private:
     // Referência para o índice que será preenchido
     Index& index;
     // Referência para o processador de texto
     TextProcessor& textProcessor;
+    // Quantidade de threads de trabalho usadas na indexação
+    unsigned numThreads;
+    // Memória para os buffers de leitura, dividida entre as threads
+    size_t readBudget;
+
+    // Dicionário parcial produzido por uma thread (palavra -> documentos)
+    using PartialPostings = Index::PartialPostings;
+
+    // Arquivo a ser indexado, com o ID já atribuído, seu tamanho em bytes
+    // e sua data de modificação
+    struct FileJob {
+        string filename;
+        int docId;
+        uintmax_t size;
+        int64_t modified;
+    };
 
 public:
-    Indexer(Index& idx, TextProcessor& tp) : index(idx), textProcessor(tp) {}
-    
+    Indexer(Index& idx, TextProcessor& tp, unsigned threads = 1, size_t readBytes = DEFAULT_READ_BUDGET)
+        : index(idx), textProcessor(tp), numThreads(threads == 0 ? 1 : threads), readBudget(readBytes) {}
+
     /**
      * Indexa todos os arquivos .txt no diretório especificado (recursivamente).
      * Para cada arquivo, lê o conteúdo, processa o texto e adiciona as palavras ao índice.
+     *
+     * Os IDs dos documentos são atribuídos na ordem do percurso do diretório,
+     * antes de qualquer processamento, para que o resultado não dependa da
+     * quantidade de threads.
      */
     void indexDirectory(const string& directoryPath) {
+        indexFiles(listFiles(directoryPath));
+    }
+
+    /**
+     * Indexa os arquivos informados, atribuindo os IDs na ordem da lista.
+     * Além das palavras, registra o tamanho, a data de modificação e o hash
+     * do conteúdo de cada arquivo, usados pela atualização incremental.
+     * Se o índice for posicional (Index::enablePositions), guarda também a
+     * posição de cada palavra; com Index::enableOffsets, o deslocamento em
+     * bytes das primeiras ocorrências de cada palavra no arquivo.
+     */
+    void indexFiles(const vector<string>& filenames) {
+        vector<FileJob> jobs = registerFiles(filenames);
+
+        if (numThreads == 1 || jobs.size() < 2) {
+            vector<char> buffer;
+            SampledTimer insertion(Statistics::DICTIONARY_INSERT);
+            for (const FileJob& job : jobs) {
+                uint32_t position = 0;
+                uint64_t chunkStart = 0;
+                FileMetadata metadata = metadataOf(job);
+                bool read = streamFile(job.filename, chunkSize(1), buffer, [&](string_view text) {
+                    position = textProcessor.forEachTokenSpan(text, [&](const string& word, uint32_t at,
+                                                                        size_t begin, size_t) {
+                        insertion.measure([&]() {
+                            index.addOccurrence(word, job.docId, at, offsetOf(chunkStart + begin));
+                        });
+                    }, position);
+                    chunkStart += text.size();
+                }, metadata.size, metadata.hash);
+                if (read) {
+                    index.addFileMetadata(metadata);
+                }
+            }
+            Statistics::add(Statistics::TOKENS, insertion.count());
+            return;
+        }
+
+        indexInParallel(jobs);
+    }
+
+    /**
+     * Lista os arquivos .txt do diretório (recursivamente), na ordem do percurso.
+     */
+    static vector<string> listFiles(const string& directoryPath) {
+        ScopedTimer timer(Statistics::DIRECTORY_WALK);
+        vector<string> filenames;
         for (const auto& entry : fs::recursive_directory_iterator(directoryPath)) {
             if (entry.is_regular_file() && entry.path().extension() == ".txt") {
-                string filename = entry.path().string();
-                
-                int docId = index.addDocument(filename);
-                
-                ifstream file(filename);
-                if (!file.is_open()) {
-                    continue; 
+                filenames.push_back(entry.path().string());
+            }
+        }
+        return filenames;
+    }
+
+    /**
+     * Retorna a data de modificação do arquivo em nanossegundos, ou -1 em caso de erro.
+     */
+    static int64_t modificationTime(const string& filename) {
+        error_code ec;
+        auto time = fs::last_write_time(filename, ec);
+        if (ec) {
+            return -1;
+        }
+        return chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    /**
+     * Hash do conteúdo de um arquivo (FNV-1a de 64 bits). Para conteúdo lido
+     * em partes, passe em hash o valor retornado para a parte anterior.
+     */
+    static uint64_t contentHash(string_view content, uint64_t hash = 14695981039346656037ULL) {
+        for (unsigned char c : content) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /**
+     * Calcula o tamanho e o hash do conteúdo de um arquivo, lendo-o em partes.
+     * Retorna false se o arquivo não puder ser lido.
+     */
+    static bool hashFile(const string& filename, uint64_t& size, uint64_t& hash) {
+        vector<char> buffer;
+        return streamFile(filename, MIN_CHUNK_SIZE, buffer, [](string_view) {}, size, hash);
+    }
+
+    /**
+     * Lê o arquivo em partes de até chunkSize bytes no buffer informado e chama
+     * callback(texto) com trechos que terminam em um separador de palavras
+     * (o último trecho termina no fim do arquivo). Os bytes depois do último
+     * separador de uma parte são levados para o início da próxima, então
+     * nenhuma palavra é cortada. Só uma palavra maior que a parte inteira faz
+     * o buffer crescer. Preenche size e hash (contentHash) com os bytes lidos.
+     * Retorna false se o arquivo não puder ser aberto ou lido.
+     */
+    template <typename Callback>
+    static bool streamFile(const string& filename, size_t chunkSize, vector<char>& buffer, Callback callback,
+                           uint64_t& size, uint64_t& hash) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        if (buffer.size() < chunkSize) {
+            buffer.resize(chunkSize);
+        }
+        size = 0;
+        hash = contentHash("");
+        size_t carry = 0;
+        while (true) {
+            if (carry == buffer.size()) {
+                // Uma palavra ocupa a parte inteira
+                buffer.resize(buffer.size() * 2);
+            }
+            ssize_t received;
+            {
+                ScopedTimer timer(Statistics::FILE_READ);
+                received = ::read(fd, buffer.data() + carry, buffer.size() - carry);
+            }
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
                 }
-                
-                stringstream buffer;
-                buffer << file.rdbuf();
-                string content = buffer.str();
-                file.close();
-                
-                vector<string> words = textProcessor.process(content);
-                
-                for (const string& word : words) {
-                    index.addWordToDocument(word, docId);
+                ::close(fd);
+                return false;
+            }
+            if (received == 0) {
+                break;
+            }
+            string_view fresh(buffer.data() + carry, static_cast<size_t>(received));
+            size += fresh.size();
+            hash = contentHash(fresh, hash);
+
+            size_t filled = carry + fresh.size();
+            size_t cut = filled;
+            while (cut > carry && !TextProcessor::isSeparator(static_cast<unsigned char>(buffer[cut - 1]))) {
+                --cut;
+            }
+            if (cut == carry) {
+                // Nenhum separador nos bytes novos: a palavra continua
+                carry = filled;
+                continue;
+            }
+            {
+                ScopedTimer timer(Statistics::TOKENIZE);
+                callback(string_view(buffer.data(), cut));
+            }
+            carry = filled - cut;
+            memmove(buffer.data(), buffer.data() + cut, carry);
+        }
+        ::close(fd);
+        if (carry > 0) {
+            ScopedTimer timer(Statistics::TOKENIZE);
+            callback(string_view(buffer.data(), carry));
+        }
+        Statistics::add(Statistics::FILES, 1);
+        Statistics::add(Statistics::BYTES_READ, size);
+        return true;
+    }
+
+private:
+    /**
+     * Registra cada arquivo no índice, na ordem da lista.
+     */
+    vector<FileJob> registerFiles(const vector<string>& filenames) {
+        ScopedTimer timer(Statistics::DIRECTORY_WALK);
+        vector<FileJob> jobs;
+        jobs.reserve(filenames.size());
+        for (const string& filename : filenames) {
+            int docId = index.addDocument(filename);
+            error_code ec;
+            uintmax_t size = fs::file_size(filename, ec);
+            jobs.push_back({filename, docId, ec ? 0 : size, modificationTime(filename)});
+        }
+        return jobs;
+    }
+
+    /**
+     * Monta os metadados de um arquivo; tamanho e hash são preenchidos na leitura.
+     */
+    static FileMetadata metadataOf(const FileJob& job) {
+        return {static_cast<uint32_t>(job.docId), 0, 0, job.modified, 0};
+    }
+
+    /**
+     * Deslocamento em bytes guardado no índice; arquivos com mais de 4 GiB
+     * ficam com as ocorrências do final no último deslocamento representável.
+     */
+    static uint32_t offsetOf(uint64_t offset) {
+        return static_cast<uint32_t>(min<uint64_t>(offset, UINT32_MAX));
+    }
+
+    /**
+     * Tamanho da parte lida de cada vez por uma de workers threads.
+     */
+    size_t chunkSize(size_t workers) const {
+        return max(MIN_CHUNK_SIZE, readBudget / workers);
+    }
+
+    /**
+     * Indexa os arquivos com várias threads.
+     *
+     * Os arquivos são ordenados do maior para o menor e consumidos de uma fila
+     * compartilhada: cada thread pega o próximo arquivo assim que termina o
+     * anterior, de modo que um arquivo muito grande não segura as demais.
+     * Cada thread grava em dicionários parciais próprios, já particionados pelo
+     * hash da palavra (o mesmo usado na tabela do dicionário, calculado uma vez),
+     * que depois são unidos em paralelo (uma partição por thread).
+     */
+    void indexInParallel(vector<FileJob>& jobs) {
+        stable_sort(jobs.begin(), jobs.end(), [](const FileJob& a, const FileJob& b) {
+            return a.size > b.size;
+        });
+
+        unsigned workers = min<size_t>(numThreads, jobs.size());
+        size_t numPartitions = workers;
+
+        // partials[w][p]: palavras da partição p vistas pela thread w
+        vector<vector<PartialPostings>> partials(workers, vector<PartialPostings>(numPartitions));
+        // lengths[j]: quantidade de palavras indexadas do arquivo j
+        vector<uint32_t> lengths(jobs.size(), 0);
+        // metadata[j]: metadados do arquivo j (docId 0 se não foi lido)
+        vector<FileMetadata> metadata(jobs.size(), FileMetadata{});
+        atomic<size_t> nextJob(0);
+        vector<thread> threads;
+        bool positional = index.hasPositions();
+        bool withOffsets = index.hasOffsets();
+
+        size_t chunk = chunkSize(workers);
+        for (unsigned w = 0; w < workers; ++w) {
+            threads.emplace_back([&, w]() {
+                vector<char> buffer;
+                SampledTimer insertion(Statistics::DICTIONARY_INSERT);
+                size_t j;
+                while ((j = nextJob.fetch_add(1)) < jobs.size()) {
+                    uint32_t docId = static_cast<uint32_t>(jobs[j].docId);
+                    uint32_t position = 0;
+                    uint64_t chunkStart = 0;
+                    FileMetadata read = metadataOf(jobs[j]);
+                    auto tokenize = [&](string_view text) {
+                        position = textProcessor.forEachTokenSpan(text, [&](const string& word, uint32_t at,
+                                                                            size_t begin, size_t) {
+                            Index::PostingBuilder& postings = insertion.measure([&]() -> Index::PostingBuilder& {
+                                uint64_t hash = TermDictionary::hashOf(word);
+                                PartialPostings& partition = partials[w][(hash >> 32) % numPartitions];
+                                return partition.postingsOf(word, hash);
+                            });
+                            if (positional) {
+                                postings.addAt(docId, at);
+                            } else {
+                                postings.add(docId);
+                            }
+                            if (withOffsets) {
+                                postings.addOffset(offsetOf(chunkStart + begin));
+                            }
+                            ++lengths[j];
+                        }, position);
+                        chunkStart += text.size();
+                    };
+                    if (streamFile(jobs[j].filename, chunk, buffer, tokenize, read.size, read.hash)) {
+                        metadata[j] = read;
+                    }
                 }
+                Statistics::add(Statistics::TOKENS, insertion.count());
+            });
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+        threads.clear();
+
+        // Une, em paralelo, os dicionários de todas as threads para cada partição
+        ScopedTimer timer(Statistics::PARTIAL_MERGE);
+        for (size_t p = 0; p < numPartitions; ++p) {
+            threads.emplace_back([&, p]() {
+                PartialPostings& target = partials[0][p];
+                for (unsigned w = 1; w < workers; ++w) {
+                    target.merge(partials[w][p]);
+                }
+            });
+        }
+        for (thread& t : threads) {
+            t.join();
+        }
+
+        for (size_t j = 0; j < jobs.size(); ++j) {
+            index.addDocumentLength(jobs[j].docId, lengths[j]);
+            if (metadata[j].docId != 0) {
+                index.addFileMetadata(metadata[j]);
             }
         }
+
+        size_t totalWords = 0;
+        for (size_t p = 0; p < numPartitions; ++p) {
+            totalWords += partials[0][p].size();
+        }
+        index.reserveWords(totalWords);
+        for (size_t p = 0; p < numPartitions; ++p) {
+            index.mergePostings(partials[0][p]);
+        }
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,430 @@
+#ifndef INTERSECTION_HPP
+#define INTERSECTION_HPP
+
+#include "postingSpan.hpp"
+#include "statistics.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**
+ * Interseção de listas de postings ordenadas (operação AND).
+ *
+ * O algoritmo é escolhido pela razão entre os tamanhos das listas:
+ * - listas muito desiguais: busca exponencial (galloping) na lista maior
+ *   para cada elemento da menor, em O(m log(n/m));
+ * - listas de tamanho parecido: comparação em blocos de 4 inteiros com SSE2
+ *   (cada bloco de uma lista contra as 4 rotações do bloco da outra), ou a
+ *   intercalação linear quando SSE2 não está disponível;
+ * - no meio-termo: intercalação linear.
+ * Os limites vêm de bench/intersectionBench.
+ *
+ * Para várias listas, a interseção começa pelas menores e alterna entre
+ * dois buffers reaproveitados entre as chamadas.
+ *
+ * Também oferece a diferença (operação NOT) e a união (operação OR). No
+ * bench/intersectionBench, a união acumulada lista a lista é a mais rápida
+ * até umas 32 listas e, a partir de 64, unir sempre as duas menores; a
+ * intercalação de k vias com um heap perde para uma das duas em todo k, e
+ * fica só como referência do benchmark.
+ */
+class PostingIntersector {
+public:
+    // Abaixo desta razão entre os tamanhos, usa a comparação em blocos
+    static constexpr size_t BLOCK_RATIO = 8;
+    // A partir desta razão entre os tamanhos, usa galloping
+    static constexpr size_t GALLOPING_RATIO = 32;
+    // A partir desta quantidade de listas, a união une sempre as duas menores
+    static constexpr size_t SMALLEST_FIRST_LISTS = 64;
+
+private:
+    // Buffers de resultado, alternados a cada rodada
+    vector<uint32_t> front;
+    vector<uint32_t> back;
+    // Buffers para decodificar as listas de cada termo (índice mapeado)
+    vector<vector<uint32_t>> termBuffers;
+    // Resultado da união de k vias
+    vector<uint32_t> merged;
+    // Uniões parciais de uniteSmallestFirst
+    vector<vector<uint32_t>> pieces;
+    // Heap da união de k vias: próximo valor (32 bits altos) e lista (32 bits baixos)
+    vector<uint64_t> heap;
+
+public:
+    /**
+     * Retorna um buffer reaproveitável para decodificar a lista do i-ésimo termo.
+     */
+    vector<uint32_t>& termBuffer(size_t i) {
+        if (termBuffers.size() <= i) {
+            termBuffers.resize(i + 1);
+        }
+        return termBuffers[i];
+    }
+
+    /**
+     * Intersecta todas as listas, da menor para a maior, parando assim que o
+     * resultado parcial fica vazio. A visão retornada vale até a próxima chamada.
+     */
+    PostingSpan intersectAll(vector<PostingSpan> lists) {
+        if (lists.empty()) {
+            return PostingSpan();
+        }
+        sort(lists.begin(), lists.end(), [](const PostingSpan& a, const PostingSpan& b) {
+            return a.size() < b.size();
+        });
+        if (lists.size() == 1) {
+            return lists[0];
+        }
+
+        PostingSpan current = lists[0];
+        for (size_t i = 1; i < lists.size() && !current.empty(); ++i) {
+            vector<uint32_t>& output = (current.data() == front.data()) ? back : front;
+            output.resize(current.size());
+            size_t count = intersect(current, lists[i], output.data());
+            output.resize(count);
+            current = PostingSpan(output);
+        }
+        return current;
+    }
+
+    /**
+     * Une todas as listas (operação OR), sem repetições no resultado. Com
+     * menos de SMALLEST_FIRST_LISTS listas, acumula a união lista a lista
+     * (unitePairwise); com mais, une sempre as duas menores
+     * (uniteSmallestFirst). A visão retornada vale até a próxima chamada; as
+     * listas não podem apontar para resultados anteriores deste intersector.
+     */
+    PostingSpan uniteAll(const vector<PostingSpan>& lists) {
+        ScopedTimer timer(Statistics::UNION);
+        size_t total = 0;
+        size_t nonEmpty = 0;
+        for (const PostingSpan& list : lists) {
+            total += list.size();
+            nonEmpty += list.empty() ? 0 : 1;
+        }
+        Statistics::add(Statistics::POSTINGS_INPUT, total);
+        if (nonEmpty < SMALLEST_FIRST_LISTS) {
+            return unitePairwise(lists);
+        }
+        return uniteSmallestFirst(lists);
+    }
+
+    /**
+     * Une as listas acumulando a união de uma lista por vez, da menor para a
+     * maior, alternando entre dois buffers: com poucas listas, é a forma que
+     * menos move dados. A visão retornada vale até a próxima chamada.
+     */
+    PostingSpan unitePairwise(const vector<PostingSpan>& lists) {
+        vector<PostingSpan> sorted;
+        for (const PostingSpan& list : lists) {
+            if (!list.empty()) {
+                sorted.push_back(list);
+            }
+        }
+        if (sorted.empty()) {
+            return PostingSpan();
+        }
+        sort(sorted.begin(), sorted.end(), [](const PostingSpan& a, const PostingSpan& b) {
+            return a.size() < b.size();
+        });
+        PostingSpan current = sorted[0];
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            vector<uint32_t>& output = (current.data() == front.data()) ? back : front;
+            output.resize(current.size() + sorted[i].size());
+            output.resize(unite(current, sorted[i], output.data()));
+            current = PostingSpan(output);
+        }
+        return current;
+    }
+
+    /**
+     * Une as listas intercalando sempre as duas menores (como na árvore de
+     * Huffman): cada ID passa por O(log k) intercalações lineares, que são
+     * mais baratas por elemento que o heap. A visão retornada vale até a
+     * próxima chamada.
+     */
+    PostingSpan uniteSmallestFirst(const vector<PostingSpan>& lists) {
+        // Partes pendentes: as listas de entrada e as uniões parciais, em pieces
+        vector<PostingSpan> parts;
+        vector<size_t> owner;
+        for (const PostingSpan& list : lists) {
+            if (!list.empty()) {
+                parts.push_back(list);
+                owner.push_back(SIZE_MAX);
+            }
+        }
+        if (parts.empty()) {
+            return PostingSpan();
+        }
+        vector<size_t> freePieces;
+        size_t used = 0;
+        auto larger = [&](size_t a, size_t b) { return parts[a].size() > parts[b].size(); };
+        vector<size_t> pending(parts.size());
+        for (size_t i = 0; i < pending.size(); ++i) {
+            pending[i] = i;
+        }
+        make_heap(pending.begin(), pending.end(), larger);
+        while (pending.size() > 1) {
+            pop_heap(pending.begin(), pending.end(), larger);
+            size_t first = pending.back();
+            pending.pop_back();
+            pop_heap(pending.begin(), pending.end(), larger);
+            size_t second = pending.back();
+            pending.pop_back();
+
+            size_t piece;
+            if (!freePieces.empty()) {
+                piece = freePieces.back();
+                freePieces.pop_back();
+            } else {
+                piece = used++;
+                if (pieces.size() < used) {
+                    pieces.resize(used);
+                }
+            }
+            vector<uint32_t>& output = pieces[piece];
+            output.resize(parts[first].size() + parts[second].size());
+            output.resize(unite(parts[first], parts[second], output.data()));
+            for (size_t consumed : {first, second}) {
+                if (owner[consumed] != SIZE_MAX) {
+                    freePieces.push_back(owner[consumed]);
+                }
+            }
+            parts.push_back(PostingSpan(output));
+            owner.push_back(piece);
+            pending.push_back(parts.size() - 1);
+            push_heap(pending.begin(), pending.end(), larger);
+        }
+        return parts[pending[0]];
+    }
+
+    /**
+     * Une as listas por intercalação de k vias: um heap guarda o próximo
+     * elemento de cada lista, em O(n log k) para n elementos no total, sem
+     * as uniões parciais. A visão retornada vale até a próxima chamada.
+     */
+    PostingSpan uniteKWay(const vector<PostingSpan>& lists) {
+        merged.clear();
+        heap.clear();
+        size_t total = 0;
+        for (size_t i = 0; i < lists.size(); ++i) {
+            if (!lists[i].empty()) {
+                heap.push_back(static_cast<uint64_t>(lists[i][0]) << 32 | i);
+                total += lists[i].size();
+            }
+        }
+        merged.reserve(total);
+        vector<size_t> cursor(lists.size(), 0);
+        for (size_t i = heap.size() / 2; i-- > 0;) {
+            siftDown(i);
+        }
+        while (!heap.empty()) {
+            uint32_t value = static_cast<uint32_t>(heap[0] >> 32);
+            uint32_t list = static_cast<uint32_t>(heap[0]);
+            if (merged.empty() || merged.back() != value) {
+                merged.push_back(value);
+            }
+            // O topo é substituído pelo próximo elemento da mesma lista
+            if (++cursor[list] < lists[list].size()) {
+                heap[0] = static_cast<uint64_t>(lists[list][cursor[list]]) << 32 | list;
+            } else {
+                heap[0] = heap.back();
+                heap.pop_back();
+            }
+            siftDown(0);
+        }
+        return PostingSpan(merged);
+    }
+
+    /**
+     * Intersecta duas listas escolhendo o algoritmo pela razão entre os tamanhos.
+     * out deve ter espaço para min(|a|, |b|) elementos; retorna quantos foram escritos.
+     */
+    static size_t intersect(PostingSpan a, PostingSpan b, uint32_t* out) {
+        ScopedTimer timer(Statistics::INTERSECT);
+        Statistics::add(Statistics::POSTINGS_INPUT, a.size() + b.size());
+        if (a.size() > b.size()) {
+            swap(a, b);
+        }
+        if (a.empty()) {
+            return 0;
+        }
+        size_t ratio = b.size() / a.size();
+        if (ratio >= GALLOPING_RATIO) {
+            return intersectGalloping(a, b, out);
+        }
+        if (ratio < BLOCK_RATIO) {
+            return intersectBlocks(a, b, out);
+        }
+        return intersectLinear(a, b, out);
+    }
+
+    /**
+     * Intercalação linear clássica, O(|a| + |b|).
+     */
+    static size_t intersectLinear(PostingSpan a, PostingSpan b, uint32_t* out) {
+        return mergeFrom(a, 0, b, 0, out, 0);
+    }
+
+    /**
+     * Para cada elemento da lista menor, busca exponencial seguida de busca
+     * binária na lista maior, a partir da última posição encontrada.
+     */
+    static size_t intersectGalloping(PostingSpan small, PostingSpan large, uint32_t* out) {
+        size_t count = 0;
+        size_t low = 0;
+        for (uint32_t value : small) {
+            low = gallop(large, low, value);
+            if (low == large.size()) {
+                break;
+            }
+            if (large[low] == value) {
+                out[count++] = value;
+                ++low;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Comparação em blocos de 4 inteiros com SSE2; sem SSE2, usa a intercalação linear.
+     */
+    static size_t intersectBlocks(PostingSpan a, PostingSpan b, uint32_t* out) {
+#ifdef __SSE2__
+        size_t i = 0;
+        size_t j = 0;
+        size_t count = 0;
+        while (i + 4 <= a.size() && j + 4 <= b.size()) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data() + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data() + j));
+            __m128i equal = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                             _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                             _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+            for (int k = 0; k < 4; ++k) {
+                if (mask & (1 << k)) {
+                    out[count++] = a[i + k];
+                }
+            }
+
+            uint32_t lastA = a[i + 3];
+            uint32_t lastB = b[j + 3];
+            if (lastA <= lastB) {
+                i += 4;
+            }
+            if (lastB <= lastA) {
+                j += 4;
+            }
+        }
+        return mergeFrom(a, i, b, j, out, count);
+#else
+        return intersectLinear(a, b, out);
+#endif
+    }
+
+    /**
+     * Diferença a - b (operação NOT): os elementos de a que não estão em b.
+     * Quando b é muito maior, cada elemento de a é procurado em b por busca
+     * exponencial; senão, as duas listas são percorridas juntas.
+     * out deve ter espaço para |a| elementos; retorna quantos foram escritos.
+     */
+    static size_t difference(PostingSpan a, PostingSpan b, uint32_t* out) {
+        ScopedTimer timer(Statistics::DIFFERENCE);
+        Statistics::add(Statistics::POSTINGS_INPUT, a.size() + b.size());
+        bool galloping = !a.empty() && b.size() / a.size() >= GALLOPING_RATIO;
+        size_t count = 0;
+        size_t j = 0;
+        for (uint32_t value : a) {
+            if (galloping) {
+                j = gallop(b, j, value);
+            } else {
+                while (j < b.size() && b[j] < value) {
+                    ++j;
+                }
+            }
+            if (j == b.size() || b[j] != value) {
+                out[count++] = value;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * União de duas listas (operação OR), sem repetições.
+     * out deve ter espaço para |a| + |b| elementos; retorna quantos foram escritos.
+     */
+    static size_t unite(PostingSpan a, PostingSpan b, uint32_t* out) {
+        return set_union(a.begin(), a.end(), b.begin(), b.end(), out) - out;
+    }
+
+private:
+    /**
+     * Desce o elemento i do heap da união até a posição correta (menor no topo).
+     */
+    void siftDown(size_t i) {
+        size_t size = heap.size();
+        uint64_t item = heap.empty() ? 0 : heap[i];
+        while (true) {
+            size_t child = 2 * i + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && heap[child + 1] < heap[child]) {
+                ++child;
+            }
+            if (!(heap[child] < item)) {
+                break;
+            }
+            heap[i] = heap[child];
+            i = child;
+        }
+        if (i < size) {
+            heap[i] = item;
+        }
+    }
+
+    /**
+     * Retorna a posição do primeiro elemento da lista maior ou igual a value,
+     * procurando a partir de low: dobra o passo até ultrapassar o valor e
+     * termina com uma busca binária no último intervalo.
+     */
+    static size_t gallop(PostingSpan list, size_t low, uint32_t value) {
+        size_t step = 1;
+        size_t high = low;
+        while (high < list.size() && list[high] < value) {
+            low = high + 1;
+            high += step;
+            step <<= 1;
+        }
+        high = min(high + 1, list.size());
+        return lower_bound(list.begin() + low, list.begin() + high, value) - list.begin();
+    }
+
+    /**
+     * Intercalação linear a partir das posições i e j, continuando a escrever em out[count].
+     */
+    static size_t mergeFrom(PostingSpan a, size_t i, PostingSpan b, size_t j, uint32_t* out, size_t count) {
+        while (i < a.size() && j < b.size()) {
+            if (a[i] < b[j]) {
+                ++i;
+            } else if (b[j] < a[i]) {
+                ++j;
+            } else {
+                out[count++] = a[i];
+                ++i;
+                ++j;
+            }
+        }
+        return count;
+    }
+};
+
+#endif
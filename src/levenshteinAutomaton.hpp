@@ -0,0 +1,142 @@
+#ifndef LEVENSHTEINAUTOMATON_HPP
+#define LEVENSHTEINAUTOMATON_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Autômato de Levenshtein para percorrer um dicionário ordenado: reconhece as
+ * palavras a no máximo maxDistance edições (inserção, remoção ou troca de um
+ * byte) da palavra da consulta.
+ *
+ * O estado depois de ler um prefixo é a linha da tabela de programação
+ * dinâmica desse prefixo contra a consulta, restrita à faixa |d - j| <=
+ * maxDistance. As palavras chegam em ordem, então as linhas do prefixo comum
+ * com a palavra anterior são reaproveitadas (como em um percurso de trie).
+ * Quando o menor valor de uma linha passa de maxDistance, nenhuma palavra com
+ * aquele prefixo pode casar: accepts devolve em seek a menor palavra seguinte
+ * que ainda pode casar, para o dicionário saltar direto para lá.
+ */
+class LevenshteinAutomaton {
+private:
+    // Palavra da consulta
+    string query;
+    // Distância máxima aceita
+    uint32_t maxDistance;
+    // Linhas da tabela: a linha d (tamanho |query| + 1) é a do prefixo de tamanho d
+    vector<uint32_t> rows;
+    // Menor valor de cada linha
+    vector<uint32_t> minimums;
+    // Última palavra lida e quantas linhas dela (a partir da 0) estão calculadas
+    string previous;
+    size_t computedRows;
+
+public:
+    LevenshteinAutomaton(const string& word, uint32_t distance)
+        : query(word), maxDistance(distance), computedRows(1) {
+        rows.resize(query.size() + 1);
+        for (size_t j = 0; j <= query.size(); ++j) {
+            rows[j] = static_cast<uint32_t>(j);
+        }
+        minimums.assign(1, 0);
+    }
+
+    /**
+     * Verifica se word está a no máximo maxDistance edições da consulta.
+     * Se nenhuma palavra com algum prefixo de word pode casar, preenche seek
+     * com a menor palavra maior que word que ainda pode casar, para o chamador
+     * saltar no dicionário; senão, deixa seek como está.
+     */
+    bool accepts(string_view word, string& seek) {
+        size_t width = query.size() + 1;
+        size_t shared = 0;
+        size_t limit = min({previous.size(), word.size(), computedRows - 1});
+        while (shared < limit && previous[shared] == word[shared]) {
+            ++shared;
+        }
+        previous.assign(word.data(), word.size());
+        if (minimums.size() < word.size() + 1) {
+            rows.resize((word.size() + 1) * width);
+            minimums.resize(word.size() + 1);
+        }
+
+        // Só as células da faixa podem ficar dentro do limite; as vizinhas da
+        // faixa guardam maxDistance + 1 para a linha seguinte
+        uint32_t over = maxDistance + 1;
+        size_t m = query.size();
+        for (size_t d = shared + 1; d <= word.size(); ++d) {
+            const uint32_t* above = rows.data() + (d - 1) * width;
+            uint32_t* row = rows.data() + d * width;
+            size_t low = d > maxDistance ? d - maxDistance : 1;
+            size_t high = min(m, d + maxDistance);
+            row[0] = min(static_cast<uint32_t>(d), over);
+            row[low - 1] = low > 1 ? over : row[0];
+            uint32_t smallest = row[low - 1];
+            unsigned char letter = static_cast<unsigned char>(word[d - 1]);
+            for (size_t j = low; j <= high; ++j) {
+                uint32_t substitution = above[j - 1] + (static_cast<unsigned char>(query[j - 1]) == letter ? 0 : 1);
+                row[j] = min({above[j] + 1, row[j - 1] + 1, substitution, over});
+                smallest = min(smallest, row[j]);
+            }
+            if (high < m) {
+                row[high + 1] = over;
+            }
+            minimums[d] = smallest;
+            if (smallest > maxDistance) {
+                computedRows = d;
+                nextCandidate(word, d, seek);
+                return false;
+            }
+        }
+        computedRows = word.size() + 1;
+        size_t length = word.size();
+        if (length > m + maxDistance || m > length + maxDistance) {
+            return false;
+        }
+        return rows[length * width + m] <= maxDistance;
+    }
+
+private:
+    /**
+     * Escreve em seek a menor palavra maior que word que ainda pode casar,
+     * sabendo que a linha d (do prefixo word[0, d)) passou do limite e que as
+     * anteriores não. Sobe pelos prefixos de word: no nível L, troca word[L - 1]
+     * pelo menor byte maior que mantém a linha L dentro do limite. Se a linha
+     * L - 1 tem mínimo menor que maxDistance, qualquer byte serve; se o mínimo
+     * é igual, só os bytes da consulta que continuam uma célula com o mínimo.
+     */
+    void nextCandidate(string_view word, size_t d, string& seek) const {
+        size_t width = query.size() + 1;
+        for (size_t level = d; level >= 1; --level) {
+            unsigned char current = static_cast<unsigned char>(word[level - 1]);
+            unsigned next = 0x100;
+            if (minimums[level - 1] < maxDistance) {
+                next = current + 1u;
+            } else {
+                const uint32_t* above = rows.data() + (level - 1) * width;
+                size_t low = level > maxDistance ? level - maxDistance : 1;
+                size_t high = min(query.size(), level + maxDistance);
+                for (size_t j = low; j <= high; ++j) {
+                    unsigned char letter = static_cast<unsigned char>(query[j - 1]);
+                    if (above[j - 1] <= maxDistance && letter > current && letter < next) {
+                        next = letter;
+                    }
+                }
+            }
+            if (next < 0x100) {
+                seek.assign(word.data(), level - 1);
+                seek.push_back(static_cast<char>(next));
+                return;
+            }
+        }
+        // Nenhuma palavra maior pode casar (só com bytes 0xFF, impossível em UTF-8)
+        seek.assign(word.size() + 1, static_cast<char>(0xFF));
+    }
+};
+
+#endif
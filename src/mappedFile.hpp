@@ -0,0 +1,78 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Mapeia um arquivo inteiro em memória, somente para leitura (mmap).
+ * O mapeamento é desfeito automaticamente no destrutor.
+ */
+class MappedFile {
+private:
+    // Início dos bytes mapeados (nullptr para arquivo vazio)
+    const unsigned char* bytes;
+    // Tamanho do arquivo em bytes
+    size_t length;
+
+public:
+    /**
+     * Abre e mapeia o arquivo.
+     * Lança uma exceção se não conseguir abrir ou mapear o arquivo.
+     */
+    explicit MappedFile(const string& filename) : bytes(nullptr), length(0) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Não foi possível abrir o arquivo para leitura: " + filename);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw runtime_error("Não foi possível obter o tamanho do arquivo: " + filename);
+        }
+
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                ::close(fd);
+                throw runtime_error("Não foi possível mapear o arquivo em memória: " + filename);
+            }
+            bytes = static_cast<const unsigned char*>(address);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (bytes != nullptr) {
+            munmap(const_cast<unsigned char*>(bytes), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Retorna o início dos bytes mapeados.
+     */
+    const unsigned char* data() const {
+        return bytes;
+    }
+
+    /**
+     * Retorna o tamanho do arquivo em bytes.
+     */
+    size_t size() const {
+        return length;
+    }
+};
+
+#endif
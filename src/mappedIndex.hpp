@@ -0,0 +1,950 @@
+#ifndef MAPPEDINDEX_HPP
+#define MAPPEDINDEX_HPP
+
+#include "mappedFile.hpp"
+#include "varByte.hpp"
+#include "postingSpan.hpp"
+#include "positionalList.hpp"
+#include "postingBlocks.hpp"
+#include "postingBitmap.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Cabeçalho do arquivo de índice na versão 2.
+ *
+ * Layout do arquivo (todos os deslocamentos são absolutos, em bytes):
+ * - cabeçalho;
+ * - tabela de documentos: numDocuments entradas DocumentEntry ordenadas por ID;
+ * - nomes dos arquivos, concatenados;
+ * - índice de blocos: numBlocks deslocamentos (uint64) de cada bloco do dicionário;
+ * - dicionário: palavras em ordem lexicográfica, em blocos de blockSize palavras
+ *   com codificação de prefixo (front coding). Cada entrada guarda, em varint,
+ *   o tamanho do prefixo comum com a palavra anterior, o tamanho do sufixo, o sufixo,
+ *   a quantidade de documentos e o deslocamento da lista de postings;
+ * - postings: diferenças entre IDs consecutivos, em varint.
+ * A primeira palavra de cada bloco é gravada inteira, o que permite busca binária
+ * sobre os blocos diretamente no arquivo mapeado.
+ *
+ * Extensões opcionais, indicadas em flags:
+ * - FLAG_FREQUENCIES: cada posting é o par (diferença, frequência da palavra no documento);
+ * - FLAG_SECTIONS: logo após o cabeçalho há um diretório de seções (uint64 com a
+ *   quantidade, seguido de entradas SectionEntry) com dados adicionais, como o
+ *   tamanho de cada documento. Seções desconhecidas são ignoradas na leitura;
+ * - FLAG_POSITIONS: cada posting ganha um terceiro varint que localiza as posições
+ *   da palavra no documento dentro da seção SECTION_POSITIONS (na primeira posting
+ *   da palavra, o deslocamento absoluto; nas seguintes, a diferença para o início
+ *   das posições da posting anterior). As posições de um documento são gravadas
+ *   em diferenças + varint, na mesma ordem das postings;
+ * - FLAG_OFFSETS: cada posting ganha mais um varint que localiza, da mesma forma,
+ *   os deslocamentos em bytes das primeiras ocorrências da palavra no arquivo
+ *   (OccurrenceOffsets) dentro da seção SECTION_OCCURRENCE_OFFSETS, também em
+ *   diferenças + varint.
+ *
+ * A seção SECTION_POSTING_BLOCKS resume os blocos de PostingBlocks::SIZE postings
+ * das listas mais longas que um bloco: uint64 com a quantidade de listas, as
+ * entradas PostingBlockEntry em ordem de deslocamento das postings e, em
+ * seguida, os PostingBlock de todas essas listas, com o deslocamento de cada
+ * bloco nas postings (ver decodeBlock).
+ *
+ * A seção SECTION_POSTING_BITMAPS guarda também como PostingBitmap as listas
+ * das palavras densas (PostingBitmap::isDense): uint64 com a quantidade de
+ * listas, as entradas PostingBitmapEntry em ordem de deslocamento das postings
+ * e, em seguida, os bitmaps serializados.
+ *
+ * O mesmo formato é usado pelos segmentos delta gravados por "atualizar"
+ * (index.dat.delta.N): eles contêm só os documentos novos ou modificados e,
+ * em seções próprias, os documentos removidos de segmentos anteriores.
+ */
+struct IndexFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t blockSize;
+    uint64_t numDocuments;
+    uint64_t numWords;
+    uint64_t numBlocks;
+    uint64_t docTableOffset;
+    uint64_t namesOffset;
+    uint64_t blockIndexOffset;
+    uint64_t dictionaryOffset;
+    uint64_t postingsOffset;
+    uint64_t fileSize;
+};
+
+/**
+ * Entrada do diretório de seções opcionais do arquivo de índice versão 2.
+ */
+struct SectionEntry {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+/**
+ * Entrada da tabela de documentos do arquivo de índice versão 2.
+ */
+struct DocumentEntry {
+    uint32_t docId;
+    uint32_t nameLength;
+    uint64_t nameOffset;
+};
+
+/**
+ * Metadados de um arquivo indexado, usados para detectar alterações na
+ * atualização incremental: tamanho, data de modificação (em nanossegundos)
+ * e hash do conteúdo.
+ */
+struct FileMetadata {
+    uint32_t docId;
+    uint32_t reserved;
+    uint64_t size;
+    int64_t modified;
+    uint64_t hash;
+};
+
+/**
+ * Índice somente leitura sobre um arquivo index.dat versão 2 mapeado em memória.
+ * Nada é carregado na abertura além da validação do cabeçalho: cada consulta faz
+ * busca binária no dicionário e decodifica apenas as postings da palavra pedida.
+ */
+class MappedIndex {
+public:
+    // Identificação do formato versão 2
+    static constexpr char MAGIC[4] = {'I', 'D', 'X', '2'};
+    static constexpr uint32_t VERSION = 2;
+    // Quantidade de palavras por bloco do dicionário
+    static constexpr uint32_t BLOCK_SIZE = 16;
+
+    // Extensões opcionais do formato (campo flags do cabeçalho)
+    static constexpr uint32_t FLAG_FREQUENCIES = 1;
+    static constexpr uint32_t FLAG_SECTIONS = 2;
+    static constexpr uint32_t FLAG_POSITIONS = 4;
+    static constexpr uint32_t FLAG_OFFSETS = 8;
+
+    // Seção com o total de palavras (uint64) e o tamanho de cada documento
+    // (uint32, na ordem da tabela de documentos)
+    static constexpr uint32_t SECTION_DOCUMENT_LENGTHS = 1;
+    // Seção com os metadados dos arquivos (FileMetadata, ordenados por ID).
+    // Um segmento delta pode atualizar os metadados de documentos anteriores
+    static constexpr uint32_t SECTION_FILE_METADATA = 2;
+    // Seção com os IDs (uint32, ordenados) de documentos de segmentos anteriores
+    // removidos por este segmento
+    static constexpr uint32_t SECTION_TOMBSTONES = 3;
+    // Seção com o número (uint64) do último segmento delta incorporado ao arquivo
+    static constexpr uint32_t SECTION_SEGMENT = 4;
+    // Seção com as posições das palavras nos documentos (ver FLAG_POSITIONS)
+    static constexpr uint32_t SECTION_POSITIONS = 5;
+    // Seção com as listas das palavras densas em PostingBitmap
+    static constexpr uint32_t SECTION_POSTING_BITMAPS = 7;
+    // Seção com os deslocamentos das primeiras ocorrências (ver FLAG_OFFSETS)
+    static constexpr uint32_t SECTION_OCCURRENCE_OFFSETS = 8;
+    // Seção com os resumos dos blocos das listas longas (ver PostingBlock). A
+    // seção 6, com os resumos sem o deslocamento dos blocos, não é mais lida
+    static constexpr uint32_t SECTION_POSTING_BLOCKS = 9;
+
+    /**
+     * Informações de uma palavra do dicionário.
+     */
+    struct WordInfo {
+        uint64_t docFreq;
+        uint64_t postingsOffset;
+    };
+
+private:
+    // Arquivo mapeado
+    MappedFile file;
+    // Cabeçalho já validado
+    IndexFileHeader header;
+    // Seção de tamanhos dos documentos (nullptr se o arquivo não a tiver)
+    const unsigned char* documentLengths;
+    // Seção de posições (nullptr se o arquivo não a tiver)
+    const unsigned char* positionsBegin;
+    const unsigned char* positionsEnd;
+    // Seção de deslocamentos das ocorrências (nullptr se o arquivo não a tiver)
+    const unsigned char* offsetsBegin;
+    const unsigned char* offsetsEnd;
+    // Seção de blocos das postings (nullptr se o arquivo não a tiver)
+    const unsigned char* blockEntries;
+    uint64_t blockEntryCount;
+    const unsigned char* blocks;
+    uint64_t blockCount;
+    // Seção de bitmaps das palavras densas (nullptr se o arquivo não a tiver)
+    const unsigned char* bitmapEntries;
+    uint64_t bitmapEntryCount;
+    const unsigned char* bitmapData;
+    uint64_t bitmapDataSize;
+
+public:
+    /**
+     * Mapeia o arquivo e valida o cabeçalho.
+     * Lança uma exceção se o arquivo não estiver no formato versão 2.
+     */
+    explicit MappedIndex(const string& filename)
+        : file(filename), documentLengths(nullptr), positionsBegin(nullptr), positionsEnd(nullptr),
+          offsetsBegin(nullptr), offsetsEnd(nullptr),
+          blockEntries(nullptr), blockEntryCount(0), blocks(nullptr), blockCount(0),
+          bitmapEntries(nullptr), bitmapEntryCount(0), bitmapData(nullptr), bitmapDataSize(0) {
+        if (!hasMagic(file.data(), file.size())) {
+            throw runtime_error("Arquivo de índice não está no formato versão 2: " + filename);
+        }
+        memcpy(&header, file.data(), sizeof(header));
+
+        uint64_t size = file.size();
+        if (header.version != VERSION || header.fileSize != size ||
+            header.blockSize == 0 ||
+            !fits(header.docTableOffset, header.numDocuments, sizeof(DocumentEntry), size) ||
+            header.namesOffset > size ||
+            !fits(header.blockIndexOffset, header.numBlocks, sizeof(uint64_t), size) ||
+            header.dictionaryOffset > size || header.postingsOffset > size ||
+            header.numBlocks != header.numWords / header.blockSize + (header.numWords % header.blockSize != 0)) {
+            throw runtime_error("Arquivo de índice corrompido: " + filename);
+        }
+
+        SectionEntry lengths;
+        if (findSection(SECTION_DOCUMENT_LENGTHS, lengths)) {
+            if (!fits(sizeof(uint64_t), header.numDocuments, sizeof(uint32_t), lengths.size)) {
+                throw runtime_error("Arquivo de índice corrompido: " + filename);
+            }
+            documentLengths = file.data() + lengths.offset;
+        }
+
+        if (hasPositions()) {
+            SectionEntry positions;
+            if (!findSection(SECTION_POSITIONS, positions)) {
+                throw runtime_error("Arquivo de índice corrompido: seção de posições ausente em " + filename);
+            }
+            positionsBegin = file.data() + positions.offset;
+            positionsEnd = positionsBegin + positions.size;
+        }
+
+        if (hasOffsets()) {
+            SectionEntry offsets;
+            if (!findSection(SECTION_OCCURRENCE_OFFSETS, offsets)) {
+                throw runtime_error("Arquivo de índice corrompido: seção de deslocamentos ausente em " + filename);
+            }
+            offsetsBegin = file.data() + offsets.offset;
+            offsetsEnd = offsetsBegin + offsets.size;
+        }
+
+        SectionEntry postingBlocks;
+        if (findSection(SECTION_POSTING_BLOCKS, postingBlocks)) {
+            const unsigned char* p = file.data() + postingBlocks.offset;
+            if (postingBlocks.size < sizeof(uint64_t)) {
+                throw runtime_error("Arquivo de índice corrompido: " + filename);
+            }
+            memcpy(&blockEntryCount, p, sizeof(blockEntryCount));
+            uint64_t available = postingBlocks.size - sizeof(uint64_t);
+            if (blockEntryCount > available / sizeof(PostingBlockEntry)) {
+                throw runtime_error("Arquivo de índice corrompido: " + filename);
+            }
+            blockEntries = p + sizeof(uint64_t);
+            blocks = blockEntries + blockEntryCount * sizeof(PostingBlockEntry);
+            blockCount = (available - blockEntryCount * sizeof(PostingBlockEntry)) / sizeof(PostingBlock);
+        }
+
+        SectionEntry postingBitmaps;
+        if (findSection(SECTION_POSTING_BITMAPS, postingBitmaps)) {
+            const unsigned char* p = file.data() + postingBitmaps.offset;
+            if (postingBitmaps.size < sizeof(uint64_t)) {
+                throw runtime_error("Arquivo de índice corrompido: " + filename);
+            }
+            memcpy(&bitmapEntryCount, p, sizeof(bitmapEntryCount));
+            uint64_t available = postingBitmaps.size - sizeof(uint64_t);
+            if (bitmapEntryCount > available / sizeof(PostingBitmapEntry)) {
+                throw runtime_error("Arquivo de índice corrompido: " + filename);
+            }
+            bitmapEntries = p + sizeof(uint64_t);
+            bitmapData = bitmapEntries + bitmapEntryCount * sizeof(PostingBitmapEntry);
+            bitmapDataSize = available - bitmapEntryCount * sizeof(PostingBitmapEntry);
+        }
+    }
+
+    /**
+     * Procura uma seção opcional pelo identificador.
+     * Retorna true e preenche entry se a seção existir.
+     */
+    bool findSection(uint32_t id, SectionEntry& entry) const {
+        if ((header.flags & FLAG_SECTIONS) == 0) {
+            return false;
+        }
+        const unsigned char* p = file.data() + sizeof(IndexFileHeader);
+        uint64_t count;
+        if (sizeof(IndexFileHeader) + sizeof(count) > header.fileSize) {
+            throw runtime_error("Arquivo de índice corrompido: diretório de seções fora do arquivo");
+        }
+        memcpy(&count, p, sizeof(count));
+        p += sizeof(count);
+        if (count > (header.fileSize - sizeof(IndexFileHeader) - sizeof(count)) / sizeof(SectionEntry)) {
+            throw runtime_error("Arquivo de índice corrompido: diretório de seções fora do arquivo");
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            memcpy(&entry, p + i * sizeof(SectionEntry), sizeof(SectionEntry));
+            if (entry.id == id) {
+                if (entry.offset > header.fileSize || entry.size > header.fileSize - entry.offset) {
+                    throw runtime_error("Arquivo de índice corrompido: seção fora do arquivo");
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Percorre os registros de tamanho fixo de uma seção opcional, chamando
+     * callback(registro) para cada um. Não faz nada se a seção não existir.
+     */
+    template <typename Record, typename Callback>
+    void forEachRecord(uint32_t id, Callback callback) const {
+        SectionEntry entry;
+        if (!findSection(id, entry)) {
+            return;
+        }
+        const unsigned char* p = file.data() + entry.offset;
+        for (uint64_t i = 0; i < entry.size / sizeof(Record); ++i) {
+            Record record;
+            memcpy(&record, p + i * sizeof(Record), sizeof(Record));
+            callback(record);
+        }
+    }
+
+    /**
+     * Retorna o número do último segmento delta incorporado ao arquivo
+     * (0 para um índice recém-construído).
+     */
+    uint64_t segmentSequence() const {
+        uint64_t sequence = 0;
+        forEachRecord<uint64_t>(SECTION_SEGMENT, [&](uint64_t value) { sequence = value; });
+        return sequence;
+    }
+
+    /**
+     * Retorna o tamanho do arquivo mapeado em bytes.
+     */
+    size_t byteCount() const {
+        return file.size();
+    }
+
+    /**
+     * Indica se as postings guardam a frequência da palavra em cada documento.
+     */
+    bool hasFrequencies() const {
+        return (header.flags & FLAG_FREQUENCIES) != 0;
+    }
+
+    /**
+     * Indica se o arquivo guarda as posições das palavras nos documentos.
+     */
+    bool hasPositions() const {
+        return (header.flags & FLAG_POSITIONS) != 0;
+    }
+
+    /**
+     * Indica se o arquivo guarda os deslocamentos das primeiras ocorrências.
+     */
+    bool hasOffsets() const {
+        return (header.flags & FLAG_OFFSETS) != 0;
+    }
+
+    /**
+     * Verifica se os bytes iniciais correspondem ao formato versão 2.
+     */
+    static bool hasMagic(const unsigned char* data, size_t size) {
+        return size >= sizeof(IndexFileHeader) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    /**
+     * Retorna a quantidade de documentos indexados.
+     */
+    size_t documentCount() const {
+        return header.numDocuments;
+    }
+
+    /**
+     * Retorna a quantidade de palavras distintas no dicionário.
+     */
+    size_t wordCount() const {
+        return header.numWords;
+    }
+
+    /**
+     * Retorna o menor ID de documento do arquivo (0 se não houver documentos).
+     */
+    uint32_t minDocumentId() const {
+        return header.numDocuments == 0 ? 0 : documentAt(0).docId;
+    }
+
+    /**
+     * Retorna o maior ID de documento do arquivo (0 se não houver documentos).
+     */
+    uint32_t maxDocumentId() const {
+        return header.numDocuments == 0 ? 0 : documentAt(header.numDocuments - 1).docId;
+    }
+
+    /**
+     * Procura uma palavra no dicionário.
+     * Retorna true e preenche info se a palavra existir.
+     */
+    bool findWord(string_view word, WordInfo& info) const {
+        if (header.numBlocks == 0) {
+            return false;
+        }
+
+        // Varredura sequencial dentro do bloco, reconstruindo os prefixos
+        size_t block = findBlock(word);
+        const unsigned char* p = blockStart(block);
+        const unsigned char* end = dictionaryEnd();
+        size_t remaining = wordsInBlock(block);
+        string current;
+        current.reserve(64);
+        while (remaining-- > 0) {
+            WordInfo entry;
+            readEntry(p, end, current, entry);
+            int comparison = string_view(current).compare(word);
+            if (comparison == 0) {
+                info = entry;
+                return true;
+            }
+            if (comparison > 0) {
+                break;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Percorre, em ordem, as palavras do dicionário que começam com prefix,
+     * chamando callback(palavra, info) até ele retornar false. Uma busca binária
+     * encontra o bloco da primeira palavra; depois só são lidas as palavras do
+     * intervalo (mais as anteriores do mesmo bloco).
+     */
+    template <typename Callback>
+    void forEachWordWithPrefix(string_view prefix, Callback callback) const {
+        if (header.numBlocks == 0) {
+            return;
+        }
+        const unsigned char* end = dictionaryEnd();
+        string current;
+        current.reserve(64);
+        for (size_t block = findBlock(prefix); block < header.numBlocks; ++block) {
+            const unsigned char* p = blockStart(block);
+            size_t remaining = wordsInBlock(block);
+            while (remaining-- > 0) {
+                WordInfo info;
+                readEntry(p, end, current, info);
+                if (string_view(current) < prefix) {
+                    continue;
+                }
+                if (string_view(current).compare(0, prefix.size(), prefix) != 0) {
+                    return;
+                }
+                if (!callback(static_cast<const string&>(current), info)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    /**
+     * Percorre o dicionário em ordem a partir da primeira palavra >= start,
+     * chamando callback(palavra, info, seek) até ele retornar false. Se o
+     * callback preencher seek com uma palavra maior, o percurso salta para a
+     * primeira palavra >= seek: busca galopante a partir do bloco atual (os
+     * saltos costumam ser curtos), ou continua no mesmo bloco se ela estiver nele.
+     */
+    template <typename Callback>
+    void scanWords(string_view start, Callback callback) const {
+        if (header.numBlocks == 0) {
+            return;
+        }
+        const unsigned char* end = dictionaryEnd();
+        string target(start);
+        string current;
+        string seek;
+        current.reserve(64);
+        size_t block = findBlock(target);
+        while (block < header.numBlocks) {
+            const unsigned char* p = blockStart(block);
+            size_t remaining = wordsInBlock(block);
+            size_t nextBlock = block + 1;
+            while (remaining-- > 0) {
+                WordInfo info;
+                readEntry(p, end, current, info);
+                if (current < target) {
+                    continue;
+                }
+                seek.clear();
+                if (!callback(static_cast<const string&>(current), info, seek)) {
+                    return;
+                }
+                if (!seek.empty()) {
+                    target = seek;
+                    size_t found = gallopBlock(target, block);
+                    if (found != block) {
+                        nextBlock = found;
+                        break;
+                    }
+                }
+            }
+            block = nextBlock;
+        }
+    }
+
+    /**
+     * Decodifica a lista de postings de uma palavra, chamando callback(docId, frequência)
+     * para cada documento em ordem crescente (frequência 1 se o arquivo não a armazena).
+     */
+    template <typename Callback>
+    void forEachPosting(const WordInfo& info, Callback callback) const {
+        forEachPositionedPosting(info, [&](int docId, uint32_t frequency, const EncodedPositions&) {
+            callback(docId, frequency);
+        });
+    }
+
+    /**
+     * Igual a forEachPosting, mas chama callback(docId, frequência, posições), com
+     * as posições ainda codificadas (start nulo se o arquivo não guarda posições;
+     * offsets nulo se não guarda os deslocamentos das ocorrências).
+     */
+    template <typename Callback>
+    void forEachPositionedPosting(const WordInfo& info, Callback callback) const {
+        const unsigned char* p = file.data() + header.postingsOffset + info.postingsOffset;
+        const unsigned char* end = file.data() + header.fileSize;
+        if (p > end) {
+            throw runtime_error("Arquivo de índice corrompido: postings fora do arquivo");
+        }
+        bool frequencies = hasFrequencies();
+        bool positional = hasPositions();
+        bool withOffsets = hasOffsets();
+        uint64_t docId = 0;
+        uint64_t positionOffset = 0;
+        uint64_t offsetsOffset = 0;
+        EncodedPositions positions = {nullptr, positionsEnd, nullptr, offsetsEnd};
+        for (uint64_t i = 0; i < info.docFreq; ++i) {
+            docId += VarByte::decode(p, end);
+            uint32_t frequency = frequencies ? static_cast<uint32_t>(VarByte::decode(p, end)) : 1;
+            if (positional) {
+                positionOffset += VarByte::decode(p, end);
+                if (positionOffset > static_cast<uint64_t>(positionsEnd - positionsBegin)) {
+                    throw runtime_error("Arquivo de índice corrompido: posições fora da seção");
+                }
+                positions.start = positionsBegin + positionOffset;
+            }
+            if (withOffsets) {
+                offsetsOffset += VarByte::decode(p, end);
+                if (offsetsOffset > static_cast<uint64_t>(offsetsEnd - offsetsBegin)) {
+                    throw runtime_error("Arquivo de índice corrompido: deslocamentos fora da seção");
+                }
+                positions.offsets = offsetsBegin + offsetsOffset;
+            }
+            callback(static_cast<int>(docId), frequency, static_cast<const EncodedPositions&>(positions));
+        }
+    }
+
+    /**
+     * Percorre todo o dicionário em ordem, chamando callback(palavra, info).
+     */
+    template <typename Callback>
+    void forEachWord(Callback callback) const {
+        const unsigned char* end = dictionaryEnd();
+        string current;
+        for (size_t block = 0; block < header.numBlocks; ++block) {
+            const unsigned char* p = blockStart(block);
+            size_t remaining = wordsInBlock(block);
+            while (remaining-- > 0) {
+                WordInfo info;
+                readEntry(p, end, current, info);
+                callback(static_cast<const string&>(current), info);
+            }
+        }
+    }
+
+    /**
+     * Percorre a tabela de documentos em ordem de ID, chamando callback(docId, nome).
+     */
+    template <typename Callback>
+    void forEachDocument(Callback callback) const {
+        for (size_t i = 0; i < header.numDocuments; ++i) {
+            DocumentEntry entry = documentAt(i);
+            callback(static_cast<int>(entry.docId), documentName(entry));
+        }
+    }
+
+    /**
+     * Copia para out os resumos dos blocos da lista da palavra, se o arquivo
+     * os guarda (listas com mais de um bloco).
+     * Retorna false se a palavra não existir ou não tiver blocos gravados.
+     */
+    bool getPostingBlocks(const string& word, vector<PostingBlock>& out) const {
+        WordInfo info;
+        if (blockEntries == nullptr || !findWord(word, info) || info.docFreq <= PostingBlocks::SIZE) {
+            return false;
+        }
+        // Busca binária pelo deslocamento das postings da palavra
+        uint64_t low = 0;
+        uint64_t high = blockEntryCount;
+        PostingBlockEntry entry = {0, 0};
+        while (low < high) {
+            uint64_t middle = low + (high - low) / 2;
+            memcpy(&entry, blockEntries + middle * sizeof(PostingBlockEntry), sizeof(entry));
+            if (entry.postingsOffset < info.postingsOffset) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < blockEntryCount) {
+            memcpy(&entry, blockEntries + low * sizeof(PostingBlockEntry), sizeof(entry));
+        }
+        size_t count = PostingBlocks::countFor(info.docFreq);
+        if (low == blockEntryCount || entry.postingsOffset != info.postingsOffset ||
+            entry.firstBlock > blockCount || count > blockCount - entry.firstBlock) {
+            throw runtime_error("Arquivo de índice corrompido: blocos de postings ausentes");
+        }
+        out.resize(count);
+        memcpy(out.data(), blocks + entry.firstBlock * sizeof(PostingBlock), count * sizeof(PostingBlock));
+        return true;
+    }
+
+    /**
+     * Decodifica em scratch as count postings de um bloco lido com
+     * getPostingBlocks, a partir do seu deslocamento, sem passar pelos blocos
+     * anteriores; previousDocId é o último documento do bloco anterior (0 no
+     * primeiro). As posições e os deslocamentos das ocorrências são pulados.
+     */
+    void decodeBlock(const PostingBlock& block, uint32_t previousDocId, size_t count, PostingScratch& scratch) const {
+        if (block.postingsOffset > header.fileSize - header.postingsOffset) {
+            throw runtime_error("Arquivo de índice corrompido: postings fora do arquivo");
+        }
+        const unsigned char* p = file.data() + header.postingsOffset + block.postingsOffset;
+        const unsigned char* end = file.data() + header.fileSize;
+        bool frequencies = hasFrequencies();
+        int ignored = (hasPositions() ? 1 : 0) + (hasOffsets() ? 1 : 0);
+        scratch.docIds.clear();
+        scratch.frequencies.clear();
+        uint64_t docId = previousDocId;
+        for (size_t i = 0; i < count; ++i) {
+            docId += VarByte::decode(p, end);
+            scratch.docIds.push_back(static_cast<uint32_t>(docId));
+            scratch.frequencies.push_back(frequencies ? static_cast<uint32_t>(VarByte::decode(p, end)) : 1);
+            for (int k = 0; k < ignored; ++k) {
+                VarByte::decode(p, end);
+            }
+        }
+    }
+
+    /**
+     * Indica se o arquivo guarda as listas das palavras densas em PostingBitmap.
+     */
+    bool hasPostingBitmaps() const {
+        return bitmapEntries != nullptr;
+    }
+
+    /**
+     * Lê para out a lista da palavra em PostingBitmap, se o arquivo a guarda
+     * nesse formato (palavras densas).
+     * Retorna false se a palavra não existir ou não for densa.
+     */
+    bool getPostingBitmap(const string& word, PostingBitmap& out) const {
+        WordInfo info;
+        if (bitmapEntries == nullptr || !findWord(word, info) ||
+            !PostingBitmap::isDense(info.docFreq, header.numDocuments)) {
+            return false;
+        }
+        // Busca binária pelo deslocamento das postings da palavra
+        uint64_t low = 0;
+        uint64_t high = bitmapEntryCount;
+        PostingBitmapEntry entry = {0, 0, 0};
+        while (low < high) {
+            uint64_t middle = low + (high - low) / 2;
+            memcpy(&entry, bitmapEntries + middle * sizeof(PostingBitmapEntry), sizeof(entry));
+            if (entry.postingsOffset < info.postingsOffset) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < bitmapEntryCount) {
+            memcpy(&entry, bitmapEntries + low * sizeof(PostingBitmapEntry), sizeof(entry));
+        }
+        if (low == bitmapEntryCount || entry.postingsOffset != info.postingsOffset ||
+            entry.offset > bitmapDataSize || entry.size > bitmapDataSize - entry.offset) {
+            throw runtime_error("Arquivo de índice corrompido: bitmap de postings ausente");
+        }
+        out = PostingBitmap::deserialize(bitmapData + entry.offset, entry.size);
+        return true;
+    }
+
+    /**
+     * Decodifica em scratch os IDs de documentos que contêm a palavra e
+     * retorna uma visão sobre eles (vazia se a palavra não existir).
+     */
+    PostingSpan getPostings(const string& word, vector<uint32_t>& scratch) const {
+        scratch.clear();
+        WordInfo info;
+        if (findWord(word, info)) {
+            scratch.reserve(info.docFreq);
+            forEachPosting(info, [&](int docId, uint32_t) { scratch.push_back(static_cast<uint32_t>(docId)); });
+        }
+        return PostingSpan(scratch);
+    }
+
+    /**
+     * Decodifica em scratch os documentos e as frequências da palavra.
+     */
+    PostingList getPostingList(const string& word, PostingScratch& scratch) const {
+        scratch.docIds.clear();
+        scratch.frequencies.clear();
+        WordInfo info;
+        if (findWord(word, info)) {
+            scratch.docIds.reserve(info.docFreq);
+            scratch.frequencies.reserve(info.docFreq);
+            forEachPosting(info, [&](int docId, uint32_t frequency) {
+                scratch.docIds.push_back(static_cast<uint32_t>(docId));
+                scratch.frequencies.push_back(frequency);
+            });
+        }
+        PostingList list;
+        list.docIds = PostingSpan(scratch.docIds);
+        if (hasFrequencies()) {
+            list.frequencies = PostingSpan(scratch.frequencies);
+        }
+        return list;
+    }
+
+    /**
+     * Decodifica em scratch os documentos e as frequências da palavra e guarda onde
+     * estão as posições de cada documento, sem decodificá-las.
+     * Lança uma exceção se o arquivo não guarda posições.
+     */
+    PositionalList getPositionalList(const string& word, PositionScratch& scratch) const {
+        if (!hasPositions()) {
+            throw runtime_error("O índice não guarda posições; construa-o com construir --posicoes");
+        }
+        scratch.docIds.clear();
+        scratch.frequencies.clear();
+        scratch.encoded.clear();
+        WordInfo info;
+        if (findWord(word, info)) {
+            forEachPositionedPosting(info, [&](int docId, uint32_t frequency, const EncodedPositions& positions) {
+                scratch.docIds.push_back(static_cast<uint32_t>(docId));
+                scratch.frequencies.push_back(frequency);
+                scratch.encoded.push_back(positions);
+            });
+        }
+        PositionalList list;
+        list.docIds = PostingSpan(scratch.docIds);
+        list.frequencies = PostingSpan(scratch.frequencies);
+        list.encoded = scratch.encoded.data();
+        return list;
+    }
+
+    /**
+     * Retorna o tamanho (quantidade de palavras indexadas) do documento,
+     * ou 0 se o arquivo não armazena tamanhos ou o ID não existe.
+     */
+    uint32_t getDocumentLength(int docId) const {
+        size_t position = documentPosition(docId);
+        if (documentLengths == nullptr || position == header.numDocuments) {
+            return 0;
+        }
+        uint32_t length;
+        memcpy(&length, documentLengths + sizeof(uint64_t) + position * sizeof(uint32_t), sizeof(length));
+        return length;
+    }
+
+    /**
+     * Retorna a soma dos tamanhos de todos os documentos (0 se não armazenada).
+     */
+    uint64_t getTotalLength() const {
+        if (documentLengths == nullptr) {
+            return 0;
+        }
+        uint64_t total;
+        memcpy(&total, documentLengths, sizeof(total));
+        return total;
+    }
+
+    /**
+     * Retorna o nome do arquivo do documento (busca binária na tabela de documentos).
+     * Se o ID não existe, retorna string vazia.
+     */
+    string getFileName(int docId) const {
+        size_t position = documentPosition(docId);
+        if (position == header.numDocuments) {
+            return "";
+        }
+        return string(documentName(documentAt(position)));
+    }
+
+    /**
+     * Retorna o ID do documento com o nome informado, ou -1 se não existir.
+     */
+    int getFileId(const string& filename) const {
+        for (size_t i = 0; i < header.numDocuments; ++i) {
+            DocumentEntry entry = documentAt(i);
+            if (documentName(entry) == filename) {
+                return static_cast<int>(entry.docId);
+            }
+        }
+        return -1;
+    }
+
+private:
+    /**
+     * Indica se count registros de elementSize bytes, a partir de offset,
+     * cabem em size bytes, sem estourar as contas com valores corrompidos.
+     */
+    static bool fits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) {
+        return offset <= size && count <= (size - offset) / elementSize;
+    }
+
+    /**
+     * Retorna a posição do documento na tabela (busca binária por ID),
+     * ou numDocuments se o ID não existe.
+     */
+    size_t documentPosition(int docId) const {
+        size_t low = 0;
+        size_t high = header.numDocuments;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            DocumentEntry entry = documentAt(middle);
+            if (static_cast<int64_t>(entry.docId) < docId) {
+                low = middle + 1;
+            } else if (static_cast<int64_t>(entry.docId) > docId) {
+                high = middle;
+            } else {
+                return middle;
+            }
+        }
+        return header.numDocuments;
+    }
+
+    /**
+     * Lê a i-ésima entrada da tabela de documentos.
+     */
+    DocumentEntry documentAt(size_t i) const {
+        DocumentEntry entry;
+        memcpy(&entry, file.data() + header.docTableOffset + i * sizeof(DocumentEntry), sizeof(entry));
+        if (header.namesOffset + entry.nameOffset + entry.nameLength > header.fileSize) {
+            throw runtime_error("Arquivo de índice corrompido: nome de documento fora do arquivo");
+        }
+        return entry;
+    }
+
+    /**
+     * Retorna o nome de um documento, apontando diretamente para o arquivo mapeado.
+     */
+    string_view documentName(const DocumentEntry& entry) const {
+        return string_view(reinterpret_cast<const char*>(file.data() + header.namesOffset + entry.nameOffset),
+                           entry.nameLength);
+    }
+
+    /**
+     * Busca binária pelo último bloco cuja primeira palavra é <= word
+     * (o bloco first se word vem antes de todas a partir dele).
+     */
+    size_t findBlock(string_view word, size_t first = 0) const {
+        size_t low = first;
+        size_t high = header.numBlocks;
+        while (high - low > 1) {
+            size_t middle = low + (high - low) / 2;
+            if (firstWordOfBlock(middle) <= word) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * Como findBlock, mas dobra o passo a partir do bloco first antes da busca
+     * binária: custa O(log distância) em vez de O(log blocos).
+     */
+    size_t gallopBlock(string_view word, size_t first) const {
+        size_t low = first;
+        size_t step = 1;
+        while (low + step < header.numBlocks && firstWordOfBlock(low + step) <= word) {
+            low += step;
+            step *= 2;
+        }
+        size_t high = min<size_t>(low + step, header.numBlocks);
+        while (high - low > 1) {
+            size_t middle = low + (high - low) / 2;
+            if (firstWordOfBlock(middle) <= word) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * Retorna o ponteiro para o início de um bloco do dicionário.
+     */
+    const unsigned char* blockStart(size_t block) const {
+        uint64_t offset;
+        memcpy(&offset, file.data() + header.blockIndexOffset + block * sizeof(uint64_t), sizeof(offset));
+        if (header.dictionaryOffset + offset > header.postingsOffset) {
+            throw runtime_error("Arquivo de índice corrompido: bloco fora do dicionário");
+        }
+        return file.data() + header.dictionaryOffset + offset;
+    }
+
+    /**
+     * Retorna o fim da seção do dicionário.
+     */
+    const unsigned char* dictionaryEnd() const {
+        return file.data() + header.postingsOffset;
+    }
+
+    /**
+     * Retorna a quantidade de palavras de um bloco (o último pode estar incompleto).
+     */
+    size_t wordsInBlock(size_t block) const {
+        uint64_t first = block * header.blockSize;
+        return static_cast<size_t>(min<uint64_t>(header.blockSize, header.numWords - first));
+    }
+
+    /**
+     * Retorna a primeira palavra de um bloco, sem cópia (ela é gravada sem prefixo).
+     */
+    string_view firstWordOfBlock(size_t block) const {
+        const unsigned char* p = blockStart(block);
+        const unsigned char* end = dictionaryEnd();
+        VarByte::decode(p, end);
+        uint64_t length = VarByte::decode(p, end);
+        if (length > static_cast<uint64_t>(end - p)) {
+            throw runtime_error("Arquivo de índice corrompido: palavra fora do dicionário");
+        }
+        return string_view(reinterpret_cast<const char*>(p), length);
+    }
+
+    /**
+     * Lê uma entrada do dicionário, atualizando current com a palavra reconstruída.
+     */
+    static void readEntry(const unsigned char*& p, const unsigned char* end, string& current, WordInfo& info) {
+        uint64_t prefix = VarByte::decode(p, end);
+        uint64_t suffix = VarByte::decode(p, end);
+        if (prefix > current.size() || suffix > static_cast<uint64_t>(end - p)) {
+            throw runtime_error("Arquivo de índice corrompido: entrada inválida no dicionário");
+        }
+        current.resize(prefix);
+        current.append(reinterpret_cast<const char*>(p), suffix);
+        p += suffix;
+        info.docFreq = VarByte::decode(p, end);
+        info.postingsOffset = VarByte::decode(p, end);
+    }
+};
+
+#endif
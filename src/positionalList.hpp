@@ -0,0 +1,120 @@
+#ifndef POSITIONALLIST_HPP
+#define POSITIONALLIST_HPP
+
+#include "postingSpan.hpp"
+#include "varByte.hpp"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Deslocamentos em bytes, a partir do início do arquivo, das primeiras
+ * ocorrências de uma palavra em um documento, guardados pelos índices
+ * construídos com --trechos: até LIMIT por posting, em ordem crescente.
+ */
+struct OccurrenceOffsets {
+    static constexpr uint32_t LIMIT = 3;
+
+    /**
+     * Quantidade de deslocamentos guardados para uma posting com a frequência informada.
+     */
+    static uint32_t countFor(uint32_t frequency) {
+        return frequency < LIMIT ? frequency : LIMIT;
+    }
+};
+
+/**
+ * Posições codificadas de uma palavra em um documento de um índice mapeado:
+ * início dos bytes e fim da seção de posições do arquivo (para validação).
+ * Nos índices com deslocamentos das ocorrências, offsets e offsetsEnd fazem
+ * o mesmo na seção de deslocamentos (nullptr nos demais).
+ */
+struct EncodedPositions {
+    const unsigned char* start;
+    const unsigned char* end;
+    const unsigned char* offsets = nullptr;
+    const unsigned char* offsetsEnd = nullptr;
+
+    /**
+     * Decodifica em out as count posições (diferenças + varint).
+     */
+    void decode(uint32_t count, vector<uint32_t>& out) const {
+        out.clear();
+        out.reserve(count);
+        const unsigned char* p = start;
+        uint64_t position = 0;
+        for (uint32_t k = 0; k < count; ++k) {
+            position += VarByte::decode(p, end);
+            out.push_back(static_cast<uint32_t>(position));
+        }
+    }
+
+    /**
+     * Decodifica em out os deslocamentos das primeiras ocorrências
+     * (OccurrenceOffsets::countFor(frequency), diferenças + varint). out fica
+     * vazio se o índice não os guarda.
+     */
+    void decodeOffsets(uint32_t frequency, vector<uint32_t>& out) const {
+        out.clear();
+        if (offsets == nullptr) {
+            return;
+        }
+        const unsigned char* p = offsets;
+        uint64_t offset = 0;
+        for (uint32_t k = OccurrenceOffsets::countFor(frequency); k > 0; --k) {
+            offset += VarByte::decode(p, offsetsEnd);
+            out.push_back(static_cast<uint32_t>(offset));
+        }
+    }
+};
+
+/**
+ * Buffers do chamador para uma lista posicional. Devem sobreviver à lista.
+ */
+struct PositionScratch {
+    vector<uint32_t> docIds;
+    vector<uint32_t> frequencies;
+    vector<uint64_t> rawOffsets;
+    vector<EncodedPositions> encoded;
+};
+
+/**
+ * Lista de postings com acesso às posições da palavra em cada documento.
+ * As posições não são decodificadas junto com a lista: positions(i) decodifica
+ * apenas as do i-ésimo documento, quando ele é candidato a casar uma frase.
+ *
+ * No índice congelado as posições ficam cruas na arena (rawPositions, a partir
+ * de rawOffsets[i]); no índice mapeado, em diferenças + varint (encoded[i]).
+ */
+struct PositionalList {
+    PostingSpan docIds;
+    PostingSpan frequencies;
+    const uint32_t* rawPositions = nullptr;
+    const uint64_t* rawOffsets = nullptr;
+    const EncodedPositions* encoded = nullptr;
+
+    /**
+     * Retorna a frequência da palavra no i-ésimo documento (= quantidade de posições).
+     */
+    uint32_t frequency(size_t i) const {
+        return frequencies[i];
+    }
+
+    /**
+     * Decodifica em out as posições (crescentes) da palavra no i-ésimo documento.
+     */
+    void positions(size_t i, vector<uint32_t>& out) const {
+        uint32_t count = frequencies[i];
+        if (encoded != nullptr) {
+            encoded[i].decode(count, out);
+        } else if (rawPositions != nullptr) {
+            const uint32_t* first = rawPositions + rawOffsets[i];
+            out.assign(first, first + count);
+        } else {
+            out.clear();
+        }
+    }
+};
+
+#endif
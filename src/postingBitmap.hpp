@@ -0,0 +1,642 @@
+#ifndef POSTINGBITMAP_HPP
+#define POSTINGBITMAP_HPP
+
+#include "postingSpan.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Entrada do índice da seção de bitmaps do arquivo de índice versão 2: onde
+ * está (deslocamento e tamanho, a partir do fim das entradas) o PostingBitmap
+ * serializado da palavra cujas postings começam em postingsOffset.
+ */
+struct PostingBitmapEntry {
+    uint64_t postingsOffset;
+    uint64_t offset;
+    uint64_t size;
+};
+
+/**
+ * Conjunto de IDs de documentos no estilo Roaring, usado para as listas de
+ * postings das palavras densas (presentes em boa parte da coleção).
+ *
+ * Os IDs são agrupados pelos 16 bits altos em contêineres de até 65536
+ * valores, e cada contêiner usa a representação que ocupa menos:
+ * - ARRAY: os 16 bits baixos em ordem (2 bytes por documento), para trechos esparsos;
+ * - BITMAP: 1024 palavras de 64 bits (8 KiB), para trechos densos;
+ * - RUN: pares (início, comprimento - 1), para faixas contínuas de IDs.
+ * As operações AND, OR e AND NOT têm um núcleo para cada par de
+ * representações: entre mapas de bits, operações palavra a palavra com
+ * popcount; entre um vetor e qualquer outro, filtragem do vetor; entre
+ * faixas, interseção ou união de intervalos.
+ */
+class PostingBitmap {
+public:
+    // Um contêiner de vetor guarda até ARRAY_LIMIT valores; acima disso, o
+    // mapa de bits ocupa menos
+    static constexpr size_t ARRAY_LIMIT = 4096;
+    // Palavras de 64 bits de um contêiner de mapa de bits
+    static constexpr size_t BITMAP_WORDS = 65536 / 64;
+    // Palavras com pelo menos MIN_DOCUMENTS documentos, presentes em pelo
+    // menos 1/DENSITY_RATIO da coleção, são densas
+    static constexpr size_t MIN_DOCUMENTS = 1024;
+    static constexpr size_t DENSITY_RATIO = 64;
+
+    /**
+     * Indica se uma palavra com docFreq documentos, em uma coleção com
+     * documentCount documentos, é densa (o arquivo de índice guarda também
+     * a lista dela como PostingBitmap).
+     */
+    static bool isDense(size_t docFreq, size_t documentCount) {
+        return docFreq >= MIN_DOCUMENTS && docFreq * DENSITY_RATIO >= documentCount;
+    }
+
+private:
+    enum Type : uint8_t { ARRAY = 0, BITMAP = 1, RUN = 2 };
+
+    /**
+     * Contêiner dos IDs com os mesmos 16 bits altos (key). ARRAY e RUN usam
+     * values; BITMAP usa words.
+     */
+    struct Container {
+        uint16_t key = 0;
+        Type type = ARRAY;
+        uint32_t cardinality = 0;
+        vector<uint16_t> values;
+        vector<uint64_t> words;
+    };
+
+    // Cabeçalho de um contêiner serializado, seguido de length valores de
+    // 16 bits (ARRAY e RUN) ou palavras de 64 bits (BITMAP)
+    struct ContainerHeader {
+        uint16_t key;
+        uint8_t type;
+        uint8_t reserved;
+        uint32_t cardinality;
+        uint32_t length;
+    };
+
+    // Contêineres em ordem de key, nenhum vazio
+    vector<Container> containers;
+
+public:
+    /**
+     * Monta o conjunto a partir de uma lista de IDs em ordem crescente.
+     */
+    static PostingBitmap fromSorted(PostingSpan ids) {
+        PostingBitmap bitmap;
+        for (size_t start = 0; start < ids.size();) {
+            Container container;
+            container.key = static_cast<uint16_t>(ids[start] >> 16);
+            size_t end = start;
+            while (end < ids.size() && (ids[end] >> 16) == container.key) {
+                container.values.push_back(static_cast<uint16_t>(ids[end]));
+                ++end;
+            }
+            container.cardinality = static_cast<uint32_t>(end - start);
+            if (container.cardinality > ARRAY_LIMIT) {
+                container.words = toWords(container);
+                container.values = vector<uint16_t>();
+                container.type = BITMAP;
+            }
+            optimize(container);
+            bitmap.containers.push_back(move(container));
+            start = end;
+        }
+        return bitmap;
+    }
+
+    /**
+     * Quantidade de IDs do conjunto.
+     */
+    size_t cardinality() const {
+        size_t total = 0;
+        for (const Container& container : containers) {
+            total += container.cardinality;
+        }
+        return total;
+    }
+
+    bool empty() const {
+        return containers.empty();
+    }
+
+    /**
+     * Bytes ocupados pelos contêineres.
+     */
+    size_t memoryUsage() const {
+        size_t bytes = containers.capacity() * sizeof(Container);
+        for (const Container& container : containers) {
+            bytes += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    /**
+     * Retorna os IDs do conjunto em ordem crescente.
+     */
+    vector<uint32_t> toVector() const {
+        vector<uint32_t> ids;
+        ids.reserve(cardinality());
+        for (const Container& container : containers) {
+            uint32_t base = static_cast<uint32_t>(container.key) << 16;
+            forEach(container, [&](uint32_t low) { ids.push_back(base | low); });
+        }
+        return ids;
+    }
+
+    /**
+     * Copia para out os IDs da lista ordenada ids que estão no conjunto
+     * (keep = true, interseção) ou que não estão (keep = false, diferença).
+     * out precisa ter espaço para ids.size() valores.
+     * Retorna a quantidade de IDs escritos.
+     */
+    size_t filter(PostingSpan ids, uint32_t* out, bool keep) const {
+        size_t written = 0;
+        size_t c = 0;
+        size_t cursor = 0;
+        for (uint32_t id : ids) {
+            uint16_t key = static_cast<uint16_t>(id >> 16);
+            while (c < containers.size() && containers[c].key < key) {
+                ++c;
+                cursor = 0;
+            }
+            bool found = c < containers.size() && containers[c].key == key &&
+                         containsFrom(containers[c], static_cast<uint16_t>(id), cursor);
+            if (found == keep) {
+                out[written++] = id;
+            }
+        }
+        return written;
+    }
+
+    /**
+     * Interseção (AND) de dois conjuntos.
+     */
+    static PostingBitmap intersect(const PostingBitmap& a, const PostingBitmap& b) {
+        PostingBitmap result;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.containers.size() && j < b.containers.size()) {
+            const Container& x = a.containers[i];
+            const Container& y = b.containers[j];
+            if (x.key < y.key) {
+                ++i;
+            } else if (y.key < x.key) {
+                ++j;
+            } else {
+                result.append(intersectContainers(x, y));
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * União (OR) de dois conjuntos.
+     */
+    static PostingBitmap unite(const PostingBitmap& a, const PostingBitmap& b) {
+        PostingBitmap result;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.containers.size() || j < b.containers.size()) {
+            if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key)) {
+                result.containers.push_back(a.containers[i++]);
+            } else if (i == a.containers.size() || b.containers[j].key < a.containers[i].key) {
+                result.containers.push_back(b.containers[j++]);
+            } else {
+                result.append(uniteContainers(a.containers[i++], b.containers[j++]));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Diferença (AND NOT): os IDs de a que não estão em b.
+     */
+    static PostingBitmap difference(const PostingBitmap& a, const PostingBitmap& b) {
+        PostingBitmap result;
+        size_t j = 0;
+        for (const Container& x : a.containers) {
+            while (j < b.containers.size() && b.containers[j].key < x.key) {
+                ++j;
+            }
+            if (j < b.containers.size() && b.containers[j].key == x.key) {
+                result.append(subtractContainers(x, b.containers[j]));
+            } else {
+                result.containers.push_back(x);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Acrescenta o conjunto serializado a out: uint32 com a quantidade de
+     * contêineres e, para cada um, um ContainerHeader seguido dos dados.
+     */
+    void serialize(string& out) const {
+        uint32_t count = static_cast<uint32_t>(containers.size());
+        out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const Container& container : containers) {
+            ContainerHeader header = {container.key, container.type, 0, container.cardinality, 0};
+            if (container.type == BITMAP) {
+                header.length = static_cast<uint32_t>(container.words.size());
+                out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+                out.append(reinterpret_cast<const char*>(container.words.data()), header.length * sizeof(uint64_t));
+            } else {
+                header.length = static_cast<uint32_t>(container.values.size());
+                out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+                out.append(reinterpret_cast<const char*>(container.values.data()), header.length * sizeof(uint16_t));
+            }
+        }
+    }
+
+    /**
+     * Lê um conjunto gravado por serialize.
+     * Lança uma exceção se os dados estiverem corrompidos.
+     */
+    static PostingBitmap deserialize(const unsigned char* data, size_t size) {
+        PostingBitmap bitmap;
+        uint32_t count = 0;
+        if (size < sizeof(count)) {
+            corrupted();
+        }
+        memcpy(&count, data, sizeof(count));
+        size_t offset = sizeof(count);
+        bitmap.containers.reserve(min<size_t>(count, size / sizeof(ContainerHeader)));
+        for (uint32_t i = 0; i < count; ++i) {
+            ContainerHeader header;
+            if (size - offset < sizeof(header)) {
+                corrupted();
+            }
+            memcpy(&header, data + offset, sizeof(header));
+            offset += sizeof(header);
+
+            Container container;
+            container.key = header.key;
+            container.type = static_cast<Type>(header.type);
+            container.cardinality = header.cardinality;
+            size_t elementSize = header.type == BITMAP ? sizeof(uint64_t) : sizeof(uint16_t);
+            bool valid = header.type <= RUN && header.cardinality > 0 && header.cardinality <= 65536 &&
+                         (bitmap.containers.empty() || bitmap.containers.back().key < header.key) &&
+                         (header.type != ARRAY || header.length == header.cardinality) &&
+                         (header.type != BITMAP || header.length == BITMAP_WORDS) &&
+                         (header.type != RUN || header.length % 2 == 0) &&
+                         header.length <= (size - offset) / elementSize;
+            if (!valid) {
+                corrupted();
+            }
+            if (header.type == BITMAP) {
+                container.words.resize(header.length);
+                memcpy(container.words.data(), data + offset, header.length * elementSize);
+            } else {
+                container.values.resize(header.length);
+                memcpy(container.values.data(), data + offset, header.length * elementSize);
+            }
+            offset += header.length * elementSize;
+            bitmap.containers.push_back(move(container));
+        }
+        return bitmap;
+    }
+
+private:
+    [[noreturn]] static void corrupted() {
+        throw runtime_error("Arquivo de índice corrompido: bitmap de postings inválido");
+    }
+
+    /**
+     * Acrescenta o contêiner ao resultado, se não estiver vazio.
+     */
+    void append(Container&& container) {
+        if (container.cardinality > 0) {
+            containers.push_back(move(container));
+        }
+    }
+
+    /**
+     * Chama callback(valor) para cada valor (16 bits baixos) do contêiner, em ordem.
+     */
+    template <typename Callback>
+    static void forEach(const Container& container, Callback callback) {
+        switch (container.type) {
+            case ARRAY:
+                for (uint16_t value : container.values) {
+                    callback(value);
+                }
+                break;
+            case BITMAP:
+                for (size_t w = 0; w < container.words.size(); ++w) {
+                    for (uint64_t word = container.words[w]; word != 0; word &= word - 1) {
+                        callback(static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+                    }
+                }
+                break;
+            case RUN:
+                for (size_t r = 0; r < container.values.size(); r += 2) {
+                    uint32_t last = static_cast<uint32_t>(container.values[r]) + container.values[r + 1];
+                    for (uint32_t value = container.values[r]; value <= last; ++value) {
+                        callback(value);
+                    }
+                }
+                break;
+        }
+    }
+
+    /**
+     * Indica se o contêiner tem o valor. cursor guarda a posição da busca
+     * anterior no contêiner e só avança: as consultas devem vir em ordem crescente.
+     */
+    static bool containsFrom(const Container& container, uint16_t value, size_t& cursor) {
+        switch (container.type) {
+            case ARRAY:
+                cursor = static_cast<size_t>(
+                    lower_bound(container.values.begin() + cursor, container.values.end(), value) -
+                    container.values.begin());
+                return cursor < container.values.size() && container.values[cursor] == value;
+            case BITMAP:
+                return (container.words[value >> 6] >> (value & 63)) & 1;
+            case RUN:
+                while (cursor < container.values.size() &&
+                       static_cast<uint32_t>(container.values[cursor]) + container.values[cursor + 1] < value) {
+                    cursor += 2;
+                }
+                return cursor < container.values.size() && container.values[cursor] <= value;
+        }
+        return false;
+    }
+
+    /**
+     * Liga (set = true) ou desliga os bits first a last (inclusive) do mapa de bits.
+     */
+    static void fillRange(vector<uint64_t>& words, uint32_t first, uint32_t last, bool set) {
+        size_t firstWord = first >> 6;
+        size_t lastWord = last >> 6;
+        for (size_t w = firstWord; w <= lastWord; ++w) {
+            uint64_t mask = ~uint64_t(0);
+            if (w == firstWord) {
+                mask &= ~uint64_t(0) << (first & 63);
+            }
+            if (w == lastWord) {
+                mask &= ~uint64_t(0) >> (63 - (last & 63));
+            }
+            words[w] = set ? (words[w] | mask) : (words[w] & ~mask);
+        }
+    }
+
+    /**
+     * Retorna o contêiner como mapa de bits.
+     */
+    static vector<uint64_t> toWords(const Container& container) {
+        if (container.type == BITMAP) {
+            return container.words;
+        }
+        vector<uint64_t> words(BITMAP_WORDS, 0);
+        if (container.type == RUN) {
+            for (size_t r = 0; r < container.values.size(); r += 2) {
+                fillRange(words, container.values[r],
+                          static_cast<uint32_t>(container.values[r]) + container.values[r + 1], true);
+            }
+        } else {
+            for (uint16_t value : container.values) {
+                words[value >> 6] |= uint64_t(1) << (value & 63);
+            }
+        }
+        return words;
+    }
+
+    static uint32_t popcount(const vector<uint64_t>& words) {
+        uint32_t count = 0;
+        for (uint64_t word : words) {
+            count += static_cast<uint32_t>(__builtin_popcountll(word));
+        }
+        return count;
+    }
+
+    /**
+     * Quantidade de faixas contínuas de valores do contêiner.
+     */
+    static size_t countRuns(const Container& container) {
+        switch (container.type) {
+            case ARRAY: {
+                size_t runs = 0;
+                for (size_t i = 0; i < container.values.size(); ++i) {
+                    runs += i == 0 || container.values[i] != container.values[i - 1] + 1;
+                }
+                return runs;
+            }
+            case BITMAP: {
+                // Inícios de faixa: bits ligados cujo anterior está desligado
+                size_t runs = 0;
+                uint64_t carry = 0;
+                for (uint64_t word : container.words) {
+                    runs += static_cast<size_t>(__builtin_popcountll(word & ~((word << 1) | carry)));
+                    carry = word >> 63;
+                }
+                return runs;
+            }
+            case RUN:
+                return container.values.size() / 2;
+        }
+        return 0;
+    }
+
+    /**
+     * Troca a representação do contêiner pela que ocupa menos: faixas, se
+     * forem menores que as outras duas; senão vetor até ARRAY_LIMIT valores
+     * e mapa de bits acima disso.
+     */
+    static void optimize(Container& container) {
+        if (container.cardinality == 0) {
+            return;
+        }
+        size_t runBytes = countRuns(container) * 2 * sizeof(uint16_t);
+        size_t arrayBytes = container.cardinality * sizeof(uint16_t);
+        size_t bitmapBytes = BITMAP_WORDS * sizeof(uint64_t);
+        Type best = container.cardinality <= ARRAY_LIMIT ? ARRAY : BITMAP;
+        if (runBytes < min(arrayBytes, bitmapBytes)) {
+            best = RUN;
+        }
+        if (best == container.type) {
+            return;
+        }
+
+        Container converted;
+        converted.key = container.key;
+        converted.type = best;
+        converted.cardinality = container.cardinality;
+        if (best == BITMAP) {
+            converted.words = toWords(container);
+        } else if (best == ARRAY) {
+            converted.values.reserve(container.cardinality);
+            forEach(container, [&](uint32_t value) { converted.values.push_back(static_cast<uint16_t>(value)); });
+        } else {
+            uint32_t start = 0;
+            uint32_t previous = 0;
+            bool open = false;
+            forEach(container, [&](uint32_t value) {
+                if (open && value == previous + 1) {
+                    previous = value;
+                    return;
+                }
+                if (open) {
+                    converted.values.push_back(static_cast<uint16_t>(start));
+                    converted.values.push_back(static_cast<uint16_t>(previous - start));
+                }
+                start = previous = value;
+                open = true;
+            });
+            converted.values.push_back(static_cast<uint16_t>(start));
+            converted.values.push_back(static_cast<uint16_t>(previous - start));
+        }
+        container = move(converted);
+    }
+
+    /**
+     * Filtra os valores de um contêiner de vetor pelos que estão (keep = true)
+     * ou não estão (keep = false) em other.
+     */
+    static Container filterArray(const Container& array, const Container& other, bool keep) {
+        Container result;
+        result.key = array.key;
+        if (other.type == ARRAY) {
+            // Dois vetores: intercalação linear
+            const vector<uint16_t>& x = array.values;
+            const vector<uint16_t>& y = other.values;
+            result.values.resize(x.size());
+            auto end = keep ? set_intersection(x.begin(), x.end(), y.begin(), y.end(), result.values.begin())
+                            : set_difference(x.begin(), x.end(), y.begin(), y.end(), result.values.begin());
+            result.values.resize(static_cast<size_t>(end - result.values.begin()));
+        } else {
+            size_t cursor = 0;
+            for (uint16_t value : array.values) {
+                if (containsFrom(other, value, cursor) == keep) {
+                    result.values.push_back(value);
+                }
+            }
+        }
+        result.cardinality = static_cast<uint32_t>(result.values.size());
+        optimize(result);
+        return result;
+    }
+
+    /**
+     * Contêiner de mapa de bits com as palavras dadas, na melhor representação.
+     */
+    static Container fromWords(uint16_t key, vector<uint64_t>&& words) {
+        Container result;
+        result.key = key;
+        result.type = BITMAP;
+        result.cardinality = popcount(words);
+        result.words = move(words);
+        optimize(result);
+        return result;
+    }
+
+    static Container intersectContainers(const Container& x, const Container& y) {
+        if (x.type == ARRAY) {
+            return filterArray(x, y, true);
+        }
+        if (y.type == ARRAY) {
+            return filterArray(y, x, true);
+        }
+        if (x.type == RUN && y.type == RUN) {
+            // Interseção de intervalos
+            Container result;
+            result.key = x.key;
+            result.type = RUN;
+            size_t i = 0;
+            size_t j = 0;
+            while (i < x.values.size() && j < y.values.size()) {
+                uint32_t xLast = static_cast<uint32_t>(x.values[i]) + x.values[i + 1];
+                uint32_t yLast = static_cast<uint32_t>(y.values[j]) + y.values[j + 1];
+                uint32_t first = max(x.values[i], y.values[j]);
+                uint32_t last = min(xLast, yLast);
+                if (first <= last) {
+                    result.values.push_back(static_cast<uint16_t>(first));
+                    result.values.push_back(static_cast<uint16_t>(last - first));
+                    result.cardinality += last - first + 1;
+                }
+                (xLast < yLast ? i : j) += 2;
+            }
+            optimize(result);
+            return result;
+        }
+        // Mapa de bits com mapa de bits ou com faixas: palavra a palavra
+        vector<uint64_t> words = toWords(x);
+        const vector<uint64_t> other = y.type == BITMAP ? vector<uint64_t>() : toWords(y);
+        const vector<uint64_t>& mask = y.type == BITMAP ? y.words : other;
+        for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+            words[w] &= mask[w];
+        }
+        return fromWords(x.key, move(words));
+    }
+
+    static Container uniteContainers(const Container& x, const Container& y) {
+        if (x.type == ARRAY && y.type == ARRAY && x.cardinality + y.cardinality <= ARRAY_LIMIT) {
+            Container result;
+            result.key = x.key;
+            result.values.resize(x.values.size() + y.values.size());
+            result.values.resize(static_cast<size_t>(
+                set_union(x.values.begin(), x.values.end(), y.values.begin(), y.values.end(), result.values.begin()) -
+                result.values.begin()));
+            result.cardinality = static_cast<uint32_t>(result.values.size());
+            optimize(result);
+            return result;
+        }
+        vector<uint64_t> words = toWords(x.type == BITMAP || y.type != BITMAP ? x : y);
+        const Container& other = x.type == BITMAP || y.type != BITMAP ? y : x;
+        switch (other.type) {
+            case ARRAY:
+                for (uint16_t value : other.values) {
+                    words[value >> 6] |= uint64_t(1) << (value & 63);
+                }
+                break;
+            case BITMAP:
+                for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+                    words[w] |= other.words[w];
+                }
+                break;
+            case RUN:
+                for (size_t r = 0; r < other.values.size(); r += 2) {
+                    fillRange(words, other.values[r], static_cast<uint32_t>(other.values[r]) + other.values[r + 1], true);
+                }
+                break;
+        }
+        return fromWords(x.key, move(words));
+    }
+
+    static Container subtractContainers(const Container& x, const Container& y) {
+        if (x.type == ARRAY) {
+            return filterArray(x, y, false);
+        }
+        vector<uint64_t> words = toWords(x);
+        switch (y.type) {
+            case ARRAY:
+                for (uint16_t value : y.values) {
+                    words[value >> 6] &= ~(uint64_t(1) << (value & 63));
+                }
+                break;
+            case BITMAP:
+                for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+                    words[w] &= ~y.words[w];
+                }
+                break;
+            case RUN:
+                for (size_t r = 0; r < y.values.size(); r += 2) {
+                    fillRange(words, y.values[r], static_cast<uint32_t>(y.values[r]) + y.values[r + 1], false);
+                }
+                break;
+        }
+        return fromWords(x.key, move(words));
+    }
+};
+
+#endif
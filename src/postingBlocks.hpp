@@ -0,0 +1,76 @@
+#ifndef POSTINGBLOCKS_HPP
+#define POSTINGBLOCKS_HPP
+
+#include "postingSpan.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Resumo de um bloco de postings consecutivas de uma palavra, usado para
+ * pular documentos na busca ranqueada (block-max): o último documento do
+ * bloco, a maior frequência da palavra e o menor tamanho de documento entre
+ * as postings do bloco. Como a pontuação BM25 cresce com a frequência e cai
+ * com o tamanho do documento, a pontuação de (maxFrequency, minLength) limita
+ * a de qualquer posting do bloco, com qualquer quantidade de documentos e
+ * tamanho médio (os de um shard ou os da coleção inteira).
+ *
+ * Nos blocos gravados no arquivo, postingsOffset é onde começa o bloco na
+ * seção de postings (como WordInfo::postingsOffset): com o lastDocId do bloco
+ * anterior, permite decodificar o bloco sem decodificar os anteriores.
+ */
+struct PostingBlock {
+    uint32_t lastDocId;
+    uint32_t maxFrequency;
+    uint32_t minLength;
+    uint32_t reserved;
+    uint64_t postingsOffset;
+};
+
+/**
+ * Entrada do índice da seção de blocos do arquivo de índice versão 2: onde
+ * começam os blocos da palavra cujas postings começam em postingsOffset.
+ */
+struct PostingBlockEntry {
+    uint64_t postingsOffset;
+    uint64_t firstBlock;
+};
+
+/**
+ * Divisão das listas de postings em blocos de SIZE postings.
+ */
+class PostingBlocks {
+public:
+    // Postings por bloco; listas com até SIZE postings têm um único bloco e
+    // não são gravadas no arquivo (o resumo sai da própria lista)
+    static constexpr size_t SIZE = 64;
+
+    /**
+     * Quantidade de blocos de uma lista com count postings.
+     */
+    static size_t countFor(size_t count) {
+        return (count + SIZE - 1) / SIZE;
+    }
+
+    /**
+     * Acrescenta a blocks o resumo de cada bloco da lista. lengthOf(docId)
+     * retorna o tamanho do documento.
+     */
+    template <typename LengthOf>
+    static void summarize(const PostingList& list, LengthOf lengthOf, vector<PostingBlock>& blocks) {
+        for (size_t start = 0; start < list.docIds.size(); start += SIZE) {
+            size_t end = min(start + SIZE, list.docIds.size());
+            PostingBlock block = {list.docIds[end - 1], 0, UINT32_MAX, 0, 0};
+            for (size_t i = start; i < end; ++i) {
+                block.maxFrequency = max(block.maxFrequency, list.frequency(i));
+                block.minLength = min(block.minLength, static_cast<uint32_t>(lengthOf(list.docIds[i])));
+            }
+            blocks.push_back(block);
+        }
+    }
+};
+
+#endif
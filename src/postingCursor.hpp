@@ -0,0 +1,188 @@
+#ifndef POSTINGCURSOR_HPP
+#define POSTINGCURSOR_HPP
+
+#include "postingSpan.hpp"
+#include "postingBlocks.hpp"
+#include "mappedIndex.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Cursor que percorre, em ordem de ID, a lista de postings de uma palavra,
+ * usado pela busca ranqueada.
+ *
+ * Sobre um arquivo mapeado que guarda os blocos da lista (PostingBlock com o
+ * deslocamento), cada bloco de PostingBlocks::SIZE postings só é decodificado
+ * quando o cursor para nele: seek pula, pelo lastDocId dos resumos, os blocos
+ * que terminam antes do documento procurado, e blockOf só consulta os resumos.
+ * Nos demais casos (índice em memória, segmentos delta, listas de um bloco)
+ * a lista já vem inteira, e os resumos, se pedidos, são calculados dela.
+ *
+ * As visões da lista apontam para os buffers do próprio cursor ou para a
+ * arena do índice, então o cursor pode ser movido, mas não copiado.
+ */
+class PostingCursor {
+private:
+    // Arquivo de onde os blocos são decodificados (nullptr: lista inteira em list)
+    const MappedIndex* mapped;
+    vector<PostingBlock> summaries;
+    size_t count;
+    // A lista inteira ou o bloco decodificado, que começa na posting base
+    PostingList list;
+    PostingScratch scratch;
+    size_t base;
+    size_t loaded;
+    // Posting atual e bloco atual de blockOf
+    size_t position;
+    size_t shallow;
+    size_t decoded;
+
+    /**
+     * Decodifica o bloco b, se ainda não for o bloco em list.
+     */
+    void load(size_t b) {
+        if (mapped == nullptr || loaded == b) {
+            return;
+        }
+        size_t first = b * PostingBlocks::SIZE;
+        size_t size = min(PostingBlocks::SIZE, count - first);
+        mapped->decodeBlock(summaries[b], b == 0 ? 0 : summaries[b - 1].lastDocId, size, scratch);
+        list = {PostingSpan(scratch.docIds), PostingSpan(scratch.frequencies)};
+        base = first;
+        loaded = b;
+        decoded += size;
+    }
+
+public:
+    PostingCursor() : mapped(nullptr), count(0), base(0), loaded(0), position(0), shallow(0), decoded(0) {}
+
+    /**
+     * Cursor sobre uma lista já lida inteira; postings é o buffer que a
+     * guarda (se não estiver na arena do índice) e blocks, os resumos dos
+     * blocos (vazio se os limites não forem usados).
+     */
+    PostingCursor(PostingList postingList, PostingScratch postings, vector<PostingBlock> blocks)
+        : mapped(nullptr), summaries(move(blocks)), count(postingList.docIds.size()), list(postingList),
+          scratch(move(postings)), base(0), loaded(0), position(0), shallow(0), decoded(count) {}
+
+    /**
+     * Cursor sobre os count postings de uma palavra do arquivo, com os
+     * resumos dos blocos lidos por MappedIndex::getPostingBlocks.
+     */
+    PostingCursor(const MappedIndex& file, vector<PostingBlock> blocks, size_t postings)
+        : mapped(&file), summaries(move(blocks)), count(postings), base(0), loaded(SIZE_MAX), position(0),
+          shallow(0), decoded(0) {}
+
+    PostingCursor(const PostingCursor&) = delete;
+    PostingCursor& operator=(const PostingCursor&) = delete;
+    PostingCursor(PostingCursor&&) = default;
+    PostingCursor& operator=(PostingCursor&&) = default;
+
+    /**
+     * Quantidade de documentos da lista.
+     */
+    size_t size() const {
+        return count;
+    }
+
+    /**
+     * Resumos dos blocos da lista.
+     */
+    const vector<PostingBlock>& blocks() const {
+        return summaries;
+    }
+
+    /**
+     * Quantidade de postings decodificadas até agora (todas, se a lista veio inteira).
+     */
+    size_t decodedCount() const {
+        return decoded;
+    }
+
+    bool atEnd() const {
+        return position >= count;
+    }
+
+    /**
+     * Documento da posting atual (o cursor não pode estar no fim).
+     */
+    uint32_t docId() {
+        load(position / PostingBlocks::SIZE);
+        return list.docIds[position - base];
+    }
+
+    /**
+     * Frequência da palavra no documento atual.
+     */
+    uint32_t frequency() {
+        load(position / PostingBlocks::SIZE);
+        return list.frequency(position - base);
+    }
+
+    /**
+     * Avança para a posting seguinte.
+     */
+    void next() {
+        ++position;
+    }
+
+    /**
+     * Avança até o primeiro documento >= target. Retorna true se a lista contém target.
+     * Sem arquivo, a busca é galopante a partir da posição atual (os saltos
+     * costumam ser curtos); com ele, os blocos que terminam antes de target
+     * são pulados sem decodificar e só o bloco de destino é decodificado.
+     */
+    bool seek(uint32_t target) {
+        if (position >= count) {
+            return false;
+        }
+        if (mapped == nullptr) {
+            const PostingSpan& ids = list.docIds;
+            if (ids[position] < target) {
+                size_t low = position + 1;
+                size_t high = low;
+                for (size_t step = 1; high < count && ids[high] < target; step *= 2) {
+                    low = high + 1;
+                    high += step;
+                }
+                position = lower_bound(ids.begin() + low, ids.begin() + min(high, count), target) - ids.begin();
+            }
+            return position < count && ids[position] == target;
+        }
+
+        size_t b = position / PostingBlocks::SIZE;
+        if (summaries[b].lastDocId < target) {
+            while (b < summaries.size() && summaries[b].lastDocId < target) {
+                ++b;
+            }
+            if (b == summaries.size()) {
+                position = count;
+                return false;
+            }
+            position = b * PostingBlocks::SIZE;
+        }
+        load(b);
+        const PostingSpan& ids = list.docIds;
+        position = base + (lower_bound(ids.begin() + (position - base), ids.end(), target) - ids.begin());
+        return position - base < ids.size() && ids[position - base] == target;
+    }
+
+    /**
+     * Avança o bloco atual de blockOf até o primeiro bloco que termina em um
+     * documento >= target, só pelos resumos, e retorna o seu índice
+     * (blocks().size() se não houver). O bloco de blockOf é independente da
+     * posting atual; target só pode crescer entre as chamadas.
+     */
+    size_t blockOf(uint32_t target) {
+        while (shallow < summaries.size() && summaries[shallow].lastDocId < target) {
+            ++shallow;
+        }
+        return shallow;
+    }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef POSTINGSPAN_HPP
+#define POSTINGSPAN_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Visão não proprietária de uma lista de postings: IDs de documentos
+ * em ordem crescente, armazenados de forma contígua em outro lugar
+ * (na arena do índice congelado ou em um buffer do chamador).
+ */
+struct PostingSpan {
+    const uint32_t* first;
+    size_t count;
+
+    PostingSpan() : first(nullptr), count(0) {}
+    PostingSpan(const uint32_t* data, size_t size) : first(data), count(size) {}
+    PostingSpan(const vector<uint32_t>& ids) : first(ids.data()), count(ids.size()) {}
+
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return first + count; }
+    const uint32_t* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t operator[](size_t i) const { return first[i]; }
+};
+
+/**
+ * Lista de postings com as frequências de cada documento.
+ * frequencies tem o mesmo tamanho de docIds; fica vazia quando o índice
+ * não armazena frequências (arquivos antigos), caso em que vale 1 para todos.
+ */
+struct PostingList {
+    PostingSpan docIds;
+    PostingSpan frequencies;
+
+    /**
+     * Retorna a frequência da palavra no i-ésimo documento da lista.
+     */
+    uint32_t frequency(size_t i) const {
+        return frequencies.empty() ? 1 : frequencies[i];
+    }
+};
+
+/**
+ * Buffers do chamador usados quando a lista precisa ser decodificada
+ * (índice mapeado em memória). Devem sobreviver às visões retornadas.
+ */
+struct PostingScratch {
+    vector<uint32_t> docIds;
+    vector<uint32_t> frequencies;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef QUERYCACHE_HPP
+#define QUERYCACHE_HPP
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Contadores de um cache.
+ */
+struct CacheStatistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    // Memória estimada das entradas e o limite
+    size_t bytes = 0;
+    size_t budget = 0;
+};
+
+/**
+ * Cache LRU limitado por memória: cada entrada declara seu tamanho estimado
+ * e as menos usadas recentemente saem quando a soma passa do limite.
+ *
+ * Os valores são guardados como shared_ptr<const Value>, então uma consulta
+ * só segura o mutex para achar a entrada; a cópia do valor, se houver, fica
+ * fora da seção crítica e a entrada pode ser removida enquanto ainda está em uso.
+ */
+template <typename Value>
+class LruCache {
+private:
+    struct Entry {
+        string key;
+        shared_ptr<const Value> value;
+        size_t bytes;
+    };
+
+    // Entradas da mais recente para a menos recente
+    list<Entry> entries;
+    unordered_map<string, typename list<Entry>::iterator> positions;
+    size_t budget;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    mutable mutex cacheMutex;
+
+public:
+    // Custo fixo estimado de uma entrada (nó da lista, do mapa e shared_ptr)
+    static constexpr size_t ENTRY_OVERHEAD = 128;
+
+    explicit LruCache(size_t budgetBytes)
+        : budget(budgetBytes), bytes(0), hits(0), misses(0), evictions(0) {}
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    /**
+     * Retorna o valor da chave (e o marca como o mais recente), ou nullptr.
+     */
+    shared_ptr<const Value> find(const string& key) {
+        lock_guard<mutex> lock(cacheMutex);
+        auto it = positions.find(key);
+        if (it == positions.end()) {
+            ++misses;
+            return nullptr;
+        }
+        ++hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->value;
+    }
+
+    /**
+     * Guarda o valor com o tamanho estimado valueBytes, removendo as entradas
+     * menos recentes até caber no limite. Valores maiores que o limite
+     * inteiro não são guardados.
+     */
+    void insert(const string& key, shared_ptr<const Value> value, size_t valueBytes) {
+        size_t total = valueBytes + 2 * key.size() + ENTRY_OVERHEAD;
+        lock_guard<mutex> lock(cacheMutex);
+        if (total > budget) {
+            return;
+        }
+        auto it = positions.find(key);
+        if (it != positions.end()) {
+            // Outra thread calculou o mesmo valor primeiro
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        while (bytes + total > budget) {
+            bytes -= entries.back().bytes;
+            positions.erase(entries.back().key);
+            entries.pop_back();
+            ++evictions;
+        }
+        entries.push_front({key, move(value), total});
+        positions[key] = entries.begin();
+        bytes += total;
+    }
+
+    /**
+     * Remove todas as entradas (os contadores são mantidos).
+     */
+    void clear() {
+        lock_guard<mutex> lock(cacheMutex);
+        entries.clear();
+        positions.clear();
+        bytes = 0;
+    }
+
+    /**
+     * Retorna uma cópia dos contadores.
+     */
+    CacheStatistics statistics() const {
+        lock_guard<mutex> lock(cacheMutex);
+        CacheStatistics result;
+        result.hits = hits;
+        result.misses = misses;
+        result.evictions = evictions;
+        result.entries = entries.size();
+        result.bytes = bytes;
+        result.budget = budget;
+        return result;
+    }
+};
+
+/**
+ * Cache de consultas usado pelo QueryProcessor, com dois níveis:
+ * - resultados finais das buscas por palavras sem ranqueamento (nomes dos
+ *   arquivos de querySingle e queryMultiple), pela chave do conjunto de
+ *   palavras normalizadas, sem stop words, ordenado e sem repetições; as
+ *   buscas ranqueadas, booleanas e por frases não passam pelo cache;
+ * - interseções de pares de palavras, reaproveitadas por consultas de três
+ *   ou mais palavras que começam pelo mesmo par.
+ * Três quartos do limite de memória ficam com os resultados e o restante
+ * com os pares. Pode ser usado por várias threads ao mesmo tempo.
+ *
+ * O cache não percebe mudanças no índice: quem troca ou atualiza o índice
+ * chama invalidate().
+ */
+class QueryCache {
+public:
+    // Resultado de uma busca sem ranqueamento: nomes dos arquivos
+    using FileList = vector<string>;
+
+private:
+    LruCache<FileList> results;
+    LruCache<vector<uint32_t>> pairs;
+
+public:
+    explicit QueryCache(size_t budgetBytes)
+        : results(budgetBytes - budgetBytes / 4), pairs(budgetBytes / 4) {}
+
+    /**
+     * Monta a chave de um conjunto de palavras: ordenadas, sem repetições e
+     * separadas por '\0'. prefix distingue os índices que dividem o cache
+     * (ex.: os shards).
+     */
+    static string key(vector<string> words, const string& prefix = "") {
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+        string result = prefix;
+        for (const string& word : words) {
+            result += '\0';
+            result += word;
+        }
+        return result;
+    }
+
+    /**
+     * Busca o resultado final de uma consulta.
+     */
+    shared_ptr<const FileList> findResult(const string& key) {
+        return results.find(key);
+    }
+
+    /**
+     * Guarda o resultado final de uma consulta.
+     */
+    void storeResult(const string& key, FileList files) {
+        size_t valueBytes = files.capacity() * sizeof(string);
+        for (const string& file : files) {
+            valueBytes += file.capacity();
+        }
+        results.insert(key, make_shared<const FileList>(move(files)), valueBytes);
+    }
+
+    /**
+     * Busca a interseção de um par de palavras (em qualquer ordem). scope
+     * distingue índices que dividem o cache (ex.: os shards).
+     */
+    shared_ptr<const vector<uint32_t>> findPair(const string& first, const string& second,
+                                                const string& scope = "") {
+        return pairs.find(key({first, second}, scope));
+    }
+
+    /**
+     * Guarda a interseção de um par de palavras e retorna o valor guardado.
+     */
+    shared_ptr<const vector<uint32_t>> storePair(const string& first, const string& second,
+                                                 vector<uint32_t> docIds, const string& scope = "") {
+        size_t valueBytes = docIds.capacity() * sizeof(uint32_t);
+        auto value = make_shared<const vector<uint32_t>>(move(docIds));
+        pairs.insert(key({first, second}, scope), value, valueBytes);
+        return value;
+    }
+
+    /**
+     * Descarta todas as entradas; deve ser chamado quando o índice muda.
+     */
+    void invalidate() {
+        results.clear();
+        pairs.clear();
+    }
+
+    CacheStatistics resultStatistics() const {
+        return results.statistics();
+    }
+
+    CacheStatistics pairStatistics() const {
+        return pairs.statistics();
+    }
+};
+
+#endif
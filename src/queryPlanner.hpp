@@ -0,0 +1,454 @@
+#ifndef QUERYPLANNER_HPP
+#define QUERYPLANNER_HPP
+
+#include "index.hpp"
+#include "booleanQuery.hpp"
+#include "queryProcessor.hpp"
+#include "intersection.hpp"
+#include "postingBitmap.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <ostream>
+
+using namespace std;
+
+/**
+ * Plano de execução de uma consulta booleana: a árvore da consulta com os
+ * operandos já reordenados, a estimativa de documentos de cada nó e, depois
+ * da execução, a quantidade obtida.
+ */
+struct QueryPlan {
+    QueryNode::Type type;
+    // Texto do operando (folhas)
+    string text;
+    // Palavra normalizada (TERM e FUZZY) ou padrão (PATTERN)
+    string word;
+    // Palavras da frase (PHRASE)
+    Phrase phrase;
+    // Palavras do padrão (PATTERN) ou a até distance edições da palavra (FUZZY)
+    vector<string> expansions;
+    uint32_t distance = 0;
+    vector<QueryPlan> children;
+    // Estimativa de documentos, a partir do tamanho das listas no dicionário
+    size_t estimate = 0;
+    // NOT aplicado como diferença sobre o resultado parcial de um AND
+    bool difference = false;
+    // Preenchidos na execução (nós pulados ficam com evaluated = false)
+    bool evaluated = false;
+    size_t actual = 0;
+};
+
+/**
+ * Planejador e executor de consultas booleanas.
+ *
+ * O plano estima o tamanho de cada operando pela frequência das palavras no
+ * dicionário (sem decodificar listas) e reordena os operandos:
+ * - AND: os operandos positivos são avaliados do menor para o maior, cada um
+ *   intersectado com o resultado parcial; os NOT viram diferenças sobre esse
+ *   resultado, e não complementos sobre todos os documentos;
+ * - OR, padrões com curingas e palavras da busca aproximada: as listas são
+ *   unidas de uma vez (PostingIntersector::uniteAll);
+ * - NOT isolado (sem operando positivo ao lado) é o único caso que usa o
+ *   conjunto de todos os documentos.
+ * A execução para assim que um resultado parcial de AND fica vazio, e um OR
+ * para quando já cobre todos os documentos. As palavras densas cuja lista o
+ * índice guarda também em PostingBitmap são combinadas nesse formato.
+ */
+class QueryPlanner {
+private:
+    // Índice consultado
+    const Index& index;
+    // Consultas de frases
+    const QueryProcessor& queryProcessor;
+    // Quantidade de documentos do índice (limite das estimativas)
+    size_t documentCount;
+
+public:
+    QueryPlanner(const Index& idx, const QueryProcessor& processor)
+        : index(idx), queryProcessor(processor), documentCount(idx.getDocumentCount()) {}
+
+    /**
+     * Monta o plano de uma consulta cujas folhas já estão normalizadas.
+     */
+    QueryPlan plan(const QueryNode& query) const {
+        QueryPlan node;
+        node.type = query.type;
+        node.text = query.text;
+        node.word = query.word;
+        node.phrase = query.phrase;
+        node.expansions = query.expansions;
+        node.distance = query.distance;
+
+        switch (query.type) {
+            case QueryNode::TERM:
+                node.estimate = index.getDocumentFrequency(query.word);
+                break;
+            case QueryNode::PHRASE:
+                node.estimate = documentCount;
+                for (const PhraseTerm& term : query.phrase) {
+                    node.estimate = min(node.estimate, index.getDocumentFrequency(term.word));
+                }
+                break;
+            case QueryNode::PATTERN:
+            case QueryNode::FUZZY:
+                for (const string& word : query.expansions) {
+                    node.estimate = min(documentCount, node.estimate + index.getDocumentFrequency(word));
+                }
+                break;
+            case QueryNode::NOT:
+                node.children.push_back(plan(query.children[0]));
+                node.estimate = documentCount - min(documentCount, node.children[0].estimate);
+                break;
+            case QueryNode::AND:
+                planAnd(query, node);
+                break;
+            case QueryNode::OR:
+                planOr(query, node);
+                break;
+        }
+        return node;
+    }
+
+    /**
+     * Executa o plano e retorna os IDs dos documentos (ordenados).
+     * Registra em cada nó avaliado a quantidade de documentos obtida.
+     */
+    vector<uint32_t> execute(QueryPlan& node) const {
+        vector<uint32_t> result;
+        switch (node.type) {
+            case QueryNode::TERM: {
+                vector<uint32_t> scratch;
+                PostingSpan postings = index.getPostings(node.word, scratch);
+                result.assign(postings.begin(), postings.end());
+                break;
+            }
+            case QueryNode::PHRASE:
+                result = queryProcessor.phraseDocuments(node.phrase);
+                break;
+            case QueryNode::PATTERN:
+            case QueryNode::FUZZY:
+                result = executePattern(node);
+                break;
+            case QueryNode::NOT:
+                result = allDocuments();
+                subtract(result, node.children[0]);
+                break;
+            case QueryNode::AND:
+                result = executeAnd(node);
+                break;
+            case QueryNode::OR:
+                result = executeOr(node);
+                break;
+        }
+        node.evaluated = true;
+        node.actual = result.size();
+        return result;
+    }
+
+    /**
+     * Escreve o plano, um nó por linha, com a estimativa e o obtido.
+     */
+    static void explain(const QueryPlan& node, ostream& out, size_t depth = 1) {
+        out << string(depth * 2, ' ') << describe(node) << "  [estimados " << node.estimate << ", ";
+        if (node.evaluated) {
+            out << (node.difference ? "restaram " : "obtidos ") << node.actual << "]\n";
+        } else {
+            out << "não avaliado]\n";
+        }
+        for (const QueryPlan& child : node.children) {
+            explain(child, out, depth + 1);
+        }
+    }
+
+private:
+    /**
+     * AND: achata os AND aninhados e ordena os operandos positivos pela
+     * estimativa, seguidos dos NOT (também pela estimativa do operando negado).
+     */
+    void planAnd(const QueryNode& query, QueryPlan& node) const {
+        vector<QueryPlan> positives;
+        vector<QueryPlan> negatives;
+        for (const QueryNode& child : query.children) {
+            QueryPlan planned = plan(child);
+            vector<QueryPlan> parts;
+            if (planned.type == QueryNode::AND) {
+                parts = move(planned.children);
+            } else {
+                parts.push_back(move(planned));
+            }
+            for (QueryPlan& part : parts) {
+                (part.type == QueryNode::NOT ? negatives : positives).push_back(move(part));
+            }
+        }
+
+        auto byEstimate = [](const QueryPlan& a, const QueryPlan& b) { return a.estimate < b.estimate; };
+        stable_sort(positives.begin(), positives.end(), byEstimate);
+        stable_sort(negatives.begin(), negatives.end(), [](const QueryPlan& a, const QueryPlan& b) {
+            return a.children[0].estimate < b.children[0].estimate;
+        });
+
+        if (!positives.empty()) {
+            node.estimate = positives[0].estimate;
+            for (QueryPlan& negative : negatives) {
+                negative.difference = true;
+            }
+        } else {
+            // Só há NOT: o primeiro é o complemento e os demais, diferenças sobre ele
+            node.estimate = negatives[0].estimate;
+            for (size_t i = 1; i < negatives.size(); ++i) {
+                negatives[i].difference = true;
+                node.estimate = min(node.estimate, negatives[i].estimate);
+            }
+        }
+        node.children = move(positives);
+        for (QueryPlan& negative : negatives) {
+            node.children.push_back(move(negative));
+        }
+    }
+
+    /**
+     * OR: achata os OR aninhados e ordena os operandos pela estimativa.
+     */
+    void planOr(const QueryNode& query, QueryPlan& node) const {
+        for (const QueryNode& child : query.children) {
+            QueryPlan planned = plan(child);
+            if (planned.type == QueryNode::OR) {
+                for (QueryPlan& part : planned.children) {
+                    node.children.push_back(move(part));
+                }
+            } else {
+                node.children.push_back(move(planned));
+            }
+        }
+        stable_sort(node.children.begin(), node.children.end(), [](const QueryPlan& a, const QueryPlan& b) {
+            return a.estimate < b.estimate;
+        });
+        node.estimate = 0;
+        for (const QueryPlan& child : node.children) {
+            node.estimate = min(documentCount, node.estimate + child.estimate);
+        }
+    }
+
+    /**
+     * Avalia um AND na ordem do plano, parando no primeiro resultado vazio.
+     * Palavras são intersectadas (ou subtraídas) direto da lista do índice.
+     * Enquanto os operandos são palavras densas com a lista em PostingBitmap,
+     * o resultado parcial também fica em bitmap e as operações são as dos
+     * contêineres; um operando em bitmap sobre um resultado parcial em lista
+     * filtra a lista.
+     */
+    vector<uint32_t> executeAnd(QueryPlan& node) const {
+        PostingBitmap bitmap;
+        bool inBitmap = termBitmap(node.children[0], bitmap);
+        vector<uint32_t> current = inBitmap ? vector<uint32_t>() : execute(node.children[0]);
+        vector<uint32_t> scratch;
+        vector<uint32_t> output;
+        for (size_t i = 1; i < node.children.size() && !(inBitmap ? bitmap.empty() : current.empty()); ++i) {
+            QueryPlan& child = node.children[i];
+            QueryPlan& operand = child.difference ? child.children[0] : child;
+            PostingBitmap other;
+            if (inBitmap && termBitmap(operand, other)) {
+                bitmap = child.difference ? PostingBitmap::difference(bitmap, other)
+                                          : PostingBitmap::intersect(bitmap, other);
+            } else if (child.difference) {
+                if (inBitmap) {
+                    current = bitmap.toVector();
+                    inBitmap = false;
+                }
+                subtract(current, operand);
+            } else if (!inBitmap && termBitmap(child, other)) {
+                output.resize(current.size());
+                output.resize(other.filter(PostingSpan(current), output.data(), true));
+                current.swap(output);
+            } else {
+                vector<uint32_t> evaluated;
+                PostingSpan list = postingsOf(child, scratch, evaluated);
+                if (inBitmap) {
+                    output.resize(list.size());
+                    output.resize(bitmap.filter(list, output.data(), true));
+                    inBitmap = false;
+                } else {
+                    output.resize(min(current.size(), list.size()));
+                    output.resize(PostingIntersector::intersect(PostingSpan(current), list, output.data()));
+                }
+                current.swap(output);
+            }
+            if (child.difference) {
+                child.evaluated = true;
+                child.actual = inBitmap ? bitmap.cardinality() : current.size();
+            }
+        }
+        return inBitmap ? bitmap.toVector() : current;
+    }
+
+    /**
+     * Avalia um OR: avalia os operandos do menor para o maior e une todos de
+     * uma vez (PostingIntersector::uniteAll). As palavras densas com a lista em
+     * PostingBitmap são unidas antes, entre bitmaps. Se um operando já tem
+     * todos os documentos, os demais nem são avaliados.
+     */
+    vector<uint32_t> executeOr(QueryPlan& node) const {
+        vector<vector<uint32_t>> results;
+        PostingBitmap dense;
+        for (QueryPlan& child : node.children) {
+            PostingBitmap bitmap;
+            if (termBitmap(child, bitmap)) {
+                if (documentCount > 0 && bitmap.cardinality() >= documentCount) {
+                    return bitmap.toVector();
+                }
+                dense = PostingBitmap::unite(dense, bitmap);
+                continue;
+            }
+            results.push_back(execute(child));
+            if (documentCount > 0 && results.back().size() >= documentCount) {
+                return move(results.back());
+            }
+        }
+        if (!dense.empty()) {
+            results.push_back(dense.toVector());
+        }
+        return unite(vector<PostingSpan>(results.begin(), results.end()));
+    }
+
+    /**
+     * Avalia um padrão (ou uma palavra aproximada): une as listas de todas as
+     * palavras da expansão, com as palavras densas unidas antes em bitmap.
+     */
+    vector<uint32_t> executePattern(const QueryPlan& node) const {
+        vector<vector<uint32_t>> scratch(node.expansions.size() + 1);
+        vector<PostingSpan> lists;
+        lists.reserve(scratch.size());
+        PostingBitmap dense;
+        for (size_t i = 0; i < node.expansions.size(); ++i) {
+            PostingBitmap bitmap;
+            if (index.getPostingBitmap(node.expansions[i], bitmap)) {
+                dense = PostingBitmap::unite(dense, bitmap);
+            } else {
+                lists.push_back(index.getPostings(node.expansions[i], scratch[i]));
+            }
+        }
+        if (!dense.empty()) {
+            scratch.back() = dense.toVector();
+            lists.push_back(PostingSpan(scratch.back()));
+        }
+        return unite(lists);
+    }
+
+    /**
+     * União das listas, com os buffers do intersector da thread.
+     */
+    static vector<uint32_t> unite(const vector<PostingSpan>& lists) {
+        static thread_local PostingIntersector intersector;
+        PostingSpan merged = intersector.uniteAll(lists);
+        return vector<uint32_t>(merged.begin(), merged.end());
+    }
+
+    /**
+     * Remove de current os documentos do operando (diferença).
+     */
+    void subtract(vector<uint32_t>& current, QueryPlan& operand) const {
+        if (current.empty()) {
+            return;
+        }
+        vector<uint32_t> output(current.size());
+        PostingBitmap bitmap;
+        if (termBitmap(operand, bitmap)) {
+            output.resize(bitmap.filter(PostingSpan(current), output.data(), false));
+        } else {
+            vector<uint32_t> scratch;
+            vector<uint32_t> evaluated;
+            PostingSpan other = postingsOf(operand, scratch, evaluated);
+            output.resize(PostingIntersector::difference(PostingSpan(current), other, output.data()));
+        }
+        current.swap(output);
+    }
+
+    /**
+     * Lista de documentos de um operando: a do índice, sem cópia, para uma
+     * palavra (decodificada em scratch, se preciso); para os demais, o
+     * resultado da avaliação, guardado em evaluated.
+     */
+    PostingSpan postingsOf(QueryPlan& operand, vector<uint32_t>& scratch, vector<uint32_t>& evaluated) const {
+        if (operand.type != QueryNode::TERM) {
+            evaluated = execute(operand);
+            return PostingSpan(evaluated);
+        }
+        PostingSpan list = index.getPostings(operand.word, scratch);
+        operand.evaluated = true;
+        operand.actual = list.size();
+        return list;
+    }
+
+    /**
+     * Lê em bitmap a lista de um operando que é uma palavra densa, quando o
+     * índice a guarda nesse formato (ver Index::getPostingBitmap), e marca o
+     * operando como avaliado. Retorna false para os demais operandos.
+     */
+    bool termBitmap(QueryPlan& operand, PostingBitmap& bitmap) const {
+        if (operand.type != QueryNode::TERM || operand.estimate < PostingBitmap::MIN_DOCUMENTS ||
+            !index.getPostingBitmap(operand.word, bitmap)) {
+            return false;
+        }
+        operand.evaluated = true;
+        operand.actual = bitmap.cardinality();
+        return true;
+    }
+
+    /**
+     * Retorna os IDs de todos os documentos (só para NOT sem operando positivo).
+     */
+    vector<uint32_t> allDocuments() const {
+        vector<uint32_t> result;
+        for (int docId : index.getAllDocumentIds()) {
+            result.push_back(static_cast<uint32_t>(docId));
+        }
+        return result;
+    }
+
+    /**
+     * Descrição de um nó no plano.
+     */
+    static string describe(const QueryPlan& node) {
+        switch (node.type) {
+            case QueryNode::TERM:
+                return "TERMO " + node.word;
+            case QueryNode::PHRASE: {
+                string words;
+                for (const PhraseTerm& term : node.phrase) {
+                    words += (words.empty() ? "" : " ") + term.word;
+                }
+                return "FRASE \"" + words + "\"";
+            }
+            case QueryNode::PATTERN:
+                return "PADRÃO " + node.word + " (" + describeExpansions(node) + ")";
+            case QueryNode::FUZZY:
+                return "APROXIMADO " + node.word + " (até " + to_string(node.distance) +
+                       (node.distance == 1 ? " edição; " : " edições; ") + describeExpansions(node) + ")";
+            case QueryNode::NOT:
+                return node.difference ? "NÃO (diferença com o resultado parcial)"
+                                       : "NÃO (complemento sobre todos os documentos)";
+            case QueryNode::AND:
+                return "E";
+            case QueryNode::OR:
+                return "OU";
+        }
+        return "";
+    }
+
+    /**
+     * Quantidade de palavras da expansão, seguida só das primeiras delas.
+     */
+    static string describeExpansions(const QueryPlan& node) {
+        string words = to_string(node.expansions.size()) + " palavras";
+        for (size_t i = 0; i < node.expansions.size() && i < 5; ++i) {
+            words += (i == 0 ? ": " : ", ") + node.expansions[i];
+        }
+        if (node.expansions.size() > 5) {
+            words += ", ...";
+        }
+        return words;
+    }
+};
+
+#endif
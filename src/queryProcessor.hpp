@@ -2,70 +2,857 @@
 #define QUERYPROCESSOR_HPP
 
 #include "index.hpp"
+#include "bm25.hpp"
+#include "postingBlocks.hpp"
+#include "intersection.hpp"
+#include "queryCache.hpp"
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <queue>
+#include <numeric>
 
 using namespace std;
 
+/**
+ * Documento retornado por uma consulta ranqueada.
+ */
+struct RankedDocument {
+    string filename;
+    double score;
+    uint32_t docId;
+};
+
+/**
+ * Resultado de uma consulta ranqueada: os K melhores documentos, do mais
+ * relevante para o menos relevante, e o total de documentos que casaram.
+ */
+struct RankedResults {
+    vector<RankedDocument> documents;
+    size_t totalMatches;
+    // O total é um limite inferior (a poda pulou documentos sem contá-los)
+    bool totalIsLowerBound = false;
+};
+
+/**
+ * Palavra de uma frase exata e sua distância, em palavras, até o início da frase
+ * (stop words da frase não são buscadas, mas contam na distância).
+ */
+struct PhraseTerm {
+    string word;
+    uint32_t offset;
+};
+
+// Frase exata de uma consulta
+using Phrase = vector<PhraseTerm>;
+
 /**
  * Classe responsável por processar consultas no índice invertido.
- * Suporta consultas com uma única palavra ou múltiplas palavras (operação AND).
+ * Suporta consultas com uma única palavra ou múltiplas palavras (operação AND),
+ * frases exatas (índice posicional), com resultados em ordem de ID ou
+ * ranqueados por BM25.
+ *
+ * Com um QueryCache, as consultas por palavras (querySingle e queryMultiple)
+ * consultam primeiro o cache de resultados e reaproveitam as interseções de
+ * pares de palavras já calculadas.
  */
 class QueryProcessor {
 private:
     // Referência para o índice invertido (const, pois não modifica)
     const Index& index;
+    // Cache de resultados e de pares (opcional, compartilhado entre threads)
+    QueryCache* cache;
+    // Prefixo das chaves do cache, que distingue os shards que dividem um cache
+    string cacheScope;
+    // Estatísticas da coleção inteira para o BM25 (nullptr: as do próprio índice)
+    const CollectionStatistics* collection;
+    // Pula, nas buscas ranqueadas, os blocos que não podem entrar nos K melhores
+    bool pruning;
 
 public:
-    QueryProcessor(const Index& idx) : index(idx) {}
+    QueryProcessor(const Index& idx, QueryCache* queryCache = nullptr, string scope = "",
+                   const CollectionStatistics* collectionStatistics = nullptr)
+        : index(idx), cache(queryCache), cacheScope(move(scope)), collection(collectionStatistics), pruning(true) {}
+
+    /**
+     * Liga ou desliga a poda por blocos de queryRanked e rankDocuments (ligada
+     * por padrão). Os resultados são os mesmos; desligada, todos os documentos
+     * que casam são pontuados.
+     */
+    void setPruning(bool enabled) {
+        pruning = enabled;
+    }
     
     /**
      * Processa uma consulta com uma única palavra.
      * Retorna os nomes dos arquivos que contêm a palavra.
      */
     vector<string> querySingle(const string& word) const {
-        vector<string> result;
-        set<int> docIds = index.getDocumentsForWord(word);
-        
-        for (int docId : docIds) {
-            result.push_back(index.getFileName(docId));
+        string key;
+        if (cache) {
+            key = QueryCache::key({word}, cacheScope);
+            if (auto cached = cache->findResult(key)) {
+                return *cached;
+            }
         }
-        
-        return result;
+        vector<uint32_t> scratch;
+        vector<string> results = fileNames(index.getPostings(word, scratch));
+        if (cache) {
+            cache->storeResult(key, results);
+        }
+        return results;
     }
     
     /**
      * Processa uma consulta com múltiplas palavras (operação AND).
      * Retorna os nomes dos arquivos que contêm todas as palavras.
+     * As listas de postings são lidas sem cópia e intersectadas da menor para
+     * a maior (ver PostingIntersector); os buffers usados ficam em um
+     * intersector por thread e são reaproveitados entre as consultas.
+     * Com cache, a interseção das duas listas menores de uma consulta com três
+     * ou mais palavras também é guardada, como par.
+     * As palavras densas cuja lista o índice guarda em PostingBitmap são
+     * intersectadas entre si nesse formato e filtram o resultado das demais.
      */
     vector<string> queryMultiple(const vector<string>& words) const {
         if (words.empty()) {
             return {};
         }
-        
-        set<int> result = index.getDocumentsForWord(words[0]);
-        
-        for (size_t i = 1; i < words.size() && !result.empty(); ++i) {
-            set<int> current = index.getDocumentsForWord(words[i]);
-            set<int> intersection;
-            
-            set_intersection(
-                result.begin(), result.end(),
-                current.begin(), current.end(),
-                inserter(intersection, intersection.begin())
-            );
-            
-            result = intersection;
+        string key;
+        if (cache) {
+            key = QueryCache::key(words, cacheScope);
+            if (auto cached = cache->findResult(key)) {
+                return *cached;
+            }
         }
         
+        static thread_local PostingIntersector intersector;
+        vector<PostingSpan> lists;
+        vector<string> listWords;
+        vector<size_t> order;
+        // Palavras densas lidas em PostingBitmap, já intersectadas entre si
+        PostingBitmap dense;
+        bool hasDense = false;
+        lists.reserve(words.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            PostingBitmap bitmap;
+            bool empty;
+            if (index.getPostingBitmap(words[i], bitmap)) {
+                dense = hasDense ? PostingBitmap::intersect(dense, bitmap) : move(bitmap);
+                hasDense = true;
+                empty = dense.empty();
+            } else {
+                lists.push_back(index.getPostings(words[i], intersector.termBuffer(i)));
+                listWords.push_back(words[i]);
+                order.push_back(order.size());
+                empty = lists.back().empty();
+            }
+            if (empty) {
+                if (cache) {
+                    cache->storeResult(key, {});
+                }
+                return {};
+            }
+        }
+        if (lists.empty()) {
+            vector<string> results = fileNames(dense.toVector());
+            if (cache) {
+                cache->storeResult(key, results);
+            }
+            return results;
+        }
+
+        shared_ptr<const vector<uint32_t>> pair;
+        if (cache && lists.size() >= 3) {
+            // Troca as duas listas menores pela interseção delas (do cache ou calculada)
+            sort(order.begin(), order.end(), [&](size_t a, size_t b) { return lists[a].size() < lists[b].size(); });
+            const string& first = listWords[order[0]];
+            const string& second = listWords[order[1]];
+            if (first != second) {
+                pair = cache->findPair(first, second, cacheScope);
+                if (!pair) {
+                    vector<uint32_t> both(min(lists[order[0]].size(), lists[order[1]].size()));
+                    both.resize(PostingIntersector::intersect(lists[order[0]], lists[order[1]], both.data()));
+                    pair = cache->storePair(first, second, move(both), cacheScope);
+                }
+                lists[order[0]] = PostingSpan(*pair);
+                lists.erase(lists.begin() + order[1]);
+            }
+        }
+
+        PostingSpan intersection = intersector.intersectAll(move(lists));
+        vector<uint32_t> filtered;
+        if (hasDense) {
+            filtered.resize(intersection.size());
+            filtered.resize(dense.filter(intersection, filtered.data(), true));
+            intersection = PostingSpan(filtered);
+        }
+        vector<string> results = fileNames(intersection);
+        if (cache) {
+            cache->storeResult(key, results);
+        }
+        return results;
+    }
+
+    /**
+     * Processa uma consulta com frases exatas e, opcionalmente, palavras avulsas
+     * (operação AND). Retorna os nomes dos arquivos que contêm todas as palavras
+     * e todas as frases.
+     * Lança uma exceção se o índice não guarda posições.
+     */
+    vector<string> queryPhrases(const vector<string>& words, const vector<Phrase>& phrases) const {
+        vector<uint32_t> docIds = matchPhrases(words, phrases);
+        return fileNames(PostingSpan(docIds));
+    }
+    
+    /**
+     * Processa uma consulta ranqueada (operação AND, pontuação BM25).
+     * Retorna apenas os topK documentos de maior pontuação.
+     *
+     * Os documentos candidatos vêm da lista mais curta; nas demais listas o
+     * cursor (PostingCursor) avança até o candidato pulando, pelo último
+     * documento de cada bloco, os blocos que não podem contê-lo, que nem são
+     * decodificados. As pontuações entram em um heap limitado a topK
+     * elementos, então só os K melhores são ordenados e têm o nome do arquivo
+     * resolvido. Com a poda ligada e o heap cheio, um documento que casa só é
+     * pontuado se a soma dos limites dos seus blocos (block-max, ver
+     * PostingBlock) passa do pior documento do heap; ele ainda conta no total,
+     * por isso os blocos com candidatos continuam sendo decodificados.
+     */
+    RankedResults queryRanked(const vector<string>& words, size_t topK, const vector<Phrase>& phrases = {}) const {
+        RankedResults results = {{}, 0};
+        vector<string> terms(words);
+        sort(terms.begin(), terms.end());
+        terms.erase(unique(terms.begin(), terms.end()), terms.end());
+        if (terms.empty() || topK == 0) {
+            return results;
+        }
+
+        // Com frases, só os documentos que contêm todas elas são pontuados
+        vector<uint32_t> allowed;
+        size_t allowedCursor = 0;
+        if (!phrases.empty()) {
+            allowed = matchPhrases({}, phrases);
+            if (allowed.empty()) {
+                return results;
+            }
+        }
+
+        vector<PostingCursor> opened;
+        opened.reserve(terms.size());
+        for (const string& term : terms) {
+            opened.push_back(index.getPostingCursor(term, pruning));
+            if (opened.back().size() == 0) {
+                return results;
+            }
+        }
+        // Da lista mais curta para a mais longa
+        vector<size_t> order(opened.size());
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return opened[a].size() < opened[b].size(); });
+        vector<PostingCursor> sorted;
+        vector<string> sortedTerms;
+        for (size_t i : order) {
+            sorted.push_back(move(opened[i]));
+            sortedTerms.push_back(terms[i]);
+        }
+        RankingCursors cursors(move(sorted));
+
+        BM25Scorer scorer = makeScorer();
+        vector<double> idf = idfOf(scorer, sortedTerms, cursors);
+
+        ScopedTimer timer(Statistics::SCORING);
+        if (pruning) {
+            cursors.prepareBounds(scorer, idf);
+        }
+        size_t scored = 0;
+        TopHeap heap;
+        PostingCursor& shortest = cursors[0];
+        uint32_t docId = 0;
+        while (true) {
+            shortest.seek(docId);
+            if (shortest.atEnd()) {
+                break;
+            }
+            docId = shortest.docId();
+            // Cada lista que não contém o candidato indica o próximo
+            size_t t = 1;
+            while (t < cursors.size() && cursors[t].seek(docId)) {
+                ++t;
+            }
+            if (t < cursors.size()) {
+                if (cursors[t].atEnd()) {
+                    break;
+                }
+                docId = cursors[t].docId();
+                continue;
+            }
+            if (!phrases.empty()) {
+                allowedCursor = lower_bound(allowed.begin() + allowedCursor, allowed.end(), docId) - allowed.begin();
+                if (allowedCursor == allowed.size()) {
+                    break;
+                }
+                if (allowed[allowedCursor] != docId) {
+                    docId = allowed[allowedCursor];
+                    continue;
+                }
+            }
+
+            ++results.totalMatches;
+            if (!cursors.pruning() || heap.size() < topK || cursors.blockBound(docId) > heap.top().first) {
+                uint32_t length = index.getDocumentLength(static_cast<int>(docId));
+                double score = 0.0;
+                for (size_t k = 0; k < cursors.size(); ++k) {
+                    score += scorer.score(idf[k], cursors[k].frequency(), length);
+                }
+                scored += cursors.size();
+                offer(heap, topK, score, docId);
+            }
+            ++docId;
+        }
+        Statistics::add(Statistics::POSTINGS_SCORED, scored);
+        Statistics::add(Statistics::POSTINGS_SKIPPED, cursors.postingCount() - cursors.decodedCount());
+
+        drain(heap, results);
+        return results;
+    }
+
+    /**
+     * Ordena por relevância (BM25) um conjunto de documentos já calculado, como
+     * o resultado de uma consulta booleana. Cada documento soma a pontuação das
+     * palavras que contém. Retorna apenas os topK documentos de maior pontuação.
+     *
+     * Com a poda ligada, depois que o heap tem topK documentos, as palavras
+     * passam a ser avaliadas como no MaxScore: as de menor limite de pontuação
+     * cuja soma dos limites não passa do pior documento do heap não bastam para
+     * um documento entrar nele, então só os documentos das demais palavras
+     * (as essenciais) são candidatos, e os cursores dessas palavras é que
+     * escolhem o próximo documento. Os limites dos blocos (block-max, ver
+     * PostingBlock) em que o próximo documento pode estar valem até o fim do
+     * primeiro deles; se a soma não basta, os cursores pulam esse trecho sem
+     * decodificá-lo. Um candidato ainda passa pela soma dos limites dos seus
+     * blocos antes de ser pontuado, e só então os blocos das palavras não
+     * essenciais são decodificados. Como os documentos chegam em ordem de ID e
+     * os empates favorecem o menor ID, o resultado é o mesmo de pontuar todos.
+     * docIds continua definindo quais documentos casam e o total informado.
+     */
+    RankedResults rankDocuments(const vector<uint32_t>& docIds, const vector<string>& words, size_t topK) const {
+        RankedResults results = {{}, docIds.size()};
+        vector<string> terms(words);
+        sort(terms.begin(), terms.end());
+        terms.erase(unique(terms.begin(), terms.end()), terms.end());
+        if (docIds.empty() || topK == 0) {
+            return results;
+        }
+
+        bool bounded = pruning && docIds.size() > topK;
+        vector<PostingCursor> opened;
+        opened.reserve(terms.size());
+        for (const string& term : terms) {
+            opened.push_back(index.getPostingCursor(term, bounded));
+        }
+        RankingCursors cursors(move(opened));
+        BM25Scorer scorer = makeScorer();
+        vector<double> idf = idfOf(scorer, terms, cursors);
+
+        ScopedTimer timer(Statistics::SCORING);
+        if (bounded) {
+            cursors.prepareBounds(scorer, idf);
+        }
+
+        TopHeap heap;
+        size_t scored = 0;
+        for (size_t i = 0; i < docIds.size();) {
+            uint32_t docId = docIds[i];
+            if (cursors.pruning() && heap.size() == topK) {
+                uint32_t next = cursors.nextCandidate(docId, heap.top().first);
+                if (next == UINT32_MAX) {
+                    break;
+                }
+                if (next != docId) {
+                    // Os documentos antes de next não podem entrar no heap
+                    i = lower_bound(docIds.begin() + i, docIds.end(), next) - docIds.begin();
+                    continue;
+                }
+                if (cursors.upperBound(docId) <= heap.top().first) {
+                    ++i;
+                    continue;
+                }
+            }
+
+            uint32_t length = index.getDocumentLength(static_cast<int>(docId));
+            double score = 0.0;
+            for (size_t t = 0; t < cursors.size(); ++t) {
+                if (cursors[t].seek(docId)) {
+                    score += scorer.score(idf[t], cursors[t].frequency(), length);
+                    ++scored;
+                }
+            }
+            offer(heap, topK, score, docId);
+            ++i;
+        }
+        Statistics::add(Statistics::POSTINGS_SCORED, scored);
+        Statistics::add(Statistics::POSTINGS_SKIPPED, cursors.postingCount() - cursors.decodedCount());
+
+        drain(heap, results);
+        return results;
+    }
+
+    /**
+     * Ordena por relevância (BM25) os documentos que contêm ao menos uma das
+     * palavras (uma consulta só com OR), direto dos cursores das listas, sem
+     * montar a união. Enquanto o heap não tem topK documentos (ou sem a poda),
+     * o próximo documento é o menor entre os cursores; depois, os candidatos
+     * vêm das palavras essenciais, como em rankDocuments (MaxScore com os
+     * limites dos blocos), e os documentos que só aparecem nas demais palavras
+     * ou nos trechos pulados nem são vistos. O resultado é o mesmo de
+     * rankDocuments sobre a união, mas, a partir do momento em que a poda
+     * começa, o total é só um limite inferior: os documentos vistos, ou a
+     * maior lista, se for maior (totalIsLowerBound), a não ser que só uma
+     * palavra esteja no índice.
+     */
+    RankedResults rankDisjunction(const vector<string>& words, size_t topK) const {
+        RankedResults results = {{}, 0};
+        vector<string> terms(words);
+        sort(terms.begin(), terms.end());
+        terms.erase(unique(terms.begin(), terms.end()), terms.end());
+        if (terms.empty() || topK == 0) {
+            return results;
+        }
+
+        vector<PostingCursor> opened;
+        opened.reserve(terms.size());
+        size_t longest = 0;
+        size_t nonEmpty = 0;
+        for (const string& term : terms) {
+            opened.push_back(index.getPostingCursor(term, pruning));
+            longest = max(longest, opened.back().size());
+            nonEmpty += opened.back().size() > 0 ? 1 : 0;
+        }
+        RankingCursors cursors(move(opened));
+        BM25Scorer scorer = makeScorer();
+        vector<double> idf = idfOf(scorer, terms, cursors);
+
+        ScopedTimer timer(Statistics::SCORING);
+        if (pruning && cursors.postingCount() > topK) {
+            cursors.prepareBounds(scorer, idf);
+        }
+
+        TopHeap heap;
+        size_t scored = 0;
+        uint32_t docId = 0;
+        while (true) {
+            bool pruned = cursors.pruning() && heap.size() == topK;
+            uint32_t next = UINT32_MAX;
+            if (pruned) {
+                results.totalIsLowerBound = true;
+                next = cursors.nextCandidate(docId, heap.top().first);
+            } else {
+                for (size_t t = 0; t < cursors.size(); ++t) {
+                    cursors[t].seek(docId);
+                    if (!cursors[t].atEnd()) {
+                        next = min(next, cursors[t].docId());
+                    }
+                }
+            }
+            if (next == UINT32_MAX) {
+                break;
+            }
+            docId = next;
+            ++results.totalMatches;
+
+            if (!pruned || cursors.upperBound(docId) > heap.top().first) {
+                uint32_t length = index.getDocumentLength(static_cast<int>(docId));
+                double score = 0.0;
+                for (size_t t = 0; t < cursors.size(); ++t) {
+                    if (cursors[t].seek(docId)) {
+                        score += scorer.score(idf[t], cursors[t].frequency(), length);
+                        ++scored;
+                    }
+                }
+                offer(heap, topK, score, docId);
+            }
+            ++docId;
+        }
+        if (results.totalIsLowerBound) {
+            // Com uma única lista, o total é o tamanho dela
+            results.totalMatches = max(results.totalMatches, longest);
+            results.totalIsLowerBound = nonEmpty > 1;
+        }
+        Statistics::add(Statistics::POSTINGS_SCORED, scored);
+        Statistics::add(Statistics::POSTINGS_SKIPPED, cursors.postingCount() - cursors.decodedCount());
+
+        drain(heap, results);
+        return results;
+    }
+
+    /**
+     * Retorna, em ordem, os IDs dos documentos que contêm a frase.
+     * Lança uma exceção se o índice não guarda posições.
+     */
+    vector<uint32_t> phraseDocuments(const Phrase& phrase) const {
+        return matchPhrases({}, {phrase});
+    }
+
+    /**
+     * Converte uma lista de IDs de documentos nos nomes dos arquivos.
+     */
+    vector<string> fileNames(PostingSpan docIds) const {
+        ScopedTimer timer(Statistics::FILE_NAMES);
         vector<string> fileResults;
-        for (int docId : result) {
-            fileResults.push_back(index.getFileName(docId));
+        fileResults.reserve(docIds.size());
+        for (uint32_t docId : docIds) {
+            fileResults.push_back(index.getFileName(static_cast<int>(docId)));
         }
-        
         return fileResults;
     }
+
+private:
+    // Documento pontuado: (pontuação, ID)
+    using ScoredDocument = pair<double, uint32_t>;
+
+    /**
+     * Comparação "melhor que": maior pontuação; empates favorecem o menor ID.
+     */
+    struct Better {
+        bool operator()(const ScoredDocument& a, const ScoredDocument& b) const {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        }
+    };
+
+    /**
+     * Pontuador BM25 com as estatísticas da coleção (ou do próprio índice).
+     */
+    BM25Scorer makeScorer() const {
+        if (collection) {
+            return BM25Scorer(collection->documentCount, collection->averageLength);
+        }
+        return BM25Scorer(index.getDocumentCount(), index.getAverageDocumentLength());
+    }
+
+    // Heap dos K melhores; com a comparação "melhor que", o topo é o pior deles
+    using TopHeap = priority_queue<ScoredDocument, vector<ScoredDocument>, Better>;
+
+    /**
+     * Oferece um documento ao heap, que guarda no máximo topK documentos.
+     */
+    static void offer(TopHeap& heap, size_t topK, double score, uint32_t docId) {
+        if (heap.size() < topK) {
+            heap.emplace(score, docId);
+        } else if (Better()(make_pair(score, docId), heap.top())) {
+            heap.pop();
+            heap.emplace(score, docId);
+        }
+    }
+
+    /**
+     * Cursores das palavras de uma consulta ranqueada (ver PostingCursor) e,
+     * com a poda, os limites de pontuação dos blocos e a divisão entre
+     * palavras essenciais e não essenciais (MaxScore).
+     */
+    class RankingCursors {
+    private:
+        // Margem para o arredondamento da soma dos limites em outra ordem
+        static constexpr double ROUNDING_SLACK = 1e-9;
+
+        vector<PostingCursor> cursors;
+        // Com a poda: limites dos blocos e o maior limite de cada palavra
+        vector<vector<double>> blockLimits;
+        vector<double> termLimits;
+        // Palavras em ordem crescente de limite; as firstEssential primeiras não são essenciais
+        vector<size_t> order;
+        size_t firstEssential;
+        double nonEssentialLimit;
+        vector<char> essential;
+        bool active;
+
+    public:
+        explicit RankingCursors(vector<PostingCursor> postingCursors)
+            : cursors(move(postingCursors)), firstEssential(0), nonEssentialLimit(0.0),
+              essential(cursors.size(), 1), active(false) {}
+
+        size_t size() const {
+            return cursors.size();
+        }
+
+        PostingCursor& operator[](size_t t) {
+            return cursors[t];
+        }
+
+        const PostingCursor& operator[](size_t t) const {
+            return cursors[t];
+        }
+
+        /**
+         * Total de postings das palavras.
+         */
+        size_t postingCount() const {
+            size_t total = 0;
+            for (const PostingCursor& cursor : cursors) {
+                total += cursor.size();
+            }
+            return total;
+        }
+
+        /**
+         * Postings decodificadas pelos cursores; as demais foram puladas.
+         */
+        size_t decodedCount() const {
+            size_t total = 0;
+            for (const PostingCursor& cursor : cursors) {
+                total += cursor.decodedCount();
+            }
+            return total;
+        }
+
+        /**
+         * Calcula os limites dos blocos e liga a poda. Os cursores precisam
+         * ter os resumos dos blocos (Index::getPostingCursor com bounds).
+         */
+        void prepareBounds(const BM25Scorer& scorer, const vector<double>& idf) {
+            blockLimits.resize(cursors.size());
+            termLimits.assign(cursors.size(), 0.0);
+            for (size_t t = 0; t < cursors.size(); ++t) {
+                for (const PostingBlock& block : cursors[t].blocks()) {
+                    blockLimits[t].push_back(scorer.score(idf[t], block.maxFrequency, block.minLength));
+                    termLimits[t] = max(termLimits[t], blockLimits[t].back());
+                }
+            }
+            order.resize(cursors.size());
+            iota(order.begin(), order.end(), 0);
+            sort(order.begin(), order.end(), [&](size_t a, size_t b) { return termLimits[a] < termLimits[b]; });
+            active = true;
+        }
+
+        bool pruning() const {
+            return active;
+        }
+
+        /**
+         * Com threshold sendo a pontuação do pior documento do heap, retorna o
+         * primeiro documento >= docId de alguma palavra essencial que ainda
+         * pode entrar no heap, ou UINT32_MAX se não houver mais nenhum.
+         * Enquanto a soma dos limites dos blocos em que o documento pode estar
+         * não passa de threshold, pula até o fim do primeiro desses blocos só
+         * pelos resumos; os cursores das palavras essenciais só decodificam o
+         * bloco em que param.
+         */
+        uint32_t nextCandidate(uint32_t docId, double threshold) {
+            // As palavras de menor limite deixam de ser essenciais conforme o heap melhora
+            while (firstEssential < order.size() &&
+                   (nonEssentialLimit + termLimits[order[firstEssential]]) * (1.0 + ROUNDING_SLACK) <= threshold) {
+                nonEssentialLimit += termLimits[order[firstEssential]];
+                essential[order[firstEssential]] = 0;
+                ++firstEssential;
+            }
+            while (true) {
+                // A soma segue a ordem da pontuação (ver upperBound) e vale até regionEnd
+                double limit = 0.0;
+                uint32_t regionEnd = UINT32_MAX;
+                bool remaining = false;
+                for (size_t t = 0; t < cursors.size(); ++t) {
+                    size_t b = cursors[t].blockOf(docId);
+                    if (b < blockLimits[t].size()) {
+                        limit += blockLimits[t][b];
+                        regionEnd = min(regionEnd, cursors[t].blocks()[b].lastDocId);
+                        remaining = remaining || essential[t];
+                    }
+                }
+                if (!remaining) {
+                    return UINT32_MAX;
+                }
+                if (limit <= threshold) {
+                    if (regionEnd == UINT32_MAX) {
+                        return UINT32_MAX;
+                    }
+                    docId = regionEnd + 1;
+                    continue;
+                }
+
+                uint32_t next = UINT32_MAX;
+                for (size_t k = firstEssential; k < order.size(); ++k) {
+                    PostingCursor& cursor = cursors[order[k]];
+                    cursor.seek(docId);
+                    if (!cursor.atEnd()) {
+                        next = min(next, cursor.docId());
+                    }
+                }
+                if (next <= regionEnd || next == UINT32_MAX) {
+                    return next;
+                }
+                // O candidato está depois do trecho avaliado: confere os limites dele
+                docId = next;
+            }
+        }
+
+        /**
+         * Limite da pontuação de um candidato (já posicionado por nextCandidate):
+         * o limite do bloco de cada palavra essencial que contém o documento e
+         * de cada palavra não essencial que pode contê-lo. A soma segue a ordem
+         * da pontuação, para o arredondamento nunca deixá-la abaixo da pontuação real.
+         */
+        double upperBound(uint32_t docId) {
+            double limit = 0.0;
+            for (size_t t = 0; t < cursors.size(); ++t) {
+                PostingCursor& cursor = cursors[t];
+                if (essential[t] && (cursor.atEnd() || cursor.docId() != docId)) {
+                    continue;
+                }
+                size_t b = cursor.blockOf(docId);
+                if (b < blockLimits[t].size()) {
+                    limit += blockLimits[t][b];
+                }
+            }
+            return limit;
+        }
+
+        /**
+         * Limite da pontuação de um documento que está em todas as listas
+         * (consultas AND): a soma dos limites dos blocos que o contêm.
+         */
+        double blockBound(uint32_t docId) {
+            double limit = 0.0;
+            for (size_t t = 0; t < cursors.size(); ++t) {
+                limit += blockLimits[t][cursors[t].blockOf(docId)];
+            }
+            return limit;
+        }
+    };
+
+    /**
+     * Peso (idf) de cada palavra, pela frequência na coleção ou, sem as
+     * estatísticas da coleção, pelo tamanho da lista no próprio índice.
+     */
+    vector<double> idfOf(const BM25Scorer& scorer, const vector<string>& terms,
+                         const RankingCursors& cursors) const {
+        vector<double> idf;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            idf.push_back(scorer.idf(collection ? collection->documentFrequency(terms[i]) : cursors[i].size()));
+        }
+        return idf;
+    }
+
+    /**
+     * Esvazia o heap em results.documents, do mais relevante para o menos
+     * relevante, resolvendo só agora o nome dos arquivos.
+     */
+    void drain(TopHeap& heap, RankedResults& results) const {
+        ScopedTimer timer(Statistics::FILE_NAMES);
+        results.documents.resize(heap.size());
+        for (size_t i = heap.size(); i-- > 0;) {
+            results.documents[i] = {index.getFileName(static_cast<int>(heap.top().second)), heap.top().first,
+                                    heap.top().second};
+            heap.pop();
+        }
+    }
+
+    /**
+     * Buffers reaproveitados na verificação das frases.
+     */
+    struct PhraseBuffers {
+        vector<size_t> order;
+        vector<uint32_t> starts;
+        vector<uint32_t> positions;
+    };
+
+    /**
+     * Retorna, em ordem, os IDs dos documentos que contêm todas as palavras e
+     * todas as frases. Primeiro intersecta as listas de documentos de todas as
+     * palavras (avulsas e das frases); só então, para cada candidato, decodifica
+     * as posições e confere as frases.
+     */
+    vector<uint32_t> matchPhrases(const vector<string>& words, const vector<Phrase>& phrases) const {
+        static thread_local PostingIntersector intersector;
+        vector<PostingSpan> lists;
+        for (size_t i = 0; i < words.size(); ++i) {
+            lists.push_back(index.getPostings(words[i], intersector.termBuffer(i)));
+            if (lists.back().empty()) {
+                return {};
+            }
+        }
+
+        vector<vector<PositionScratch>> scratch(phrases.size());
+        vector<vector<PositionalList>> positional(phrases.size());
+        for (size_t p = 0; p < phrases.size(); ++p) {
+            scratch[p].resize(phrases[p].size());
+            for (size_t t = 0; t < phrases[p].size(); ++t) {
+                positional[p].push_back(index.getPositionalList(phrases[p][t].word, scratch[p][t]));
+                if (positional[p].back().docIds.empty()) {
+                    return {};
+                }
+                lists.push_back(positional[p].back().docIds);
+            }
+        }
+
+        PostingSpan candidates = intersector.intersectAll(move(lists));
+        vector<uint32_t> result;
+        vector<vector<size_t>> cursor(phrases.size());
+        for (size_t p = 0; p < phrases.size(); ++p) {
+            cursor[p].assign(phrases[p].size(), 0);
+        }
+        PhraseBuffers buffers;
+        for (uint32_t docId : candidates) {
+            bool matches = true;
+            for (size_t p = 0; p < phrases.size() && matches; ++p) {
+                matches = phraseOccurs(phrases[p], positional[p], cursor[p], docId, buffers);
+            }
+            if (matches) {
+                result.push_back(docId);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Verifica se a frase ocorre em um documento que contém todas as suas palavras.
+     * cursor guarda a posição do documento em cada lista e só avança, pois os
+     * candidatos chegam em ordem. As palavras são conferidas da menos frequente
+     * no documento para a mais frequente, mantendo os inícios de frase ainda
+     * possíveis; as posições das demais palavras nem são decodificadas quando
+     * não sobra nenhum início.
+     */
+    static bool phraseOccurs(const Phrase& phrase, const vector<PositionalList>& lists, vector<size_t>& cursor,
+                             uint32_t docId, PhraseBuffers& buffers) {
+        buffers.order.resize(phrase.size());
+        for (size_t t = 0; t < phrase.size(); ++t) {
+            const PostingSpan& ids = lists[t].docIds;
+            cursor[t] = lower_bound(ids.begin() + cursor[t], ids.end(), docId) - ids.begin();
+            buffers.order[t] = t;
+        }
+        sort(buffers.order.begin(), buffers.order.end(), [&](size_t a, size_t b) {
+            return lists[a].frequency(cursor[a]) < lists[b].frequency(cursor[b]);
+        });
+
+        vector<uint32_t>& starts = buffers.starts;
+        vector<uint32_t>& positions = buffers.positions;
+        size_t first = buffers.order[0];
+        lists[first].positions(cursor[first], positions);
+        starts.clear();
+        for (uint32_t position : positions) {
+            if (position >= phrase[first].offset) {
+                starts.push_back(position - phrase[first].offset);
+            }
+        }
+
+        for (size_t k = 1; k < buffers.order.size() && !starts.empty(); ++k) {
+            size_t t = buffers.order[k];
+            lists[t].positions(cursor[t], positions);
+            // Mantém os inícios s para os quais a palavra aparece em s + offset
+            size_t kept = 0;
+            size_t j = 0;
+            for (uint32_t start : starts) {
+                uint32_t wanted = start + phrase[t].offset;
+                while (j < positions.size() && positions[j] < wanted) {
+                    ++j;
+                }
+                if (j < positions.size() && positions[j] == wanted) {
+                    starts[kept++] = start;
+                }
+            }
+            starts.resize(kept);
+        }
+        return !starts.empty();
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,433 @@
+#ifndef QUERYSERVER_HPP
+#define QUERYSERVER_HPP
+
+#include "searchEngine.hpp"
+#include "threadPool.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <iomanip>
+#include <memory>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Servidor de consultas residente: o índice e as stop words são carregados
+ * uma única vez e as consultas chegam por um protocolo de linhas.
+ *
+ * Protocolo: cada linha é uma busca com a mesma sintaxe do comando buscar
+ * (termos, frases entre aspas, operadores booleanos e, opcionalmente, --rank,
+ * --top K, --explain, --expansoes N e --fuzzy[=k]). A resposta é o mesmo texto
+ * que o comando buscar imprime, seguido de uma linha "FIM <tempo> ms" com
+ * a latência da consulta. Linhas vazias são ignoradas; "sair" encerra a
+ * conexão (ou a entrada padrão) e "desligar" encerra o servidor de socket.
+ * Com cache, "cache" mostra os contadores e "invalidar" o esvazia (para
+ * usar depois de o índice mudar).
+ *
+ * As consultas são executadas por um conjunto de threads que compartilham
+ * o índice somente leitura e o cache.
+ */
+class QueryServer {
+private:
+    // Executor das buscas (compartilhado, somente leitura)
+    const SearchEngine& engine;
+    // Cache de consultas do engine (nullptr se desligado)
+    QueryCache* cache;
+    // Threads de trabalho
+    ThreadPool pool;
+    // Estatísticas de latência
+    atomic<uint64_t> queryCount;
+    atomic<uint64_t> totalMicros;
+    atomic<uint64_t> maxMicros;
+    // Indica que o servidor de socket deve parar de aceitar conexões
+    atomic<bool> shuttingDown;
+    // Socket de escuta (-1 se não houver)
+    atomic<int> listenFd;
+
+    /**
+     * Estado de uma conexão do socket. O buffer só é usado pela thread que
+     * lê as conexões; os demais campos são protegidos por connectionMutex.
+     */
+    struct Connection {
+        int fd = -1;
+        // Bytes recebidos que ainda não formam uma linha
+        string buffer;
+        // Consultas que esperam a consulta em execução da conexão
+        deque<string> queued;
+        // Há uma consulta da conexão no conjunto de threads
+        bool running = false;
+        // Não há mais o que ler (fim da conexão, "sair" ou "desligar")
+        bool finished = false;
+        // O envio de uma resposta falhou; as consultas seguintes são descartadas
+        bool failed = false;
+    };
+
+    // Protege o estado das conexões e openConnections
+    mutex connectionMutex;
+    // Avisa quando uma conexão é fechada
+    condition_variable connectionClosed;
+    // Conexões aceitas que ainda não foram fechadas
+    size_t openConnections;
+
+public:
+    QueryServer(const SearchEngine& searchEngine, unsigned threads, QueryCache* queryCache = nullptr)
+        : engine(searchEngine), cache(queryCache), pool(threads), queryCount(0), totalMicros(0),
+          maxMicros(0), shuttingDown(false), listenFd(-1), openConnections(0) {}
+
+    /**
+     * Atende consultas lidas de in, escrevendo as respostas em out na mesma
+     * ordem das linhas. As consultas são distribuídas entre as threads; uma
+     * thread separada escreve cada resposta assim que ela (e as anteriores)
+     * ficam prontas. Termina no fim da entrada ou na linha "sair".
+     */
+    void serveStream(istream& in, ostream& out) {
+        deque<future<string>> pending;
+        mutex pendingMutex;
+        condition_variable ready;
+        bool finished = false;
+
+        thread writer([&]() {
+            while (true) {
+                future<string> response;
+                {
+                    unique_lock<mutex> lock(pendingMutex);
+                    ready.wait(lock, [&]() { return finished || !pending.empty(); });
+                    if (pending.empty()) {
+                        return;
+                    }
+                    response = move(pending.front());
+                    pending.pop_front();
+                }
+                out << response.get() << flush;
+            }
+        });
+
+        string line;
+        while (getline(in, line)) {
+            string command = trim(line);
+            if (command.empty()) {
+                continue;
+            }
+            if (command == "sair") {
+                break;
+            }
+            future<string> response = pool.submit([this, command]() { return answer(command); });
+            {
+                lock_guard<mutex> lock(pendingMutex);
+                pending.push_back(move(response));
+            }
+            ready.notify_one();
+        }
+
+        {
+            lock_guard<mutex> lock(pendingMutex);
+            finished = true;
+        }
+        ready.notify_one();
+        writer.join();
+    }
+
+    /**
+     * Escuta conexões em um socket Unix no caminho informado. A thread que
+     * chama serveSocket aceita as conexões e lê de todas elas com poll; só
+     * as linhas de consulta completas vão para o conjunto de threads, então
+     * conexões ociosas não prendem threads. Cada conexão tem no máximo uma
+     * consulta em execução, e as respostas saem na ordem das linhas.
+     * Termina quando algum cliente envia "desligar" (as conexões abertas são
+     * atendidas até fecharem).
+     * Lança uma exceção se não conseguir criar o socket.
+     */
+    void serveSocket(const string& path) {
+        sockaddr_un address = {};
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("Caminho do socket muito longo: " + path);
+        }
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw runtime_error("Não foi possível criar o socket");
+        }
+        unlink(path.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 64) != 0) {
+            close(fd);
+            throw runtime_error("Não foi possível escutar no socket: " + path);
+        }
+        listenFd = fd;
+
+        // Conexões das quais ainda se lê (a posição 0 de polled é o socket de escuta)
+        vector<shared_ptr<Connection>> reading;
+        vector<pollfd> polled;
+        char chunk[4096];
+        while (!shuttingDown || !reading.empty()) {
+            polled.assign(1, {shuttingDown ? -1 : fd, POLLIN, 0});
+            for (const shared_ptr<Connection>& connection : reading) {
+                polled.push_back({connection->fd, POLLIN, 0});
+            }
+            if (poll(polled.data(), polled.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+
+            // Lê das conexões antes de aceitar, pois reading e polled andam juntos
+            size_t kept = 0;
+            for (size_t i = 0; i < reading.size(); ++i) {
+                shared_ptr<Connection>& connection = reading[i];
+                bool open = true;
+                if (polled[i + 1].revents != 0) {
+                    ssize_t received = recv(connection->fd, chunk, sizeof(chunk), 0);
+                    if (received > 0) {
+                        connection->buffer.append(chunk, static_cast<size_t>(received));
+                        open = dispatchLines(connection);
+                    } else {
+                        open = received < 0 && errno == EINTR;
+                    }
+                }
+                if (open) {
+                    reading[kept++] = move(connection);
+                } else {
+                    finishReading(connection);
+                }
+            }
+            reading.resize(kept);
+
+            if (!shuttingDown && polled[0].revents != 0) {
+                int client = accept(fd, nullptr, nullptr);
+                if (client >= 0) {
+                    auto connection = make_shared<Connection>();
+                    connection->fd = client;
+                    {
+                        lock_guard<mutex> lock(connectionMutex);
+                        ++openConnections;
+                    }
+                    reading.push_back(move(connection));
+                } else if (errno != EINTR && errno != ECONNABORTED) {
+                    shuttingDown = true;
+                }
+            }
+        }
+
+        // Espera as respostas que ainda estão sendo enviadas
+        {
+            unique_lock<mutex> lock(connectionMutex);
+            connectionClosed.wait(lock, [this]() { return openConnections == 0; });
+        }
+        listenFd = -1;
+        close(fd);
+        unlink(path.c_str());
+    }
+
+    /**
+     * Escreve o resumo das latências das consultas atendidas e, com cache,
+     * os contadores dele.
+     */
+    void printSummary(ostream& out) const {
+        uint64_t count = queryCount;
+        out << "Consultas atendidas: " << count;
+        if (count > 0) {
+            out << fixed << setprecision(3)
+                << " (latência média " << totalMicros / 1000.0 / count << " ms, "
+                << "máxima " << maxMicros / 1000.0 << " ms)";
+        }
+        out << "\n";
+        if (cache) {
+            printCacheStatistics(out);
+        }
+    }
+
+private:
+    /**
+     * Executa uma linha de consulta e retorna a resposta completa,
+     * terminada pela linha "FIM <tempo> ms".
+     */
+    string answer(const string& line) {
+        auto start = chrono::steady_clock::now();
+        if (cache && (line == "cache" || line == "invalidar")) {
+            ostringstream out;
+            if (line == "invalidar") {
+                cache->invalidate();
+                out << "Cache invalidado.\n";
+            }
+            printCacheStatistics(out);
+            out << "FIM 0.000 ms\n";
+            return out.str();
+        }
+
+        ostringstream out;
+        engine.searchLine(line, out);
+
+        uint64_t micros = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start).count();
+        recordLatency(micros);
+        out << "FIM " << fixed << setprecision(3) << micros / 1000.0 << " ms\n";
+        return out.str();
+    }
+
+    /**
+     * Escreve os contadores dos dois níveis do cache.
+     */
+    void printCacheStatistics(ostream& out) const {
+        auto print = [&](const char* name, const CacheStatistics& stats) {
+            out << "Cache de " << name << ": " << stats.hits << " acertos, " << stats.misses << " faltas, "
+                << stats.evictions << " remoções, " << stats.entries << " entradas, "
+                << (stats.bytes + 1023) / 1024 << " de " << stats.budget / 1024 << " KB\n";
+        };
+        print("resultados", cache->resultStatistics());
+        print("pares", cache->pairStatistics());
+    }
+
+    /**
+     * Atualiza as estatísticas com a latência de uma consulta.
+     */
+    void recordLatency(uint64_t micros) {
+        ++queryCount;
+        totalMicros += micros;
+        uint64_t previous = maxMicros;
+        while (micros > previous && !maxMicros.compare_exchange_weak(previous, micros)) {
+        }
+    }
+
+    /**
+     * Envia para o conjunto de threads as linhas completas recebidas pela
+     * conexão. Retorna false se o cliente enviou "sair" ou "desligar" (o
+     * resto da entrada é descartado).
+     */
+    bool dispatchLines(const shared_ptr<Connection>& connection) {
+        string& buffer = connection->buffer;
+        size_t start = 0;
+        size_t newline;
+        bool open = true;
+        while (open && (newline = buffer.find('\n', start)) != string::npos) {
+            string command = trim(buffer.substr(start, newline - start));
+            start = newline + 1;
+            if (command.empty()) {
+                continue;
+            }
+            if (command == "sair") {
+                open = false;
+            } else if (command == "desligar") {
+                open = false;
+                requestShutdown();
+            } else {
+                lock_guard<mutex> lock(connectionMutex);
+                if (connection->failed) {
+                    continue;
+                }
+                if (connection->running) {
+                    connection->queued.push_back(move(command));
+                } else {
+                    connection->running = true;
+                    submitQuery(connection, move(command));
+                }
+            }
+        }
+        buffer.erase(0, start);
+        return open;
+    }
+
+    /**
+     * Responde a uma consulta da conexão em uma thread do conjunto. A
+     * próxima consulta enfileirada da mesma conexão vai para o fim da fila
+     * do conjunto, para que uma conexão com muitas linhas não monopolize a
+     * thread.
+     */
+    void submitQuery(const shared_ptr<Connection>& connection, string command) {
+        pool.submit([this, connection, command]() {
+            bool sent = sendAll(connection->fd, answer(command));
+            lock_guard<mutex> lock(connectionMutex);
+            if (!sent) {
+                connection->failed = true;
+                connection->queued.clear();
+            }
+            if (!connection->queued.empty()) {
+                string next = move(connection->queued.front());
+                connection->queued.pop_front();
+                submitQuery(connection, move(next));
+                return;
+            }
+            connection->running = false;
+            if (connection->finished) {
+                closeConnection(*connection);
+            }
+        });
+    }
+
+    /**
+     * Marca que não há mais o que ler da conexão; ela é fechada agora ou,
+     * se ainda houver consultas dela, quando a última for respondida.
+     */
+    void finishReading(const shared_ptr<Connection>& connection) {
+        lock_guard<mutex> lock(connectionMutex);
+        connection->finished = true;
+        if (!connection->running) {
+            closeConnection(*connection);
+        }
+    }
+
+    /**
+     * Fecha a conexão (connectionMutex deve estar travado).
+     */
+    void closeConnection(Connection& connection) {
+        close(connection.fd);
+        connection.fd = -1;
+        --openConnections;
+        connectionClosed.notify_all();
+    }
+
+    /**
+     * Para de aceitar novas conexões no socket.
+     */
+    void requestShutdown() {
+        shuttingDown = true;
+        int fd = listenFd;
+        if (fd >= 0) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    /**
+     * Envia todos os bytes pela conexão. Retorna false se o cliente desconectou.
+     */
+    static bool sendAll(int client, const string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * Remove espaços (inclusive \r) do início e do fim de uma linha.
+     */
+    static string trim(const string& line) {
+        const char* spaces = " \t\r\n";
+        size_t first = line.find_first_not_of(spaces);
+        if (first == string::npos) {
+            return "";
+        }
+        size_t last = line.find_last_not_of(spaces);
+        return line.substr(first, last - first + 1);
+    }
+};
+
+#endif
@@ -0,0 +1,825 @@
+#ifndef SEARCHENGINE_HPP
+#define SEARCHENGINE_HPP
+
+#include "index.hpp"
+#include "textProcessor.hpp"
+#include "queryProcessor.hpp"
+#include "booleanQuery.hpp"
+#include "queryPlanner.hpp"
+#include "threadPool.hpp"
+#include "snippetGenerator.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <future>
+#include <exception>
+
+using namespace std;
+
+/**
+ * Opções de uma busca.
+ */
+struct SearchOptions {
+    // Ordena os resultados por relevância (BM25) em vez de ID
+    bool ranked = false;
+    // Quantidade máxima de resultados na busca ranqueada
+    size_t topK = 10;
+    // Mostra o plano escolhido para a consulta
+    bool explain = false;
+    // Quantidade máxima de palavras na expansão de um padrão com curingas
+    size_t maxExpansions = 1000;
+    // Busca aproximada: distância máxima de edição dos termos (0 = busca exata)
+    uint32_t fuzzy = 0;
+    // Mostra trechos dos documentos com as palavras da consulta destacadas (busca ranqueada)
+    bool snippets = false;
+};
+
+/**
+ * Executa buscas completas sobre um índice já aberto: normaliza os termos,
+ * descarta stop words, consulta o índice e escreve a resposta.
+ * É a mesma lógica do comando buscar, compartilhada com o modo servidor.
+ * Não modifica o índice nem o processador de texto, podendo ser usada
+ * por várias threads ao mesmo tempo (o cache opcional tem sua própria trava).
+ *
+ * Também busca nos shards de um índice dividido (ShardedIndex): os termos são
+ * normalizados uma vez, cada shard é consultado em paralelo e os resultados
+ * são juntados, concatenados na ordem dos shards (que é a ordem dos IDs) ou,
+ * na busca ranqueada, pela pontuação, calculada com as estatísticas da coleção
+ * inteira para valer o mesmo que em um índice único.
+ */
+class SearchEngine {
+private:
+    /**
+     * Um índice consultado e o processador de consultas sobre ele.
+     */
+    struct Shard {
+        const Index* index;
+        QueryProcessor queryProcessor;
+    };
+
+    /**
+     * Resposta de um shard a uma consulta booleana.
+     */
+    struct BooleanAnswer {
+        // Avisos da normalização, um por linha
+        string warnings;
+        bool resolved = false;
+        // Plano da consulta (com options.explain)
+        string plan;
+        vector<string> files;
+        RankedResults ranked = {{}, 0};
+        // Palavras pontuadas, destacadas nos trechos (expandidas no dicionário do shard)
+        vector<string> scoredTerms;
+    };
+
+    // Processador de texto com as stop words carregadas
+    const TextProcessor& textProcessor;
+    // Estatísticas da coleção inteira (usadas pelos shards de um índice dividido)
+    CollectionStatistics collection;
+    // Índices consultados: um só, ou os shards na ordem dos IDs
+    vector<Shard> shards;
+    // Threads que consultam os shards além do primeiro (nullptr com um só índice)
+    unique_ptr<ThreadPool> pool;
+
+public:
+    SearchEngine(const Index& idx, const TextProcessor& tp, QueryCache* cache = nullptr) : textProcessor(tp) {
+        shards.push_back({&idx, QueryProcessor(idx, cache)});
+    }
+
+    /**
+     * Busca nos shards de um índice dividido, na ordem do manifesto. O
+     * primeiro shard é consultado pela thread que chama search, os demais por
+     * threads próprias do SearchEngine (separadas das de um QueryServer, para
+     * que uma consulta nunca espere por tarefas presas atrás dela na fila).
+     * Com um único índice, equivale ao outro construtor.
+     */
+    SearchEngine(const vector<Index>& indexes, const TextProcessor& tp, QueryCache* cache = nullptr)
+        : textProcessor(tp) {
+        uint64_t totalLength = 0;
+        for (const Index& index : indexes) {
+            collection.documentCount += index.getDocumentCount();
+            totalLength += index.getTotalDocumentLength();
+        }
+        if (collection.documentCount > 0) {
+            collection.averageLength = static_cast<double>(totalLength) / collection.documentCount;
+        }
+        collection.documentFrequency = [this](const string& word) {
+            size_t count = 0;
+            for (const Shard& shard : shards) {
+                count += shard.index->getDocumentFrequency(word);
+            }
+            return count;
+        };
+
+        bool sharded = indexes.size() > 1;
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            string scope = sharded ? "s" + to_string(i + 1) : "";
+            shards.push_back({&indexes[i], QueryProcessor(indexes[i], cache, scope, sharded ? &collection : nullptr)});
+        }
+        if (sharded) {
+            pool = make_unique<ThreadPool>(static_cast<unsigned>(indexes.size() - 1));
+        }
+    }
+
+    // Os processadores de consulta guardam o endereço de collection
+    SearchEngine(const SearchEngine&) = delete;
+    SearchEngine& operator=(const SearchEngine&) = delete;
+
+    /**
+     * Converte um argumento em inteiro positivo.
+     * Retorna false se o texto não for um número maior que zero.
+     */
+    static bool parsePositive(const string& text, unsigned& value) {
+        if (text.empty() || text.size() > 9 ||
+            !all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+        value = static_cast<unsigned>(stoul(text));
+        return value > 0;
+    }
+
+    /**
+     * Separa opções (--rank, --top K, --trechos, --explain, --expansoes N,
+     * --fuzzy[=k]) e termos de uma busca. --fuzzy sozinho aceita 1 edição; k
+     * vai de 1 a 2. --top e --trechos implicam --rank.
+     * Palavras entre aspas ("dom casmurro") formam um único termo, uma frase
+     * exata; um argumento com espaços (já agrupado pelo shell) também é uma frase.
+     * Parênteses colados às aspas viram termos "(" e ")" separados. Um
+     * argumento com espaços que tenha aspas, parênteses ou operadores booleanos
+     * é uma consulta inteira passada pelo shell e é separado em palavras.
+     * Retorna false se uma opção for inválida, uma aspa não for fechada ou
+     * não houver termos.
+     */
+    static bool parseArguments(const vector<string>& rawArgs, vector<string>& terms, SearchOptions& options) {
+        vector<string> args;
+        for (const string& arg : rawArgs) {
+            if (arg.find_first_of(" \t") == string::npos || !hasQuerySyntax(arg)) {
+                args.push_back(arg);
+                continue;
+            }
+            istringstream words(arg);
+            for (string word; words >> word;) {
+                args.push_back(word);
+            }
+        }
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (args[i] == "--rank") {
+                options.ranked = true;
+            } else if (args[i] == "--top") {
+                unsigned topK;
+                if (i + 1 >= args.size() || !parsePositive(args[++i], topK)) {
+                    return false;
+                }
+                options.ranked = true;
+                options.topK = topK;
+            } else if (args[i] == "--trechos") {
+                options.ranked = true;
+                options.snippets = true;
+            } else if (args[i] == "--explain") {
+                options.explain = true;
+            } else if (args[i] == "--expansoes") {
+                unsigned maxExpansions;
+                if (i + 1 >= args.size() || !parsePositive(args[++i], maxExpansions)) {
+                    return false;
+                }
+                options.maxExpansions = maxExpansions;
+            } else if (args[i] == "--fuzzy") {
+                options.fuzzy = 1;
+            } else if (args[i].compare(0, 8, "--fuzzy=") == 0) {
+                unsigned distance;
+                if (!parsePositive(args[i].substr(8), distance) || distance > 2) {
+                    return false;
+                }
+                options.fuzzy = distance;
+            } else if (opensQuote(args[i])) {
+                // Junta as palavras até a que fecha as aspas
+                size_t open = args[i].find('"');
+                terms.insert(terms.end(), open, "(");
+                string phrase = args[i].substr(open + 1);
+                size_t quote;
+                while ((quote = closingQuote(phrase)) == string::npos) {
+                    if (++i >= args.size()) {
+                        return false;
+                    }
+                    phrase += " " + args[i];
+                }
+                terms.push_back(phrase.substr(0, quote));
+                terms.insert(terms.end(), phrase.size() - quote - 1, ")");
+            } else {
+                terms.push_back(args[i]);
+            }
+        }
+        return !terms.empty();
+    }
+
+    /**
+     * Realiza uma busca por termos no índice e escreve o resultado em out.
+     * Ignora stop words na busca, mas não interrompe a busca se encontrar stop words.
+     * Com options.ranked, mostra apenas os options.topK documentos mais relevantes (BM25);
+     * com options.snippets, também os trechos de cada um (SnippetGenerator).
+     * Termos com espaços são frases exatas e exigem um índice com posições.
+     * Consultas com AND, OR, NOT, parênteses ou curingas (ou com options.explain
+     * ou options.fuzzy) passam pelo planejador de consultas booleanas.
+     */
+    void search(const vector<string>& terms, const SearchOptions& options, ostream& out) const {
+        if (options.explain || options.fuzzy > 0 || BooleanQueryParser::isBoolean(terms)) {
+            searchBoolean(terms, options, out);
+            return;
+        }
+
+        // Normaliza e filtra os termos de busca (remove stop words)
+        vector<string> normalizedTerms;
+        vector<Phrase> phrases;
+        {
+            ScopedTimer timer(Statistics::NORMALIZE);
+            for (const string& term : terms) {
+                if (term.find_first_of(" \t") != string::npos) {
+                    Phrase phrase = parsePhrase(term);
+                    if (phrase.size() > 1) {
+                        phrases.push_back(move(phrase));
+                    } else if (phrase.size() == 1) {
+                        normalizedTerms.push_back(phrase[0].word);
+                    } else {
+                        out << "Aviso: Frase '" << term << "' só tem stop words e será ignorada na busca.\n";
+                    }
+                    continue;
+                }
+                // Ignora stop words, mas mantém outros termos; um termo com separadores
+                // no meio ("dom—casmurro") conta como as suas palavras, como na indexação
+                bool kept = false;
+                for (string& normalized : TextProcessor::normalizeTerms(term)) {
+                    if (!textProcessor.isStopWord(normalized)) {
+                        normalizedTerms.push_back(move(normalized));
+                        kept = true;
+                    }
+                }
+                if (!kept) {
+                    out << "Aviso: Termo '" << term << "' é uma stop word e será ignorado na busca.\n";
+                }
+            }
+        }
+
+        // Se todos os termos eram stop words, informa o usuário
+        if (normalizedTerms.empty() && phrases.empty()) {
+            out << "Todos os termos de busca são stop words. Nenhum documento será retornado.\n";
+            return;
+        }
+
+        if (options.ranked) {
+            // As palavras das frases também contam na pontuação
+            vector<string> scoredTerms(normalizedTerms);
+            for (const Phrase& phrase : phrases) {
+                for (const PhraseTerm& term : phrase) {
+                    scoredTerms.push_back(term.word);
+                }
+            }
+            RankedResults results = mergeRanked(fanOut([&](const Shard& shard) {
+                return shard.queryProcessor.queryRanked(scoredTerms, options.topK, phrases);
+            }), options.topK);
+            vector<vector<string>> snippets;
+            if (options.snippets) {
+                snippets = snippetsOf(results, vector<vector<string>>(shards.size(), scoredTerms), out);
+            }
+            printRanked(results, snippets, out);
+            return;
+        }
+
+        printResults(concatenate(fanOut([&](const Shard& shard) {
+            return querySimple(shard.queryProcessor, normalizedTerms, phrases);
+        })), out);
+    }
+
+    /**
+     * Executa uma linha de consulta com a sintaxe do comando buscar (opções,
+     * termos, frases entre aspas e operadores booleanos), usada pelo modo
+     * servidor e pelo modo lote, e escreve a resposta em out. Erros de sintaxe
+     * e da busca são escritos em out, sem interromper quem chamou.
+     */
+    void searchLine(const string& line, ostream& out) const {
+        vector<string> args;
+        istringstream tokens(line);
+        for (string arg; tokens >> arg;) {
+            args.push_back(arg);
+        }
+
+        if (args.empty()) {
+            out << "Erro: consulta vazia.\n";
+            return;
+        }
+        vector<string> terms;
+        SearchOptions options;
+        if (!parseArguments(args, terms, options)) {
+            out << "Erro: consulta inválida. Uso: [--rank] [--top K] [--trechos] [--explain] [--fuzzy[=k]] <consulta>\n";
+            return;
+        }
+        try {
+            search(terms, options, out);
+        } catch (const exception& e) {
+            out << "Erro durante a busca: " << e.what() << "\n";
+        }
+    }
+
+private:
+    /**
+     * Busca com operadores booleanos (ou com --explain): monta a árvore da
+     * consulta, normaliza as folhas, planeja e executa.
+     */
+    void searchBoolean(const vector<string>& terms, const SearchOptions& options, ostream& out) const {
+        QueryNode query;
+        try {
+            query = BooleanQueryParser::parse(terms);
+        } catch (const exception& e) {
+            out << "Erro: consulta inválida: " << e.what() << ".\n";
+            return;
+        }
+        // Os padrões e a busca aproximada se expandem no dicionário de cada shard
+        vector<BooleanAnswer> answers = fanOut([&](const Shard& shard) {
+            return evaluateBoolean(shard, query, options);
+        });
+        printWarnings(answers, out);
+        if (!answers[0].resolved) {
+            out << "Todos os termos de busca são stop words. Nenhum documento será retornado.\n";
+            return;
+        }
+
+        if (options.explain) {
+            for (size_t i = 0; i < answers.size(); ++i) {
+                if (answers.size() == 1) {
+                    out << "Plano da consulta:\n";
+                } else {
+                    out << "Plano da consulta (shard " << (i + 1) << " de " << answers.size() << "):\n";
+                }
+                out << answers[i].plan;
+            }
+        }
+
+        if (options.ranked) {
+            vector<RankedResults> parts;
+            vector<vector<string>> words;
+            for (BooleanAnswer& answer : answers) {
+                parts.push_back(move(answer.ranked));
+                words.push_back(move(answer.scoredTerms));
+            }
+            RankedResults results = mergeRanked(move(parts), options.topK);
+            vector<vector<string>> snippets;
+            if (options.snippets) {
+                snippets = snippetsOf(results, words, out);
+            }
+            printRanked(results, snippets, out);
+            return;
+        }
+        vector<vector<string>> parts;
+        for (BooleanAnswer& answer : answers) {
+            parts.push_back(move(answer.files));
+        }
+        printResults(concatenate(move(parts)), out);
+    }
+
+    /**
+     * Normaliza, planeja e executa a consulta booleana em um shard. Recebe uma
+     * cópia da árvore, pois a normalização a modifica com as palavras do shard.
+     */
+    BooleanAnswer evaluateBoolean(const Shard& shard, QueryNode query, const SearchOptions& options) const {
+        BooleanAnswer answer;
+        ostringstream warnings;
+        {
+            ScopedTimer timer(Statistics::NORMALIZE);
+            answer.resolved = resolve(*shard.index, query, options, warnings);
+        }
+        answer.warnings = warnings.str();
+        if (!answer.resolved) {
+            return answer;
+        }
+
+        QueryPlanner planner(*shard.index, shard.queryProcessor);
+        QueryPlan plan = planner.plan(query);
+        // Uma disjunção ranqueada é pontuada direto das listas, sem montar a união
+        bool disjunction = options.ranked && isDisjunction(query);
+        vector<uint32_t> docIds;
+        if (!disjunction) {
+            docIds = planner.execute(plan);
+        }
+        if (options.explain) {
+            ostringstream text;
+            QueryPlanner::explain(plan, text);
+            if (disjunction) {
+                text << "  (disjunção ranqueada: candidatos tirados das listas, sem montar a união)\n";
+            }
+            answer.plan = text.str();
+        }
+
+        if (options.ranked) {
+            // Só as palavras fora de um NOT contam na pontuação
+            collectPositiveWords(query, answer.scoredTerms);
+            answer.ranked = disjunction
+                ? shard.queryProcessor.rankDisjunction(answer.scoredTerms, options.topK)
+                : shard.queryProcessor.rankDocuments(docIds, answer.scoredTerms, options.topK);
+        } else {
+            answer.files = shard.queryProcessor.fileNames(PostingSpan(docIds));
+        }
+        return answer;
+    }
+
+    /**
+     * Indica se a consulta é só um OR de palavras (termos, padrões ou busca
+     * aproximada), sem AND, NOT ou frases.
+     */
+    static bool isDisjunction(const QueryNode& node) {
+        if (node.type == QueryNode::TERM || node.type == QueryNode::PATTERN || node.type == QueryNode::FUZZY) {
+            return true;
+        }
+        if (node.type != QueryNode::OR) {
+            return false;
+        }
+        return all_of(node.children.begin(), node.children.end(), [](const QueryNode& child) {
+            return isDisjunction(child);
+        });
+    }
+
+    /**
+     * Escreve os avisos do primeiro shard e, dos outros, só os que ainda não
+     * apareceram (os de stop words se repetem em todos; os de expansões
+     * dependem do dicionário de cada shard).
+     */
+    static void printWarnings(const vector<BooleanAnswer>& answers, ostream& out) {
+        vector<string> printed;
+        for (size_t i = 0; i < answers.size(); ++i) {
+            istringstream lines(answers[i].warnings);
+            for (string line; getline(lines, line);) {
+                if (i == 0 || find(printed.begin(), printed.end(), line) == printed.end()) {
+                    out << line << "\n";
+                    printed.push_back(line);
+                }
+            }
+        }
+    }
+
+    /**
+     * Executa function em cada shard e retorna os resultados na ordem dos
+     * shards. O primeiro é consultado nesta thread e os demais no pool, ao
+     * mesmo tempo. Se algum falhar, espera todos terminarem (as tarefas usam
+     * variáveis desta chamada) e relança o primeiro erro.
+     */
+    template <typename Function>
+    auto fanOut(Function function) const -> vector<decltype(function(declval<const Shard&>()))> {
+        using Result = decltype(function(declval<const Shard&>()));
+        vector<Result> results(shards.size());
+        if (!pool) {
+            for (size_t i = 0; i < shards.size(); ++i) {
+                results[i] = function(shards[i]);
+            }
+            return results;
+        }
+
+        vector<future<Result>> pending;
+        for (size_t i = 1; i < shards.size(); ++i) {
+            pending.push_back(pool->submit([this, &function, i]() { return function(shards[i]); }));
+        }
+        exception_ptr error;
+        try {
+            results[0] = function(shards[0]);
+        } catch (...) {
+            error = current_exception();
+        }
+        for (size_t i = 1; i < shards.size(); ++i) {
+            try {
+                results[i] = pending[i - 1].get();
+            } catch (...) {
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+        }
+        if (error) {
+            rethrow_exception(error);
+        }
+        return results;
+    }
+
+    /**
+     * Junta os documentos encontrados em cada shard. As faixas de IDs seguem
+     * a ordem dos shards, então a concatenação já está em ordem de ID.
+     */
+    static vector<string> concatenate(vector<vector<string>> parts) {
+        if (parts.size() == 1) {
+            return move(parts[0]);
+        }
+        vector<string> results;
+        for (vector<string>& part : parts) {
+            results.insert(results.end(), make_move_iterator(part.begin()), make_move_iterator(part.end()));
+        }
+        return results;
+    }
+
+    /**
+     * Junta os topK melhores de cada shard nos topK melhores da coleção. Em
+     * cada shard os empates estão em ordem de ID, e a ordenação estável mantém
+     * a ordem dos shards, então os empates seguem o mesmo critério do índice único.
+     */
+    static RankedResults mergeRanked(vector<RankedResults> parts, size_t topK) {
+        if (parts.size() == 1) {
+            return move(parts[0]);
+        }
+        RankedResults merged = {{}, 0};
+        for (RankedResults& part : parts) {
+            merged.totalMatches += part.totalMatches;
+            merged.totalIsLowerBound = merged.totalIsLowerBound || part.totalIsLowerBound;
+            merged.documents.insert(merged.documents.end(), make_move_iterator(part.documents.begin()),
+                                    make_move_iterator(part.documents.end()));
+        }
+        stable_sort(merged.documents.begin(), merged.documents.end(),
+                    [](const RankedDocument& a, const RankedDocument& b) { return a.score > b.score; });
+        if (merged.documents.size() > topK) {
+            merged.documents.resize(topK);
+        }
+        return merged;
+    }
+
+    /**
+     * Normaliza as folhas da consulta e remove as stop words (com aviso), como
+     * na busca simples; expande os padrões com curingas em até
+     * options.maxExpansions palavras (com aviso se houver mais). Com
+     * options.fuzzy, cada termo é expandido da mesma forma nas palavras do
+     * dicionário a até options.fuzzy edições; frases continuam exatas. Operadores que
+     * ficam sem operandos também são removidos.
+     * Retorna false se o nó inteiro foi removido.
+     */
+    bool resolve(const Index& index, QueryNode& node, const SearchOptions& options, ostream& out) const {
+        switch (node.type) {
+            case QueryNode::PATTERN: {
+                // As palavras do índice não têm separadores, então o padrão não casaria com nenhuma
+                if (TextProcessor::hasSeparator(node.text)) {
+                    out << "Aviso: O padrão '" << node.text << "' tem separadores de palavras e será ignorado "
+                           "na busca.\n";
+                    return false;
+                }
+                WildcardPattern pattern(node.text);
+                node.word = pattern.text();
+                node.expansions = index.findWords(pattern, options.maxExpansions + 1);
+                if (node.expansions.size() > options.maxExpansions) {
+                    node.expansions.resize(options.maxExpansions);
+                    out << "Aviso: O padrão '" << node.text << "' casa com mais de " << options.maxExpansions
+                        << " palavras; apenas as " << options.maxExpansions
+                        << " primeiras (em ordem alfabética) serão usadas (ver --expansoes).\n";
+                }
+                return true;
+            }
+            case QueryNode::TERM: {
+                // Um termo com separadores no meio ("dom—casmurro") vira o AND das suas
+                // palavras, como na indexação
+                vector<string> words = TextProcessor::normalizeTerms(node.text);
+                if (words.size() > 1) {
+                    node.type = QueryNode::AND;
+                    for (const string& word : words) {
+                        QueryNode child;
+                        child.type = QueryNode::TERM;
+                        child.text = word;
+                        node.children.push_back(move(child));
+                    }
+                    return resolve(index, node, options, out);
+                }
+                node.word = words.empty() ? string() : words[0];
+                if (node.word.empty() || textProcessor.isStopWord(node.word)) {
+                    out << "Aviso: Termo '" << node.text << "' é uma stop word e será ignorado na busca.\n";
+                    return false;
+                }
+                if (options.fuzzy > 0) {
+                    node.type = QueryNode::FUZZY;
+                    node.distance = options.fuzzy;
+                    node.expansions = index.findSimilarWords(node.word, options.fuzzy, options.maxExpansions + 1);
+                    if (node.expansions.size() > options.maxExpansions) {
+                        node.expansions.resize(options.maxExpansions);
+                        out << "Aviso: O termo '" << node.text << "' tem mais de " << options.maxExpansions
+                            << " palavras parecidas; apenas as " << options.maxExpansions
+                            << " primeiras (em ordem alfabética) serão usadas (ver --expansoes).\n";
+                    }
+                }
+                return true;
+            }
+            case QueryNode::PHRASE:
+                node.phrase = parsePhrase(node.text);
+                if (node.phrase.empty()) {
+                    out << "Aviso: Frase '" << node.text << "' só tem stop words e será ignorada na busca.\n";
+                    return false;
+                }
+                if (node.phrase.size() == 1) {
+                    node.type = QueryNode::TERM;
+                    node.word = node.phrase[0].word;
+                }
+                return true;
+            default: {
+                vector<QueryNode> kept;
+                for (QueryNode& child : node.children) {
+                    if (resolve(index, child, options, out)) {
+                        kept.push_back(move(child));
+                    }
+                }
+                if (kept.empty()) {
+                    return false;
+                }
+                if (kept.size() == 1 && node.type != QueryNode::NOT) {
+                    QueryNode single = move(kept[0]);
+                    node = move(single);
+                } else {
+                    node.children = move(kept);
+                }
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Junta as palavras (inclusive as das frases, dos padrões e da busca
+     * aproximada) que não estão sob um NOT.
+     */
+    static void collectPositiveWords(const QueryNode& node, vector<string>& words) {
+        if (node.type == QueryNode::TERM) {
+            words.push_back(node.word);
+        } else if (node.type == QueryNode::PATTERN || node.type == QueryNode::FUZZY) {
+            words.insert(words.end(), node.expansions.begin(), node.expansions.end());
+        } else if (node.type == QueryNode::PHRASE) {
+            for (const PhraseTerm& term : node.phrase) {
+                words.push_back(term.word);
+            }
+        } else if (node.type != QueryNode::NOT) {
+            for (const QueryNode& child : node.children) {
+                collectPositiveWords(child, words);
+            }
+        }
+    }
+
+    /**
+     * Indica se o texto tem aspas, parênteses ou operadores booleanos.
+     */
+    static bool hasQuerySyntax(const string& text) {
+        if (text.find_first_of("\"()") != string::npos) {
+            return true;
+        }
+        istringstream words(text);
+        for (string word; words >> word;) {
+            if (BooleanQueryParser::isOperator(word)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Indica se o argumento abre uma frase: aspas, possivelmente após parênteses.
+     */
+    static bool opensQuote(const string& arg) {
+        size_t first = arg.find_first_not_of('(');
+        return first != string::npos && arg[first] == '"';
+    }
+
+    /**
+     * Retorna a posição das aspas que fecham a frase (seguidas apenas de
+     * parênteses), ou string::npos se a frase continua no próximo argumento.
+     */
+    static size_t closingQuote(const string& text) {
+        size_t last = text.find_last_not_of(')');
+        return (last != string::npos && text[last] == '"') ? last : string::npos;
+    }
+
+    /**
+     * Processa uma busca sem operadores booleanos (AND implícito).
+     */
+    static vector<string> querySimple(const QueryProcessor& queryProcessor, const vector<string>& normalizedTerms,
+                                      const vector<Phrase>& phrases) {
+        vector<string> results;
+        if (!phrases.empty()) {
+            results = queryProcessor.queryPhrases(normalizedTerms, phrases);
+        } else if (normalizedTerms.size() == 1) {
+            results = queryProcessor.querySingle(normalizedTerms[0]);
+        } else {
+            results = queryProcessor.queryMultiple(normalizedTerms);
+        }
+        return results;
+    }
+
+    /**
+     * Escreve os documentos encontrados, em ordem de ID.
+     */
+    static void printResults(const vector<string>& results, ostream& out) {
+        if (results.empty()) {
+            out << "Nenhum documento encontrado.\n";
+        } else {
+            out << "Documentos encontrados (" << results.size() << "):\n";
+            for (const string& filename : results) {
+                out << "  " << filename << "\n";
+            }
+        }
+    }
+
+    /**
+     * Converte o texto de uma frase em suas palavras normalizadas. As stop words
+     * não são buscadas, mas ocupam sua posição na frase.
+     */
+    Phrase parsePhrase(const string& text) const {
+        // Usa o mesmo tokenizador da indexação, para as posições coincidirem
+        Phrase phrase;
+        textProcessor.forEachPositionedToken(text, [&](const string& word, uint32_t position) {
+            phrase.push_back({word, position});
+        });
+        if (!phrase.empty()) {
+            uint32_t first = phrase[0].offset;
+            for (PhraseTerm& term : phrase) {
+                term.offset -= first;
+            }
+        }
+        return phrase;
+    }
+
+    /**
+     * Gera os trechos de cada documento do resultado (na mesma ordem), com as
+     * palavras de words[s] para os documentos do shard s. Os deslocamentos das
+     * ocorrências vêm do índice: em cada shard, a lista de cada palavra é
+     * percorrida uma vez para todos os documentos do resultado. Se algum shard
+     * não guarda os deslocamentos, escreve um aviso e retorna uma lista vazia.
+     */
+    vector<vector<string>> snippetsOf(const RankedResults& results, const vector<vector<string>>& words,
+                                      ostream& out) const {
+        for (const Shard& shard : shards) {
+            if (!shard.index->hasOffsets()) {
+                out << "Aviso: o índice não guarda os deslocamentos das palavras; construa-o com "
+                       "construir --trechos para ver os trechos.\n";
+                return {};
+            }
+        }
+        const vector<RankedDocument>& documents = results.documents;
+        vector<vector<uint32_t>> offsets(documents.size());
+        vector<size_t> owner(documents.size(), 0);
+        for (size_t s = 0; s < shards.size(); ++s) {
+            // Documentos do resultado que são deste shard, em ordem de ID
+            vector<size_t> owned;
+            for (size_t i = 0; i < documents.size(); ++i) {
+                if (shards.size() == 1 ||
+                    shards[s].index->getFileName(static_cast<int>(documents[i].docId)) == documents[i].filename) {
+                    owned.push_back(i);
+                    owner[i] = s;
+                }
+            }
+            sort(owned.begin(), owned.end(), [&](size_t a, size_t b) {
+                return documents[a].docId < documents[b].docId;
+            });
+            vector<uint32_t> docIds;
+            for (size_t i : owned) {
+                docIds.push_back(documents[i].docId);
+            }
+            vector<string> shardWords(words[s]);
+            sort(shardWords.begin(), shardWords.end());
+            shardWords.erase(unique(shardWords.begin(), shardWords.end()), shardWords.end());
+            vector<vector<uint32_t>> found;
+            for (const string& word : shardWords) {
+                shards[s].index->getOccurrenceOffsets(word, docIds, found);
+                for (size_t k = 0; k < owned.size(); ++k) {
+                    offsets[owned[k]].insert(offsets[owned[k]].end(), found[k].begin(), found[k].end());
+                }
+            }
+        }
+
+        SnippetGenerator generator(textProcessor);
+        vector<vector<string>> snippets(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            snippets[i] = generator.generate(documents[i].filename, move(offsets[i]), words[owner[i]]);
+        }
+        return snippets;
+    }
+
+    /**
+     * Escreve os resultados de uma busca ranqueada, do mais relevante para o menos
+     * relevante, cada um seguido de seus trechos (se snippets não estiver vazia).
+     * A formatação das pontuações é desfeita no final, pois out pode ser cout
+     * ou a conexão do servidor, que seguem em uso.
+     */
+    static void printRanked(const RankedResults& results, const vector<vector<string>>& snippets, ostream& out) {
+        if (results.documents.empty()) {
+            out << "Nenhum documento encontrado.\n";
+            return;
+        }
+        out << "Documentos mais relevantes (" << results.documents.size()
+            << " de " << (results.totalIsLowerBound ? "pelo menos " : "") << results.totalMatches << "):\n";
+        ios::fmtflags flags = out.flags();
+        streamsize precision = out.precision();
+        out << fixed << setprecision(4);
+        for (size_t i = 0; i < results.documents.size(); ++i) {
+            out << "  " << (i + 1) << ". " << results.documents[i].filename
+                << " (" << results.documents[i].score << ")\n";
+            if (i < snippets.size()) {
+                for (const string& snippet : snippets[i]) {
+                    out << "      " << snippet << "\n";
+                }
+            }
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+#endif
@@ -2,121 +2,318 @@
 #define SERIALIZER_HPP
 
 #include "index.hpp"
+#include "mappedIndex.hpp"
+#include "varByte.hpp"
+#include "shardManifest.hpp"
+#include "indexFileWriter.hpp"
 #include <string>
 #include <fstream>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <filesystem>
 
 using namespace std;
 
 /**
  * Classe responsável por serializar e desserializar o índice invertido.
  * Os dados são salvos em formato binário para eficiência.
+ *
+ * O arquivo é gravado no formato versão 2 (ver IndexFileHeader): dicionário
+ * ordenado com codificação de prefixo e postings em diferenças + varint.
+ * Arquivos da versão 1 (tamanhos em size_t e IDs em int, sem cabeçalho)
+ * continuam podendo ser lidos.
+ *
+ * Segmentos delta ficam ao lado do arquivo base, com o nome
+ * "<arquivo>.delta.<N>", numerados a partir do último segmento já
+ * incorporado ao arquivo base (seção SECTION_SEGMENT).
  */
 class Serializer {
 public:
     /**
-     * Serializa o índice para um arquivo binário.
-     * Salva o mapeamento de documentos e o índice invertido.
+     * Serializa o índice para um arquivo binário (formato versão 2).
+     * Documentos são gravados em ordem de ID e palavras em ordem lexicográfica,
+     * de modo que o mesmo índice sempre gera o mesmo arquivo, byte a byte,
+     * independentemente da ordem interna das tabelas hash.
+     * O índice precisa estar congelado (Index::freeze). O arquivo anterior só
+     * é substituído quando o novo está completo (IndexFileWriter::finish).
      * Lança uma exceção se não conseguir abrir o arquivo.
      */
     static void serialize(const Index& index, const string& filename) {
-        ofstream file(filename, ios::binary);
-        if (!file) {
-            throw runtime_error("Não foi possível abrir o arquivo para escrita: " + filename);
-        }
-        
-        size_t numDocuments = index.idToFile.size();
-        file.write(reinterpret_cast<const char*>(&numDocuments), sizeof(numDocuments));
-        
-        for (const auto& pair : index.idToFile) {
-            int docId = pair.first;
-            file.write(reinterpret_cast<const char*>(&docId), sizeof(docId));
-            
-            const string& filenameStr = pair.second;
-            size_t filenameSize = filenameStr.size();
-            file.write(reinterpret_cast<const char*>(&filenameSize), sizeof(filenameSize));
-            file.write(filenameStr.c_str(), filenameSize);
-        }
-        
-        size_t numWords = index.invertedIndex.size();
-        file.write(reinterpret_cast<const char*>(&numWords), sizeof(numWords));
-        
-        for (const auto& pair : index.invertedIndex) {
-            const string& word = pair.first;
-            size_t wordSize = word.size();
-            file.write(reinterpret_cast<const char*>(&wordSize), sizeof(wordSize));
-            file.write(word.c_str(), wordSize);
-            
-            const set<int>& docIds = pair.second;
-            size_t numDocs = docIds.size();
-            file.write(reinterpret_cast<const char*>(&numDocs), sizeof(numDocs));
-            
-            for (int docId : docIds) {
-                file.write(reinterpret_cast<const char*>(&docId), sizeof(docId));
-            }
+        if (index.mapped) {
+            // Índice somente leitura: materializa antes de regravar
+            serialize(materialize(index), filename);
+            return;
         }
-        
-        file.close();
+        if (!index.frozen) {
+            throw runtime_error("O índice precisa ser congelado (freeze) antes da serialização");
+        }
+        ScopedTimer timer(Statistics::SERIALIZE);
+
+        // Dicionário já ordenado no congelamento: os IDs seguem a ordem alfabética
+        IndexFileWriter writer(index, filename, false);
+        const TermDictionary& words = index.frozenTerms;
+        for (uint32_t i = 0; i < words.size(); ++i) {
+            const Index::PostingRange& range = index.frozenRanges[i];
+            writer.beginWord(words.term(i), range.count);
+            writer.addPostings(PostingSpan(index.postingArena.data() + range.offset, range.count),
+                               index.frequencyArena.data() + range.offset,
+                               index.positionArena.data() + range.positionOffset,
+                               index.offsetArena.data() + range.offsetStart);
+            writer.endWord();
+        }
+        writer.finish();
     }
-    
+
     /**
-     * Desserializa o índice de um arquivo binário.
-     * Retorna um objeto Index reconstruído.
+     * Desserializa o índice de um arquivo binário (versão 1 ou 2), já com os
+     * segmentos delta aplicados.
+     * Retorna um objeto Index reconstruído inteiramente em memória.
      * Lança uma exceção se não conseguir abrir o arquivo.
      */
     static Index deserialize(const string& filename) {
+        requireSingleIndex(filename);
+        if (isVersion2(filename)) {
+            return materialize(open(filename));
+        }
+        return deserializeVersion1(filename);
+    }
+
+    /**
+     * Abre o índice para consultas.
+     * Arquivos versão 2 são mapeados em memória sem carregar o dicionário nem as
+     * postings, junto com os segmentos delta que existirem; arquivos versão 1 são
+     * desserializados por completo.
+     * Lança uma exceção se não conseguir abrir o arquivo.
+     */
+    static Index open(const string& filename) {
+        requireSingleIndex(filename);
+        if (!isVersion2(filename)) {
+            return deserializeVersion1(filename);
+        }
+
+        ScopedTimer timer(Statistics::DESERIALIZE);
+        Index index;
+        index.mapped = make_shared<MappedIndex>(filename);
+        for (uint64_t sequence = index.mapped->segmentSequence() + 1;; ++sequence) {
+            string deltaName = deltaFileName(filename, sequence);
+            if (!filesystem::exists(deltaName)) {
+                break;
+            }
+            auto delta = make_shared<MappedIndex>(deltaName);
+            if (delta->segmentSequence() != sequence) {
+                throw runtime_error("Segmento delta com numeração inválida: " + deltaName);
+            }
+            index.addDelta(move(delta));
+        }
+        return index;
+    }
+
+    /**
+     * Retorna o nome do arquivo do segmento delta de número sequence.
+     */
+    static string deltaFileName(const string& filename, uint64_t sequence) {
+        return filename + ".delta." + to_string(sequence);
+    }
+
+    /**
+     * Apaga todos os segmentos delta do índice (inclusive os que sobraram de
+     * uma compactação interrompida). Retorna quantos arquivos foram apagados.
+     */
+    static size_t removeDeltas(const string& filename) {
+        filesystem::path base(filename);
+        filesystem::path directory = base.has_parent_path() ? base.parent_path() : filesystem::path(".");
+        string prefix = base.filename().string() + ".delta.";
+        vector<filesystem::path> stale;
+        error_code ec;
+        for (const auto& entry : filesystem::directory_iterator(directory, ec)) {
+            if (entry.path().filename().string().rfind(prefix, 0) == 0) {
+                stale.push_back(entry.path());
+            }
+        }
+        for (const auto& path : stale) {
+            filesystem::remove(path, ec);
+        }
+        return stale.size();
+    }
+
+private:
+    /**
+     * Verifica se o arquivo começa com o cabeçalho da versão 2.
+     */
+    static bool isVersion2(const string& filename) {
         ifstream file(filename, ios::binary);
         if (!file) {
             throw runtime_error("Não foi possível abrir o arquivo para leitura: " + filename);
         }
-        
+        unsigned char bytes[sizeof(IndexFileHeader)];
+        file.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+        return MappedIndex::hasMagic(bytes, static_cast<size_t>(file.gcount()));
+    }
+
+    /**
+     * Copia um índice mapeado em memória (com seus segmentos delta) para um
+     * Index congelado em memória. Documentos removidos ficam de fora; é assim
+     * que os segmentos são compactados em um único arquivo.
+     */
+    static Index materialize(const Index& mappedIndex) {
+        ScopedTimer timer(Statistics::DESERIALIZE);
+        const MappedIndex& source = *mappedIndex.mapped;
+        Index index;
+
+        vector<const MappedIndex*> segments = {&source};
+        for (const auto& delta : mappedIndex.deltas) {
+            segments.push_back(delta.get());
+        }
+
+        for (const MappedIndex* segment : segments) {
+            segment->forEachDocument([&](int docId, string_view name) {
+                if (mappedIndex.isRemoved(static_cast<uint32_t>(docId))) {
+                    return;
+                }
+                string filename(name);
+                index.idToFile[docId] = filename;
+                index.fileToId[filename] = docId;
+                if (docId >= index.nextId) {
+                    index.nextId = docId + 1;
+                }
+                index.addDocumentLength(docId, segment->getDocumentLength(docId));
+            });
+        }
+        index.fileMetadata = mappedIndex.getFileMetadata();
+        index.segmentSequence = mappedIndex.getSegmentSequence();
+        index.positional = source.hasPositions();
+        index.withOffsets = source.hasOffsets();
+
+        vector<uint32_t> positions;
+        vector<uint32_t> offsets;
+        if (segments.size() == 1) {
+            // As palavras chegam em ordem alfabética, como o congelamento as deixa
+            index.frozenTerms.reserve(source.wordCount(), 0);
+            index.frozenRanges.reserve(source.wordCount());
+            source.forEachWord([&](const string& word, const MappedIndex::WordInfo& info) {
+                index.frozenTerms.intern(word);
+                index.frozenRanges.push_back({index.postingArena.size(), static_cast<uint32_t>(info.docFreq),
+                                              index.positionArena.size(), index.offsetArena.size()});
+                source.forEachPositionedPosting(info, [&](int docId, uint32_t frequency,
+                                                          const EncodedPositions& encoded) {
+                    index.postingArena.push_back(static_cast<uint32_t>(docId));
+                    index.frequencyArena.push_back(frequency);
+                    if (index.positional) {
+                        encoded.decode(frequency, positions);
+                        index.positionArena.insert(index.positionArena.end(), positions.begin(), positions.end());
+                    }
+                    if (index.withOffsets) {
+                        encoded.decodeOffsets(frequency, offsets);
+                        index.offsetArena.insert(index.offsetArena.end(), offsets.begin(), offsets.end());
+                    }
+                });
+            });
+            index.frozen = true;
+            return index;
+        }
+
+        // Com deltas, as postings de cada palavra são reunidas de todos os segmentos
+        for (const MappedIndex* segment : segments) {
+            segment->forEachWord([&](const string& word, const MappedIndex::WordInfo& info) {
+                Index::PostingBuilder* postings = nullptr;
+                segment->forEachPositionedPosting(info, [&](int docId, uint32_t frequency,
+                                                            const EncodedPositions& encoded) {
+                    if (mappedIndex.isRemoved(static_cast<uint32_t>(docId))) {
+                        return;
+                    }
+                    if (postings == nullptr) {
+                        postings = &index.invertedIndex[word];
+                    }
+                    if (index.withOffsets) {
+                        encoded.decodeOffsets(frequency, offsets);
+                        postings->offsets.insert(postings->offsets.end(), offsets.begin(), offsets.end());
+                    }
+                    if (!index.positional) {
+                        postings->add(static_cast<uint32_t>(docId), frequency);
+                        return;
+                    }
+                    encoded.decode(frequency, positions);
+                    for (uint32_t position : positions) {
+                        postings->addAt(static_cast<uint32_t>(docId), position);
+                    }
+                });
+            });
+        }
+        index.freeze();
+        return index;
+    }
+
+    /**
+     * Lança uma exceção se o arquivo for um manifesto de shards, que é aberto
+     * por ShardedIndex::open e não tem dicionário nem postings próprios.
+     */
+    static void requireSingleIndex(const string& filename) {
+        if (ShardManifest::isManifest(filename)) {
+            throw runtime_error("O índice está dividido em shards (construir --shards): " + filename);
+        }
+    }
+
+    /**
+     * Desserializa um arquivo no formato versão 1.
+     */
+    static Index deserializeVersion1(const string& filename) {
+        ScopedTimer timer(Statistics::DESERIALIZE);
+        ifstream file(filename, ios::binary);
+        if (!file) {
+            throw runtime_error("Não foi possível abrir o arquivo para leitura: " + filename);
+        }
+
         Index index;
-        
+
         size_t numDocuments;
         file.read(reinterpret_cast<char*>(&numDocuments), sizeof(numDocuments));
-        
+
         for (size_t i = 0; i < numDocuments; ++i) {
             int docId;
             file.read(reinterpret_cast<char*>(&docId), sizeof(docId));
-            
+
             size_t filenameSize;
             file.read(reinterpret_cast<char*>(&filenameSize), sizeof(filenameSize));
             string filename(filenameSize, ' ');
             file.read(&filename[0], filenameSize);
-            
+
             index.idToFile[docId] = filename;
             index.fileToId[filename] = docId;
-            
+
             if (docId >= index.nextId) {
                 index.nextId = docId + 1;
             }
         }
-        
+
         size_t numWords;
         file.read(reinterpret_cast<char*>(&numWords), sizeof(numWords));
-        
+
         for (size_t i = 0; i < numWords; ++i) {
             size_t wordSize;
             file.read(reinterpret_cast<char*>(&wordSize), sizeof(wordSize));
             string word(wordSize, ' ');
             file.read(&word[0], wordSize);
-            
+
             size_t numDocs;
             file.read(reinterpret_cast<char*>(&numDocs), sizeof(numDocs));
-            
-            set<int> docIds;
+
+            // A versão 1 não guarda frequências: cada documento conta uma vez
+            Index::PostingBuilder& postings = index.invertedIndex[word];
+            postings.docIds.reserve(numDocs);
+            postings.frequencies.reserve(numDocs);
             for (size_t j = 0; j < numDocs; ++j) {
                 int docId;
                 file.read(reinterpret_cast<char*>(&docId), sizeof(docId));
-                docIds.insert(docId);
+                postings.add(static_cast<uint32_t>(docId));
             }
-            
-            index.invertedIndex[word] = docIds;
         }
-        
+
         file.close();
+        index.freeze();
         return index;
     }
 };
 
-#endif
\ No newline at end of file
+#endif
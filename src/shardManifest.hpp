@@ -0,0 +1,132 @@
+#ifndef SHARDMANIFEST_HPP
+#define SHARDMANIFEST_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Shard de um índice dividido: arquivo de índice versão 2 com os documentos
+ * de IDs firstId a firstId + documents - 1.
+ */
+struct ShardEntry {
+    string filename;
+    uint32_t firstId;
+    uint32_t documents;
+};
+
+/**
+ * Manifesto de um índice dividido em shards (construir --shards N). Fica no
+ * lugar do index.dat e lista os shards, cada um um índice versão 2 completo,
+ * com dicionário e postings próprios, sobre uma faixa contígua de IDs de
+ * documentos. As faixas seguem a ordem dos shards, então concatenar os
+ * resultados dos shards mantém a ordem global dos IDs.
+ *
+ * Formato (texto):
+ *   IDXS 1
+ *   <arquivo do shard> <primeiro ID> <quantidade de documentos>
+ *   ...
+ * Os nomes dos arquivos são relativos ao diretório do manifesto.
+ */
+class ShardManifest {
+public:
+    static constexpr const char* MAGIC = "IDXS";
+    static constexpr uint32_t VERSION = 1;
+
+    vector<ShardEntry> shards;
+
+    /**
+     * Indica se o arquivo é um manifesto de shards.
+     */
+    static bool isManifest(const string& filename) {
+        ifstream file(filename, ios::binary);
+        char magic[4] = {};
+        file.read(magic, sizeof(magic));
+        return file.gcount() == sizeof(magic) && string(magic, sizeof(magic)) == MAGIC;
+    }
+
+    /**
+     * Lê o manifesto.
+     * Lança uma exceção se o arquivo não puder ser lido ou não for um manifesto válido.
+     */
+    static ShardManifest read(const string& filename) {
+        ifstream file(filename);
+        if (!file) {
+            throw runtime_error("Não foi possível abrir o arquivo para leitura: " + filename);
+        }
+        string magic;
+        uint32_t version = 0;
+        if (!(file >> magic >> version) || magic != MAGIC || version != VERSION) {
+            throw runtime_error("Manifesto de shards inválido: " + filename);
+        }
+        ShardManifest manifest;
+        ShardEntry entry;
+        while (file >> entry.filename >> entry.firstId >> entry.documents) {
+            manifest.shards.push_back(entry);
+        }
+        if (!file.eof() || manifest.shards.empty()) {
+            throw runtime_error("Manifesto de shards inválido: " + filename);
+        }
+        return manifest;
+    }
+
+    /**
+     * Grava o manifesto em um arquivo temporário e o renomeia, para que uma
+     * busca nunca veja um manifesto pela metade.
+     * Lança uma exceção se não conseguir gravar.
+     */
+    void write(const string& filename) const {
+        string temporary = filename + ".tmp";
+        {
+            ofstream file(temporary);
+            if (!file) {
+                throw runtime_error("Não foi possível abrir o arquivo para escrita: " + temporary);
+            }
+            file << MAGIC << " " << VERSION << "\n";
+            for (const ShardEntry& shard : shards) {
+                file << shard.filename << " " << shard.firstId << " " << shard.documents << "\n";
+            }
+            file.close();
+            if (!file) {
+                throw runtime_error("Erro ao gravar o arquivo: " + temporary);
+            }
+        }
+        filesystem::rename(temporary, filename);
+    }
+
+    /**
+     * Nome do arquivo do shard de número number (a partir de 1), no mesmo
+     * diretório do manifesto.
+     */
+    static string shardFileName(const string& manifestFile, size_t number) {
+        return filesystem::path(manifestFile).filename().string() + ".shard." + to_string(number);
+    }
+
+    /**
+     * Caminho do arquivo de um shard, resolvido a partir do diretório do manifesto.
+     */
+    static string pathOf(const string& manifestFile, const ShardEntry& shard) {
+        return (filesystem::path(manifestFile).parent_path() / shard.filename).string();
+    }
+
+    /**
+     * Caminhos dos shards do manifesto, ou nenhum se o arquivo não for um manifesto.
+     */
+    static vector<string> shardPaths(const string& manifestFile) {
+        vector<string> paths;
+        if (isManifest(manifestFile)) {
+            for (const ShardEntry& shard : read(manifestFile).shards) {
+                paths.push_back(pathOf(manifestFile, shard));
+            }
+        }
+        return paths;
+    }
+};
+
+#endif
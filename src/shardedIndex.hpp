@@ -0,0 +1,175 @@
+#ifndef SHARDEDINDEX_HPP
+#define SHARDEDINDEX_HPP
+
+#include "index.hpp"
+#include "indexer.hpp"
+#include "serializer.hpp"
+#include "shardManifest.hpp"
+#include "spimiBuilder.hpp"
+#include "textProcessor.hpp"
+#include "threadPool.hpp"
+#include <string>
+#include <vector>
+#include <future>
+#include <filesystem>
+#include <algorithm>
+#include <system_error>
+
+using namespace std;
+
+/**
+ * Construção e abertura de um índice dividido em shards (ver ShardManifest).
+ * Cada shard é construído, gravado e aberto de forma independente; as buscas
+ * sobre todos eles ficam com o SearchEngine, que consulta os shards em
+ * paralelo e junta os resultados.
+ */
+class ShardedIndex {
+public:
+    /**
+     * Divide os arquivos .txt do diretório, na ordem do percurso (a mesma dos
+     * IDs de um índice único), em até numShards faixas contíguas com
+     * quantidades parecidas de bytes, constrói cada shard e grava os arquivos
+     * e o manifesto. Até threads shards são construídos ao mesmo tempo; as
+     * threads que sobram são divididas entre os Indexers dos shards, assim como
+     * readBudget. Com memoryBudget (em bytes; 0 é sem limite), cada shard é
+     * construído pelo SpimiBuilder com a sua parte do orçamento. Shards e
+     * segmentos delta de uma construção anterior que não
+     * fazem parte do novo índice são removidos.
+     * Retorna o manifesto gravado.
+     * Lança uma exceção se algum shard não puder ser construído ou gravado.
+     */
+    static ShardManifest build(const string& directoryPath, const string& manifestFile, unsigned numShards,
+                               unsigned threads, bool positions, bool offsets, size_t readBudget,
+                               size_t memoryBudget, TextProcessor& textProcessor) {
+        vector<string> previous = ShardManifest::shardPaths(manifestFile);
+        vector<string> files = Indexer::listFiles(directoryPath);
+        vector<size_t> starts = partition(files, numShards);
+
+        ShardManifest manifest;
+        for (size_t k = 0; k < starts.size(); ++k) {
+            size_t end = k + 1 < starts.size() ? starts[k + 1] : files.size();
+            manifest.shards.push_back({ShardManifest::shardFileName(manifestFile, k + 1),
+                                       static_cast<uint32_t>(starts[k] + 1),
+                                       static_cast<uint32_t>(end - starts[k])});
+        }
+
+        unsigned workers = static_cast<unsigned>(min<size_t>(max(threads, 1u), manifest.shards.size()));
+        unsigned indexerThreads = max(1u, threads / workers);
+        size_t shardReadBudget = max(Indexer::MIN_CHUNK_SIZE, readBudget / workers);
+        size_t shardMemoryBudget = memoryBudget / workers;
+        {
+            ThreadPool pool(workers);
+            vector<future<void>> pending;
+            for (const ShardEntry& shard : manifest.shards) {
+                pending.push_back(pool.submit([&, shard]() {
+                    Index index;
+                    if (positions) {
+                        index.enablePositions();
+                    }
+                    if (offsets) {
+                        index.enableOffsets();
+                    }
+                    index.setFirstDocumentId(static_cast<int>(shard.firstId));
+                    auto first = files.begin() + (shard.firstId - 1);
+                    vector<string> shardFiles(first, first + shard.documents);
+                    string path = ShardManifest::pathOf(manifestFile, shard);
+                    if (memoryBudget > 0) {
+                        SpimiBuilder builder(index, textProcessor, indexerThreads, shardReadBudget, shardMemoryBudget);
+                        builder.build(shardFiles, path);
+                    } else {
+                        Indexer indexer(index, textProcessor, indexerThreads, shardReadBudget);
+                        indexer.indexFiles(shardFiles);
+                        index.freeze();
+                        Serializer::serialize(index, path);
+                    }
+                    Serializer::removeDeltas(path);
+                }));
+            }
+            // Espera todos os shards antes de propagar um erro (as tarefas usam variáveis locais)
+            for (future<void>& shard : pending) {
+                shard.wait();
+            }
+            for (future<void>& shard : pending) {
+                shard.get();
+            }
+        }
+
+        manifest.write(manifestFile);
+        Serializer::removeDeltas(manifestFile);
+        for (const string& path : previous) {
+            bool kept = any_of(manifest.shards.begin(), manifest.shards.end(), [&](const ShardEntry& shard) {
+                return ShardManifest::pathOf(manifestFile, shard) == path;
+            });
+            if (!kept) {
+                removeShard(path);
+            }
+        }
+        return manifest;
+    }
+
+    /**
+     * Abre todos os shards do manifesto para consultas (Serializer::open), na
+     * ordem do manifesto.
+     * Lança uma exceção se o manifesto ou algum shard não puder ser aberto.
+     */
+    static vector<Index> open(const string& manifestFile) {
+        ShardManifest manifest = ShardManifest::read(manifestFile);
+        vector<Index> shards;
+        shards.reserve(manifest.shards.size());
+        for (const ShardEntry& shard : manifest.shards) {
+            shards.push_back(Serializer::open(ShardManifest::pathOf(manifestFile, shard)));
+        }
+        return shards;
+    }
+
+    /**
+     * Remove os arquivos dos shards informados (ver ShardManifest::shardPaths)
+     * e seus segmentos delta. Usado quando um índice único substitui um
+     * índice dividido.
+     */
+    static void removeShards(const vector<string>& shardPaths) {
+        for (const string& path : shardPaths) {
+            removeShard(path);
+        }
+    }
+
+private:
+    /**
+     * Retorna a posição do primeiro arquivo de cada shard: faixas contíguas,
+     * nenhuma vazia, fechadas assim que a soma dos tamanhos atinge a parte
+     * proporcional do total. Com menos arquivos que numShards, há um shard
+     * por arquivo (e um shard vazio para um diretório sem arquivos).
+     */
+    static vector<size_t> partition(const vector<string>& files, unsigned numShards) {
+        size_t count = max<size_t>(1, min<size_t>(numShards, files.size()));
+        vector<uintmax_t> sizes(files.size(), 0);
+        uintmax_t total = 0;
+        for (size_t i = 0; i < files.size(); ++i) {
+            error_code ec;
+            uintmax_t size = filesystem::file_size(files[i], ec);
+            sizes[i] = ec ? 0 : size;
+            total += sizes[i];
+        }
+
+        vector<size_t> starts = {0};
+        uintmax_t accumulated = 0;
+        for (size_t i = 0; i + 1 < files.size() && starts.size() < count; ++i) {
+            accumulated += sizes[i];
+            size_t remainingFiles = files.size() - (i + 1);
+            size_t remainingShards = count - starts.size();
+            bool reachedShare = accumulated * count >= total * starts.size();
+            if (remainingFiles == remainingShards || (reachedShare && remainingFiles >= remainingShards)) {
+                starts.push_back(i + 1);
+            }
+        }
+        return starts;
+    }
+
+    static void removeShard(const string& path) {
+        error_code ec;
+        filesystem::remove(path, ec);
+        Serializer::removeDeltas(path);
+    }
+};
+
+#endif
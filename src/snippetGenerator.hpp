@@ -0,0 +1,205 @@
+#ifndef SNIPPETGENERATOR_HPP
+#define SNIPPETGENERATOR_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "textProcessor.hpp"
+#include "statistics.hpp"
+
+using namespace std;
+
+/**
+ * Gera os trechos de um documento mostrados nos resultados (buscar --trechos).
+ *
+ * Os trechos saem dos deslocamentos em bytes das primeiras ocorrências das
+ * palavras da consulta, guardados no índice (construir --trechos): cada trecho
+ * é uma janela de alguns bytes em volta de uma ocorrência, lida do arquivo com
+ * pread, sem ler o documento inteiro. As bordas da janela são ajustadas para
+ * não cortar palavras (nem caracteres UTF-8), os espaços são reduzidos a um só
+ * e as palavras da consulta ficam destacadas entre **.
+ */
+class SnippetGenerator {
+public:
+    // Bytes lidos antes e depois da ocorrência que origina um trecho
+    static constexpr size_t BEFORE = 60;
+    static constexpr size_t AFTER = 160;
+    // Trechos por documento; limita a leitura a MAX_SNIPPETS * (BEFORE + AFTER) bytes
+    static constexpr size_t MAX_SNIPPETS = 2;
+
+    explicit SnippetGenerator(const TextProcessor& textProcessor) : textProcessor(textProcessor) {}
+
+    /**
+     * Retorna até MAX_SNIPPETS trechos do arquivo, na ordem do texto, com as
+     * palavras normalizadas de words destacadas. As janelas são escolhidas
+     * pelas ocorrências mais próximas do início; uma ocorrência que já está
+     * em uma janela não abre outra. Retorna uma lista vazia se não houver
+     * deslocamentos ou se o arquivo não puder ser lido (por exemplo, se foi
+     * removido depois da indexação).
+     */
+    vector<string> generate(const string& filename, vector<uint32_t> offsets, const vector<string>& words) const {
+        vector<string> snippets;
+        if (offsets.empty()) {
+            return snippets;
+        }
+        ScopedTimer timer(Statistics::SNIPPETS);
+        sort(offsets.begin(), offsets.end());
+        offsets.erase(unique(offsets.begin(), offsets.end()), offsets.end());
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return snippets;
+        }
+        string buffer;
+        uint64_t windowEnd = 0;
+        for (uint32_t offset : offsets) {
+            if (snippets.size() == MAX_SNIPPETS) {
+                break;
+            }
+            // A ocorrência precisa caber na janela anterior com folga para a palavra
+            if (!snippets.empty() && offset + WORD_MARGIN <= windowEnd) {
+                continue;
+            }
+            uint64_t start = offset > BEFORE ? offset - BEFORE : 0;
+            windowEnd = static_cast<uint64_t>(offset) + AFTER;
+            buffer.resize(windowEnd - start);
+            ssize_t received = readAt(fd, buffer, start);
+            if (received <= 0) {
+                break;
+            }
+            Statistics::add(Statistics::SNIPPET_BYTES, static_cast<uint64_t>(received));
+            bool atEnd = static_cast<size_t>(received) < buffer.size();
+            string snippet = format(string_view(buffer.data(), static_cast<size_t>(received)), start > 0, !atEnd,
+                                    words);
+            if (!snippet.empty()) {
+                snippets.push_back(move(snippet));
+            }
+        }
+        ::close(fd);
+        return snippets;
+    }
+
+private:
+    // Bytes que uma ocorrência precisa ter até o fim da janela anterior para
+    // ser considerada dentro dela
+    static constexpr size_t WORD_MARGIN = 32;
+
+    // Processador de texto com as stop words carregadas (o mesmo da indexação)
+    const TextProcessor& textProcessor;
+
+    /**
+     * Lê buffer.size() bytes do arquivo a partir de start, ou menos no fim do
+     * arquivo. Retorna a quantidade lida, ou -1 em caso de erro.
+     */
+    static ssize_t readAt(int fd, string& buffer, uint64_t start) {
+        size_t total = 0;
+        while (total < buffer.size()) {
+            ssize_t received = ::pread(fd, &buffer[total], buffer.size() - total, static_cast<off_t>(start + total));
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            if (received == 0) {
+                break;
+            }
+            total += static_cast<size_t>(received);
+        }
+        return static_cast<ssize_t>(total);
+    }
+
+    /**
+     * Indica se o byte é uma pontuação ASCII, que fica fora do destaque.
+     */
+    static bool isPunctuation(unsigned char c) {
+        return c < 0x80 && !isalnum(c);
+    }
+
+    /**
+     * Monta o trecho a partir dos bytes da janela. Com cutStart ou cutEnd, a
+     * janela começa ou termina no meio do texto: os bytes até o primeiro
+     * separador (ou depois do último) são descartados, pois podem ser parte de
+     * uma palavra, e o trecho ganha "..." nesse lado.
+     */
+    string format(string_view text, bool cutStart, bool cutEnd, const vector<string>& words) const {
+        if (cutStart) {
+            size_t first = 0;
+            while (first < text.size() && !TextProcessor::isSeparator(static_cast<unsigned char>(text[first]))) {
+                ++first;
+            }
+            text.remove_prefix(first);
+        }
+        if (cutEnd) {
+            size_t last = text.size();
+            while (last > 0 && !TextProcessor::isSeparator(static_cast<unsigned char>(text[last - 1]))) {
+                --last;
+            }
+            text = text.substr(0, last);
+        }
+
+        // Intervalos [início, fim) das palavras da consulta, sem as pontuações coladas
+        vector<pair<size_t, size_t>> highlights;
+        textProcessor.forEachTokenSpan(text, [&](const string& token, uint32_t, size_t begin, size_t end) {
+            if (find(words.begin(), words.end(), token) == words.end()) {
+                return;
+            }
+            while (begin < end && isPunctuation(static_cast<unsigned char>(text[begin]))) {
+                ++begin;
+            }
+            while (end > begin && isPunctuation(static_cast<unsigned char>(text[end - 1]))) {
+                --end;
+            }
+            if (begin < end) {
+                highlights.emplace_back(begin, end);
+            }
+        });
+
+        string snippet;
+        snippet.reserve(text.size() + 4 * highlights.size() + 6);
+        size_t next = 0;
+        bool space = true;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (next < highlights.size() && highlights[next].first == i) {
+                snippet += "**";
+                space = false;
+            }
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (isspace(c)) {
+                if (!space) {
+                    snippet += ' ';
+                    space = true;
+                }
+            } else {
+                snippet += static_cast<char>(c);
+                space = false;
+            }
+            if (next < highlights.size() && highlights[next].second == i + 1) {
+                snippet += "**";
+                ++next;
+            }
+        }
+        while (!snippet.empty() && snippet.back() == ' ') {
+            snippet.pop_back();
+        }
+        if (snippet.empty()) {
+            return snippet;
+        }
+        if (cutStart) {
+            snippet.insert(0, "...");
+        }
+        if (cutEnd) {
+            snippet += "...";
+        }
+        return snippet;
+    }
+};
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef SPIMIBUILDER_HPP
+#define SPIMIBUILDER_HPP
+
+#include "index.hpp"
+#include "indexer.hpp"
+#include "indexFileWriter.hpp"
+#include "textProcessor.hpp"
+#include "varByte.hpp"
+#include "positionalList.hpp"
+#include "statistics.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <cstdint>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+/**
+ * Construção do índice com orçamento de memória (construir --memoria), no
+ * estilo SPIMI (single-pass in-memory indexing).
+ *
+ * Os arquivos são indexados em lotes, pelo Indexer, no mesmo Index. Quando o
+ * dicionário e as listas em construção (Index::buildingMemory) se aproximam
+ * do limite, eles são gravados em uma parte ("<arquivo>.parte.N"): palavras
+ * em ordem alfabética, cada uma com suas postings, frequências, posições e
+ * deslocamentos. A memória é liberada e a indexação continua; os documentos
+ * (nomes, tamanhos e metadados) ficam em memória. No final, as partes são
+ * intercaladas com um heap (k-way merge) e as listas de cada palavra, que
+ * estão em ordem de ID de uma parte para a seguinte, vão direto para o
+ * IndexFileWriter, que descarrega postings, posições e deslocamentos em
+ * arquivos temporários. O "index.dat" gerado é o mesmo da construção em
+ * memória. Se tudo couber no limite, nenhuma parte é gravada.
+ *
+ * O tamanho de cada lote é calculado pela memória medida por byte de texto
+ * nos lotes anteriores, para que um lote ocupe no máximo um quarto do limite;
+ * um documento sozinho, porém, sempre cabe inteiro em uma parte.
+ */
+class SpimiBuilder {
+public:
+    // Memória mínima das listas em construção, qualquer que seja o orçamento
+    static constexpr size_t MIN_LIMIT = 1 << 20;
+
+    /**
+     * Prepara a construção no índice informado (vazio, com as posições e os
+     * deslocamentos já habilitados, se desejados). Do orçamento memoryBudget
+     * saem os buffers de leitura (readBudget) e os documentos já indexados;
+     * as listas em construção ocupam até metade do que sobra, e a outra metade
+     * fica para as cópias parciais das threads do Indexer, o crescimento dos
+     * vetores e, na intercalação, os buffers das partes, os resumos de blocos
+     * e o dicionário do arquivo final.
+     */
+    SpimiBuilder(Index& idx, TextProcessor& tp, unsigned threads, size_t readBytes, size_t memoryBudget)
+        : index(idx), textProcessor(tp), numThreads(max(threads, 1u)), readBudget(readBytes), budget(memoryBudget) {}
+
+    /**
+     * Indexa os arquivos, na ordem informada (a dos IDs), e grava o índice em
+     * filename. As partes e os arquivos temporários são apagados no final,
+     * mesmo em caso de erro.
+     * Retorna a quantidade de palavras do índice.
+     * Lança uma exceção se algum arquivo não puder ser gravado ou lido.
+     */
+    size_t build(const vector<string>& files, const string& filename) {
+        TemporaryFiles runs;
+        Indexer indexer(index, textProcessor, numThreads, readBudget);
+
+        uint64_t textBytes = 0;
+        double bytesPerText = 0;
+        size_t next = 0;
+        while (next < files.size()) {
+            // Cada lote ocupa no máximo um quarto do limite, dividido entre as
+            // threads, pois cada uma monta um índice parcial antes da união
+            size_t limit = postingsLimit();
+            uint64_t target = bytesPerText > 0 ? static_cast<uint64_t>(limit / 4 / numThreads / bytesPerText)
+                                               : limit / 16 / numThreads;
+            vector<string> batch;
+            uint64_t batchBytes = 0;
+            while (next < files.size() && (batch.empty() || batchBytes < target)) {
+                error_code ec;
+                uintmax_t size = filesystem::file_size(files[next], ec);
+                batchBytes += ec ? 0 : size;
+                batch.push_back(files[next++]);
+            }
+            indexer.indexFiles(batch);
+            releaseFreeMemory();
+            textBytes += batchBytes;
+
+            size_t used = index.buildingMemory();
+            if (textBytes > 0) {
+                bytesPerText = static_cast<double>(used) / textBytes;
+            }
+            if (used > limit - limit / 4 && next < files.size()) {
+                runs.paths.push_back(filename + ".parte." + to_string(runs.paths.size() + 1));
+                writeRun(runs.paths.back());
+                releaseFreeMemory();
+                textBytes = 0;
+            }
+        }
+
+        if (runs.paths.empty()) {
+            // Tudo coube no limite: as listas vão direto para o arquivo
+            ScopedTimer timer(Statistics::SERIALIZE);
+            IndexFileWriter writer(index, filename, true);
+            index.drainPostings([&](string_view word, const Index::PostingBuilder& postings) {
+                writer.beginWord(word, postings.docIds.size());
+                writer.addPostings(PostingSpan(postings.docIds), postings.frequencies.data(),
+                                   postings.positions.data(), postings.offsets.data());
+                writer.endWord();
+            });
+            writer.finish();
+            return writer.size();
+        }
+        runs.paths.push_back(filename + ".parte." + to_string(runs.paths.size() + 1));
+        writeRun(runs.paths.back());
+        return merge(runs.paths, filename);
+    }
+
+private:
+    // Bytes de uma parte acumulados em memória antes de irem para o arquivo
+    static constexpr size_t WRITE_CHUNK = 1 << 20;
+
+    /**
+     * Arquivos apagados quando o objeto sai de escopo (partes da construção).
+     */
+    struct TemporaryFiles {
+        vector<string> paths;
+
+        ~TemporaryFiles() {
+            for (const string& path : paths) {
+                error_code ec;
+                filesystem::remove(path, ec);
+            }
+        }
+    };
+
+    /**
+     * Leitura sequencial de uma parte, com um buffer de tamanho fixo.
+     */
+    class RunReader {
+    public:
+        // Palavra atual e a quantidade de documentos dela nesta parte
+        string word;
+        size_t count = 0;
+
+        RunReader(const string& path, size_t bufferSize, bool positional, bool withOffsets)
+            : file(path, ios::binary), buffer(max<size_t>(bufferSize, 16)), position(0), end(0),
+              positional(positional), withOffsets(withOffsets) {
+            if (!file) {
+                throw runtime_error("Não foi possível abrir a parte da construção: " + path);
+            }
+        }
+
+        /**
+         * Avança para a próxima palavra. Retorna false no fim da parte.
+         */
+        bool next() {
+            if (!ensure(1)) {
+                return false;
+            }
+            size_t length = static_cast<size_t>(varint());
+            if (!ensure(length)) {
+                throw runtime_error("Parte da construção truncada");
+            }
+            word.assign(reinterpret_cast<const char*>(buffer.data() + position), length);
+            position += length;
+            count = static_cast<size_t>(varint());
+            return true;
+        }
+
+        /**
+         * Lê as postings da palavra atual em postings (que é esvaziado antes).
+         */
+        void readPostings(Index::PostingBuilder& postings) {
+            postings.docIds.clear();
+            postings.frequencies.clear();
+            postings.positions.clear();
+            postings.offsets.clear();
+            uint32_t docId = 0;
+            for (size_t i = 0; i < count; ++i) {
+                docId += static_cast<uint32_t>(varint());
+                uint32_t frequency = static_cast<uint32_t>(varint());
+                postings.docIds.push_back(docId);
+                postings.frequencies.push_back(frequency);
+                if (positional) {
+                    uint32_t position = 0;
+                    for (uint32_t k = 0; k < frequency; ++k) {
+                        position += static_cast<uint32_t>(varint());
+                        postings.positions.push_back(position);
+                    }
+                }
+                if (withOffsets) {
+                    uint32_t offset = 0;
+                    for (uint32_t k = OccurrenceOffsets::countFor(frequency); k > 0; --k) {
+                        offset += static_cast<uint32_t>(varint());
+                        postings.offsets.push_back(offset);
+                    }
+                }
+            }
+        }
+
+    private:
+        ifstream file;
+        vector<unsigned char> buffer;
+        // Bytes ainda não lidos: [position, end)
+        size_t position;
+        size_t end;
+        bool positional;
+        bool withOffsets;
+
+        /**
+         * Garante pelo menos count bytes não lidos no buffer (menos no fim do
+         * arquivo), lendo mais do arquivo se preciso. Retorna false se não há.
+         */
+        bool ensure(size_t count) {
+            if (end - position >= count) {
+                return true;
+            }
+            copy(buffer.begin() + position, buffer.begin() + end, buffer.begin());
+            end -= position;
+            position = 0;
+            if (count > buffer.size()) {
+                buffer.resize(count);
+            }
+            if (file) {
+                file.read(reinterpret_cast<char*>(buffer.data() + end), static_cast<streamsize>(buffer.size() - end));
+                end += static_cast<size_t>(file.gcount());
+            }
+            return end - position >= count;
+        }
+
+        /**
+         * Lê um varint.
+         */
+        uint64_t varint() {
+            ensure(10);
+            const unsigned char* p = buffer.data() + position;
+            uint64_t value = VarByte::decode(p, buffer.data() + end);
+            position = static_cast<size_t>(p - buffer.data());
+            return value;
+        }
+    };
+
+    // Índice construído (documentos e listas em construção)
+    Index& index;
+    TextProcessor& textProcessor;
+    unsigned numThreads;
+    size_t readBudget;
+    // Orçamento de memória da construção
+    size_t budget;
+
+    /**
+     * Memória máxima das listas em construção, recalculada a cada lote, pois
+     * a dos documentos cresce durante a indexação.
+     */
+    size_t postingsLimit() const {
+        size_t fixed = readBudget;
+        for (const MemoryItem& item : index.memoryUsage()) {
+            if (item.key != "construcao") {
+                fixed += item.bytes;
+            }
+        }
+        return max(MIN_LIMIT, budget > fixed ? (budget - fixed) / 2 : 0);
+    }
+
+    /**
+     * Devolve ao sistema a memória livre do alocador (com a glibc, a das
+     * arenas das threads não volta sozinha), para que os índices parciais e
+     * as listas já gravadas não continuem ocupando memória residente.
+     */
+    static void releaseFreeMemory() {
+#ifdef __GLIBC__
+        malloc_trim(0);
+#endif
+    }
+
+    /**
+     * Grava as listas em construção em uma parte e as descarta do índice.
+     * Lança uma exceção se a parte não puder ser gravada.
+     */
+    void writeRun(const string& path) {
+        ScopedTimer timer(Statistics::RUN_WRITE);
+        ofstream file(path, ios::binary);
+        if (!file) {
+            throw runtime_error("Não foi possível criar a parte da construção: " + path);
+        }
+        bool positional = index.hasPositions();
+        bool withOffsets = index.hasOffsets();
+        string chunk;
+        index.drainPostings([&](string_view word, const Index::PostingBuilder& postings) {
+            VarByte::encode(word.size(), chunk);
+            chunk.append(word);
+            VarByte::encode(postings.docIds.size(), chunk);
+            const uint32_t* positions = postings.positions.data();
+            const uint32_t* offsets = postings.offsets.data();
+            uint32_t last = 0;
+            for (size_t i = 0; i < postings.docIds.size(); ++i) {
+                VarByte::encode(postings.docIds[i] - last, chunk);
+                VarByte::encode(postings.frequencies[i], chunk);
+                last = postings.docIds[i];
+                if (positional) {
+                    uint32_t lastPosition = 0;
+                    for (uint32_t k = 0; k < postings.frequencies[i]; ++k) {
+                        VarByte::encode(*positions - lastPosition, chunk);
+                        lastPosition = *positions++;
+                    }
+                }
+                if (withOffsets) {
+                    uint32_t lastOffset = 0;
+                    for (uint32_t k = OccurrenceOffsets::countFor(postings.frequencies[i]); k > 0; --k) {
+                        VarByte::encode(*offsets - lastOffset, chunk);
+                        lastOffset = *offsets++;
+                    }
+                }
+            }
+            if (chunk.size() >= WRITE_CHUNK) {
+                file.write(chunk.data(), static_cast<streamsize>(chunk.size()));
+                chunk.clear();
+            }
+        });
+        file.write(chunk.data(), static_cast<streamsize>(chunk.size()));
+        file.close();
+        if (!file) {
+            throw runtime_error("Erro ao gravar a parte da construção: " + path);
+        }
+        Statistics::add(Statistics::RUNS, 1);
+    }
+
+    /**
+     * Intercala as partes, em ordem alfabética das palavras, e grava o índice
+     * em filename. As listas de uma palavra são lidas das partes em ordem
+     * (as partes seguem a ordem dos IDs). Retorna a quantidade de palavras.
+     */
+    size_t merge(const vector<string>& paths, const string& filename) {
+        ScopedTimer timer(Statistics::RUN_MERGE);
+        // Os buffers de leitura das partes somam no máximo um quarto do limite
+        size_t bufferSize = min<size_t>(1 << 20, max<size_t>(4 << 10, postingsLimit() / 4 / paths.size()));
+        vector<RunReader> readers;
+        readers.reserve(paths.size());
+        using Entry = pair<string, size_t>;
+        priority_queue<Entry, vector<Entry>, greater<Entry>> heap;
+        for (size_t r = 0; r < paths.size(); ++r) {
+            readers.emplace_back(paths[r], bufferSize, index.hasPositions(), index.hasOffsets());
+            if (readers[r].next()) {
+                heap.emplace(readers[r].word, r);
+            }
+        }
+
+        IndexFileWriter writer(index, filename, true);
+        Index::PostingBuilder postings;
+        vector<size_t> same;
+        while (!heap.empty()) {
+            // Em empates o heap entrega as partes em ordem, então os IDs crescem
+            string word = heap.top().first;
+            same.clear();
+            size_t count = 0;
+            while (!heap.empty() && heap.top().first == word) {
+                same.push_back(heap.top().second);
+                count += readers[heap.top().second].count;
+                heap.pop();
+            }
+            writer.beginWord(word, count);
+            for (size_t r : same) {
+                readers[r].readPostings(postings);
+                writer.addPostings(PostingSpan(postings.docIds), postings.frequencies.data(),
+                                   postings.positions.data(), postings.offsets.data());
+                if (readers[r].next()) {
+                    heap.emplace(readers[r].word, r);
+                }
+            }
+            writer.endWord();
+        }
+        writer.finish();
+        return writer.size();
+    }
+};
+
+#endif
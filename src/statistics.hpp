@@ -0,0 +1,388 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <sys/resource.h>
+
+using namespace std;
+
+/**
+ * Parte da memória de uma estrutura, para o relatório de estatísticas.
+ * key é o nome no JSON; label, o nome no texto.
+ */
+struct MemoryItem {
+    string key;
+    string label;
+    size_t bytes;
+};
+
+/**
+ * Instrumentação embutida (opção --stats): tempo e quantidade de chamadas de
+ * cada fase, contadores e memória. Os totais são globais, em atômicos
+ * relaxados, e podem ser somados por várias threads; em execuções paralelas o
+ * tempo de uma fase é a soma das threads, não o tempo de parede.
+ *
+ * Desligada (o padrão), cada ponto instrumentado custa um teste de um bool que
+ * não muda durante a execução; o relógio só é lido com a instrumentação ligada.
+ * Operações curtas demais para o relógio (ler o relógio custa dezenas de
+ * nanossegundos) são medidas por amostragem, com SampledTimer.
+ */
+class Statistics {
+public:
+    enum Phase {
+        DIRECTORY_WALK,
+        FILE_READ,
+        TOKENIZE,
+        DICTIONARY_INSERT,
+        PARTIAL_MERGE,
+        FREEZE,
+        RUN_WRITE,
+        RUN_MERGE,
+        SERIALIZE,
+        DESERIALIZE,
+        NORMALIZE,
+        POSTINGS_LOOKUP,
+        INTERSECT,
+        UNION,
+        DIFFERENCE,
+        SCORING,
+        FILE_NAMES,
+        SNIPPETS,
+        PHASE_COUNT
+    };
+
+    enum Counter {
+        FILES,
+        BYTES_READ,
+        TOKENS,
+        RUNS,
+        POSTINGS_INPUT,
+        POSTINGS_SCORED,
+        POSTINGS_SKIPPED,
+        SNIPPET_BYTES,
+        COUNTER_COUNT
+    };
+
+private:
+    struct Name {
+        const char* key;
+        const char* label;
+    };
+
+    static constexpr array<Name, PHASE_COUNT> PHASE_NAMES = {{
+        {"percurso_diretorio", "percurso do diretório"},
+        {"leitura_arquivos", "leitura dos arquivos"},
+        {"tokenizacao", "tokenização (com a inserção)"},
+        {"insercao_dicionario", "  inserção no dicionário (amostrada)"},
+        {"uniao_parciais", "união dos dicionários parciais"},
+        {"congelamento", "congelamento"},
+        {"gravacao_partes", "gravação das partes (construir --memoria)"},
+        {"intercalacao_partes", "intercalação das partes"},
+        {"serializacao", "serialização"},
+        {"desserializacao", "abertura do índice"},
+        {"normalizacao", "normalização dos termos"},
+        {"leitura_postings", "leitura das postings"},
+        {"intersecao", "interseção (por passo)"},
+        {"uniao", "união"},
+        {"diferenca", "diferença"},
+        {"pontuacao", "pontuação BM25"},
+        {"nomes_arquivos", "resolução dos nomes dos arquivos"},
+        {"trechos", "geração dos trechos"},
+    }};
+
+    static constexpr array<Name, COUNTER_COUNT> COUNTER_NAMES = {{
+        {"arquivos", "arquivos lidos"},
+        {"bytes_lidos", "bytes lidos"},
+        {"tokens", "tokens indexados"},
+        {"partes", "partes gravadas (construir --memoria)"},
+        {"postings_entrada", "postings nas entradas (interseção, união, diferença)"},
+        {"postings_pontuadas", "postings pontuadas (BM25)"},
+        {"postings_puladas", "postings não decodificadas (blocos pulados nas buscas ranqueadas)"},
+        {"bytes_trechos", "bytes lidos para os trechos"},
+    }};
+
+    static inline bool active = false;
+    // Início da medição e custo de uma leitura do relógio
+    static inline uint64_t startTime = 0;
+    static inline uint64_t clockCost = 0;
+    static inline array<atomic<uint64_t>, PHASE_COUNT> phaseNanos{};
+    static inline array<atomic<uint64_t>, PHASE_COUNT> phaseCalls{};
+    static inline array<atomic<uint64_t>, COUNTER_COUNT> counters{};
+
+public:
+    /**
+     * Liga a instrumentação; deve ser chamado antes de criar as threads.
+     */
+    static void enable() {
+        active = true;
+        // Mediana do intervalo entre duas leituras seguidas do relógio
+        array<uint64_t, 1001> intervals;
+        for (uint64_t& interval : intervals) {
+            uint64_t first = now();
+            interval = now() - first;
+        }
+        nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+        clockCost = intervals[intervals.size() / 2];
+        startTime = now();
+    }
+
+    static bool enabled() {
+        return active;
+    }
+
+    /**
+     * Relógio monotônico, em nanossegundos.
+     */
+    static uint64_t now() {
+        return static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * Custo estimado de uma leitura do relógio, em nanossegundos.
+     */
+    static uint64_t clockOverhead() {
+        return clockCost;
+    }
+
+    static void addTime(Phase phase, uint64_t nanos, uint64_t calls = 1) {
+        phaseNanos[phase].fetch_add(nanos, memory_order_relaxed);
+        phaseCalls[phase].fetch_add(calls, memory_order_relaxed);
+    }
+
+    /**
+     * Soma value ao contador (só com a instrumentação ligada).
+     */
+    static void add(Counter counter, uint64_t value) {
+        if (active) {
+            counters[counter].fetch_add(value, memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Valor atual do contador.
+     */
+    static uint64_t value(Counter counter) {
+        return counters[counter].load(memory_order_relaxed);
+    }
+
+    /**
+     * Pico de memória residente do processo, em bytes.
+     */
+    static size_t peakResidentBytes() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+
+    /**
+     * Escreve o relatório: fases com pelo menos uma chamada, contadores não
+     * nulos, vazões derivadas, pico de memória e a memória aproximada de cada
+     * estrutura do índice (memory, que pode ser vazia). Com json, um único
+     * objeto JSON em uma linha.
+     */
+    static void report(ostream& out, bool json, const vector<MemoryItem>& memory) {
+        double elapsed = (now() - startTime) / 1e9;
+        double tokenizeSeconds = phaseNanos[TOKENIZE] / 1e9;
+        double readSeconds = phaseNanos[FILE_READ] / 1e9;
+        uint64_t tokens = counters[TOKENS];
+        uint64_t bytes = counters[BYTES_READ];
+        size_t indexBytes = 0;
+        for (const MemoryItem& item : memory) {
+            indexBytes += item.bytes;
+        }
+
+        ios::fmtflags flags = out.flags();
+        streamsize precision = out.precision();
+        out << fixed;
+        if (json) {
+            out << setprecision(6) << "{\"tempo_total_s\":" << elapsed << ",\"fases\":{";
+            const char* separator = "";
+            for (size_t p = 0; p < PHASE_COUNT; ++p) {
+                if (phaseCalls[p] > 0) {
+                    out << separator << "\"" << PHASE_NAMES[p].key << "\":{\"segundos\":" << phaseNanos[p] / 1e9
+                        << ",\"chamadas\":" << phaseCalls[p] << "}";
+                    separator = ",";
+                }
+            }
+            out << "},\"contadores\":{";
+            separator = "";
+            for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+                if (counters[c] > 0) {
+                    out << separator << "\"" << COUNTER_NAMES[c].key << "\":" << counters[c];
+                    separator = ",";
+                }
+            }
+            if (tokens > 0 && tokenizeSeconds > 0) {
+                out << separator << "\"tokens_por_segundo\":" << setprecision(0) << tokens / tokenizeSeconds;
+                separator = ",";
+            }
+            if (bytes > 0 && readSeconds > 0) {
+                out << separator << "\"bytes_lidos_por_segundo\":" << setprecision(0) << bytes / readSeconds;
+            }
+            out << "},\"memoria\":{\"pico_rss_bytes\":" << peakResidentBytes();
+            if (!memory.empty()) {
+                out << ",\"indice\":{";
+                for (const MemoryItem& item : memory) {
+                    out << "\"" << item.key << "\":" << item.bytes << ",";
+                }
+                out << "\"total\":" << indexBytes << "}";
+            }
+            out << "}}\n";
+        } else {
+            out << setprecision(3) << "Estatísticas (tempo total " << elapsed * 1e3 << " ms):\n";
+            out << "  Fases (tempo somado das threads, chamadas):\n";
+            for (size_t p = 0; p < PHASE_COUNT; ++p) {
+                if (phaseCalls[p] > 0) {
+                    out << "    " << padded(PHASE_NAMES[p].label, 40) << setw(10) << phaseNanos[p] / 1e6 << " ms" << setw(12) << phaseCalls[p] << "\n";
+                }
+            }
+            if (any_of(counters.begin(), counters.end(), [](const atomic<uint64_t>& value) { return value > 0; })) {
+                out << "  Contadores:\n";
+            }
+            for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+                if (counters[c] > 0) {
+                    out << "    " << COUNTER_NAMES[c].label << ": " << counters[c] << "\n";
+                }
+            }
+            if (tokens > 0 && tokenizeSeconds > 0) {
+                out << "    tokens/s (por thread): " << setprecision(0) << tokens / tokenizeSeconds << "\n";
+            }
+            if (bytes > 0 && readSeconds > 0) {
+                out << "    leitura (por thread): " << setprecision(1) << bytes / readSeconds / (1 << 20)
+                    << " MB/s\n";
+            }
+            out << "  Memória:\n";
+            out << "    pico de memória residente: " << (peakResidentBytes() + 1023) / 1024 << " KB\n";
+            if (!memory.empty()) {
+                out << "    índice (aproximada): " << (indexBytes + 1023) / 1024 << " KB\n";
+                for (const MemoryItem& item : memory) {
+                    out << "      " << item.label << ": " << (item.bytes + 1023) / 1024 << " KB\n";
+                }
+            }
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    /**
+     * Completa o texto UTF-8 com espaços até width caracteres (setw conta bytes).
+     */
+    static string padded(const string& text, size_t width) {
+        size_t characters = count_if(text.begin(), text.end(), [](char c) {
+            return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+        });
+        return text + string(width > characters ? width - characters : 0, ' ');
+    }
+};
+
+/**
+ * Mede o tempo de uma fase do construtor ao destrutor (se a instrumentação
+ * estiver ligada).
+ */
+class ScopedTimer {
+private:
+    Statistics::Phase phase;
+    // 0 com a instrumentação desligada
+    uint64_t start;
+
+public:
+    explicit ScopedTimer(Statistics::Phase timedPhase)
+        : phase(timedPhase), start(Statistics::enabled() ? Statistics::now() : 0) {}
+
+    ~ScopedTimer() {
+        if (start != 0) {
+            Statistics::addTime(phase, Statistics::now() - start);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+/**
+ * Mede por amostragem uma operação chamada muitas vezes (ex.: a inserção de
+ * cada palavra no dicionário): uma em cada SAMPLE_RATE chamadas é
+ * cronometrada, descontado o custo do relógio, e o total estimado (média das
+ * amostras vezes as chamadas) é somado à fase no destrutor. Amostras acima de
+ * OUTLIER_NANOS (a thread perdeu o processador ou houve uma falta de página)
+ * são descartadas, pois cada uma pesaria SAMPLE_RATE vezes. Guarda os totais
+ * localmente, então deve haver um por thread.
+ */
+class SampledTimer {
+public:
+    static constexpr uint64_t SAMPLE_RATE = 64;
+    static constexpr uint64_t OUTLIER_NANOS = 50000;
+
+private:
+    Statistics::Phase phase;
+    bool active;
+    uint64_t calls;
+    uint64_t samples;
+    uint64_t sampledNanos;
+
+public:
+    explicit SampledTimer(Statistics::Phase timedPhase)
+        : phase(timedPhase), active(Statistics::enabled()), calls(0), samples(0), sampledNanos(0) {}
+
+    ~SampledTimer() {
+        if (calls > 0) {
+            uint64_t estimate = samples > 0 ? static_cast<uint64_t>(static_cast<double>(sampledNanos) / samples * calls) : 0;
+            Statistics::addTime(phase, estimate, calls);
+        }
+    }
+
+    SampledTimer(const SampledTimer&) = delete;
+    SampledTimer& operator=(const SampledTimer&) = delete;
+
+    /**
+     * Executa function() e retorna o seu resultado.
+     */
+    template <typename Function>
+    decltype(auto) measure(Function function) {
+        if (!active || ++calls % SAMPLE_RATE != 0) {
+            return function();
+        }
+        uint64_t start = Statistics::now();
+        if constexpr (is_void_v<decltype(function())>) {
+            function();
+            sample(start);
+        } else {
+            decltype(auto) result = function();
+            sample(start);
+            return result;
+        }
+    }
+
+    /**
+     * Quantidade de chamadas medidas (com a instrumentação ligada).
+     */
+    uint64_t count() const {
+        return calls;
+    }
+
+private:
+    void sample(uint64_t start) {
+        uint64_t elapsed = Statistics::now() - start;
+        if (elapsed > OUTLIER_NANOS) {
+            return;
+        }
+        sampledNanos += elapsed > Statistics::clockOverhead() ? elapsed - Statistics::clockOverhead() : 0;
+        ++samples;
+    }
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef STOPWORDS_HPP
+#define STOPWORDS_HPP
+
+#include "defaultStopWords.hpp"
+#include <string>
+#include <string_view>
+#include <array>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * Conjunto fixo de palavras com hash perfeito mínimo, montado em tempo de
+ * compilação (hash-and-displace). Cada palavra é resumida em uma assinatura
+ * de dois inteiros de 64 bits e o tamanho (ver signatureOf), que a identifica
+ * sozinha quando tem até 16 bytes; o hash da assinatura escolhe um balde e o
+ * deslocamento do balde, mais o hash, escolhe a posição da palavra em uma
+ * tabela com exatamente Count posições, sem colisões. A consulta custa duas
+ * leituras da palavra, algumas operações inteiras e a comparação da
+ * assinatura guardada naquela posição (mais um memcmp só para palavras
+ * maiores que 16 bytes).
+ *
+ * Os deslocamentos são escolhidos dos baldes maiores para os menores, o
+ * primeiro que leva todas as palavras do balde a posições livres. Se algum
+ * balde não couber, a construção lança uma exceção, o que em um contexto
+ * constexpr é erro de compilação.
+ */
+template <size_t Count>
+class PerfectWordSet {
+private:
+    // Cerca de duas palavras por balde
+    static constexpr size_t BUCKETS = Count / 2 + 1;
+    // Palavras até este tamanho são identificadas pela assinatura
+    static constexpr size_t SIGNATURE_BYTES = 16;
+
+    struct Signature {
+        uint64_t first = 0;
+        uint64_t last = 0;
+        size_t length = 0;
+    };
+
+    // Assinatura e texto da palavra de cada posição
+    array<Signature, Count> signatures{};
+    array<string_view, Count> slots{};
+    // Deslocamento de cada balde
+    array<uint16_t, BUCKETS> displacements{};
+    // Tamanho da maior palavra (as maiores são rejeitadas sem calcular o hash)
+    size_t longest = 0;
+
+public:
+    /**
+     * Monta a tabela; as palavras não podem ter repetições.
+     */
+    constexpr explicit PerfectWordSet(const array<string_view, Count>& words) {
+        array<uint64_t, Count> hashes{};
+        array<size_t, BUCKETS> sizes{};
+        size_t largest = 0;
+        for (size_t i = 0; i < Count; ++i) {
+            hashes[i] = hash(signatureOf<false>(words[i]));
+            size_t bucket = bucketOf(hashes[i]);
+            largest = max(largest, ++sizes[bucket]);
+            longest = max(longest, words[i].size());
+        }
+
+        array<bool, Count> used{};
+        array<size_t, Count> members{};
+        for (size_t size = largest; size >= 1; --size) {
+            for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+                if (sizes[bucket] != size) {
+                    continue;
+                }
+                size_t found = 0;
+                for (size_t i = 0; i < Count; ++i) {
+                    if (bucketOf(hashes[i]) == bucket) {
+                        members[found++] = i;
+                    }
+                }
+                uint32_t displacement = 0;
+                while (!fits(hashes, members, size, displacement, used)) {
+                    if (++displacement > UINT16_MAX) {
+                        throw "PerfectWordSet: nenhum deslocamento serve para um balde";
+                    }
+                }
+                displacements[bucket] = static_cast<uint16_t>(displacement);
+                for (size_t k = 0; k < size; ++k) {
+                    size_t slot = slotOf(hashes[members[k]], displacement);
+                    used[slot] = true;
+                    signatures[slot] = signatureOf<false>(words[members[k]]);
+                    slots[slot] = words[members[k]];
+                }
+            }
+        }
+    }
+
+    /**
+     * Verifica se a palavra pertence ao conjunto.
+     */
+    bool contains(string_view word) const {
+        if (word.size() > longest) {
+            return false;
+        }
+        Signature signature = signatureOf<true>(word);
+        uint64_t h = hash(signature);
+        size_t slot = slotOf(h, displacements[bucketOf(h)]);
+        const Signature& stored = signatures[slot];
+        if (stored.first != signature.first || stored.last != signature.last || stored.length != signature.length) {
+            return false;
+        }
+        return word.size() <= SIGNATURE_BYTES || slots[slot] == word;
+    }
+
+    /**
+     * Quantidade de palavras.
+     */
+    static constexpr size_t size() {
+        return Count;
+    }
+
+private:
+    /**
+     * Resume a palavra sem laço sobre os bytes: com 8 bytes ou mais, os 8
+     * primeiros e os 8 últimos; de 4 a 7 bytes, os 4 primeiros e os 4 últimos;
+     * menores, o primeiro, o do meio e o último. Runtime escolhe a leitura dos
+     * bytes (ver load); o resultado é o mesmo.
+     */
+    template <bool Runtime>
+    static constexpr Signature signatureOf(string_view word) {
+        Signature signature;
+        size_t n = word.size();
+        signature.length = n;
+        if (n >= 8) {
+            signature.first = load<Runtime>(word, 0, 8);
+            signature.last = load<Runtime>(word, n - 8, 8);
+        } else if (n >= 4) {
+            signature.first = load<Runtime>(word, 0, 4);
+            signature.last = load<Runtime>(word, n - 4, 4);
+        } else if (n > 0) {
+            signature.first = load<Runtime>(word, 0, 1) | load<Runtime>(word, n / 2, 1) << 8 |
+                              load<Runtime>(word, n - 1, 1) << 16;
+        }
+        return signature;
+    }
+
+    /**
+     * Lê bytes (até 8) da palavra a partir de start, como um inteiro
+     * little-endian. Fora da compilação (Runtime), em máquinas little-endian,
+     * 4 ou 8 bytes são lidos de uma vez com memcpy, que não vale em constexpr.
+     */
+    template <bool Runtime>
+    static constexpr uint64_t load(string_view word, size_t start, size_t bytes) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if constexpr (Runtime) {
+            if (bytes == 8) {
+                uint64_t value;
+                memcpy(&value, word.data() + start, 8);
+                return value;
+            }
+            if (bytes == 4) {
+                uint32_t value;
+                memcpy(&value, word.data() + start, 4);
+                return value;
+            }
+        }
+#endif
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(word[start + i])) << (8 * i);
+        }
+        return value;
+    }
+
+    static constexpr uint64_t hash(const Signature& signature) {
+        uint64_t h = (signature.first * 0x9E3779B97F4A7C15ULL) ^ (signature.last + signature.length);
+        return h * 0xFF51AFD7ED558CCDULL;
+    }
+
+    /**
+     * Balde de uma palavra com hash h: os 32 bits altos levados a [0, BUCKETS)
+     * com uma multiplicação em vez de módulo.
+     */
+    static constexpr size_t bucketOf(uint64_t h) {
+        return static_cast<size_t>(((h >> 32) * BUCKETS) >> 32);
+    }
+
+    /**
+     * Posição de uma palavra com hash h em um balde com o deslocamento dado.
+     */
+    static constexpr size_t slotOf(uint64_t h, uint32_t displacement) {
+        uint64_t x = (h ^ (displacement * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+        return static_cast<size_t>(((x >> 32) * Count) >> 32);
+    }
+
+    /**
+     * Indica se, com o deslocamento, as palavras do balde caem em posições
+     * livres e distintas.
+     */
+    static constexpr bool fits(const array<uint64_t, Count>& hashes, const array<size_t, Count>& members,
+                               size_t size, uint32_t displacement, const array<bool, Count>& used) {
+        for (size_t k = 0; k < size; ++k) {
+            size_t slot = slotOf(hashes[members[k]], displacement);
+            if (used[slot]) {
+                return false;
+            }
+            for (size_t other = 0; other < k; ++other) {
+                if (slotOf(hashes[members[other]], displacement) == slot) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * Stop words usadas pelo TextProcessor: por padrão, a lista embutida no
+ * executável (gerada de data/stopwords.txt na compilação, ver o Makefile),
+ * consultada pelo hash perfeito; replace troca por uma lista carregada em
+ * tempo de execução, guardada em um unordered_set.
+ */
+class StopWords {
+private:
+    // Lista padrão, montada em tempo de compilação
+    static constexpr PerfectWordSet<DEFAULT_STOP_WORDS.size()> defaults{DEFAULT_STOP_WORDS};
+
+    // Lista carregada em tempo de execução (usada quando custom é true)
+    unordered_set<string> words;
+    bool custom = false;
+
+public:
+    /**
+     * Verifica se a palavra (já normalizada) é uma stop word.
+     */
+    bool contains(const string& word) const {
+        if (!custom) {
+            return defaults.contains(word);
+        }
+        return words.find(word) != words.end();
+    }
+
+    /**
+     * Troca a lista padrão pelas palavras informadas (já normalizadas).
+     */
+    void replace(vector<string> normalizedWords) {
+        words.clear();
+        for (string& word : normalizedWords) {
+            if (!word.empty()) {
+                words.insert(move(word));
+            }
+        }
+        custom = true;
+    }
+
+    /**
+     * Quantidade de stop words em uso.
+     */
+    size_t size() const {
+        return custom ? words.size() : defaults.size();
+    }
+};
+
+#endif
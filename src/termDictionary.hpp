@@ -0,0 +1,239 @@
+#ifndef TERMDICTIONARY_HPP
+#define TERMDICTIONARY_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * Dicionário de termos com IDs inteiros densos (0, 1, 2, ... na ordem de
+ * inserção). Os bytes de todos os termos ficam contíguos em uma arena, sem uma
+ * alocação por termo, e a busca é feita por uma tabela hash de endereçamento
+ * aberto (Robin Hood) indexada por string_view: cada posição guarda só o ID e
+ * 32 bits do hash do termo, então uma sondagem compara inteiros e só lê a
+ * arena quando os hashes coincidem.
+ *
+ * No Robin Hood, a inserção cede a posição ao termo que está mais longe da
+ * sua posição ideal; assim a busca por um termo ausente para assim que
+ * encontra um termo mais perto da posição ideal do que a sondagem atual.
+ *
+ * As string_view retornadas por term apontam para a arena e valem até a
+ * próxima inserção.
+ */
+class TermDictionary {
+public:
+    // Retornado por find quando o termo não está no dicionário
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+private:
+    struct Slot {
+        // ID do termo + 1 (0 indica posição vazia)
+        uint32_t entry;
+        uint32_t hash;
+    };
+
+    // Ocupação máxima da tabela: 7/8
+    static constexpr size_t LOAD_NUMERATOR = 7;
+    static constexpr size_t LOAD_DENOMINATOR = 8;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    // Bytes de todos os termos, concatenados
+    vector<char> arena;
+    // Início de cada termo na arena; offsets[id + 1] é o fim do termo id
+    vector<uint32_t> offsets;
+    // Tabela hash (tamanho potência de dois)
+    vector<Slot> slots;
+
+public:
+    TermDictionary() : offsets(1, 0) {}
+
+    /**
+     * Hash de 64 bits de um termo. Os 32 bits baixos escolhem a posição na
+     * tabela; os altos ficam livres para quem particiona os termos (ex.: as
+     * threads do Indexer) sem correlação com a posição.
+     */
+    static uint64_t hashOf(string_view term) {
+        const char* p = term.data();
+        size_t n = term.size();
+        uint64_t h = n * 0x9E3779B97F4A7C15ULL;
+        while (n >= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, p, 8);
+            h = (h ^ chunk) * 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 29;
+            p += 8;
+            n -= 8;
+        }
+        if (n >= 4) {
+            uint32_t first;
+            uint32_t last;
+            memcpy(&first, p, 4);
+            memcpy(&last, p + n - 4, 4);
+            h = (h ^ (static_cast<uint64_t>(first) << 32 | last)) * 0xFF51AFD7ED558CCDULL;
+        } else if (n > 0) {
+            uint64_t tail = static_cast<unsigned char>(p[0]) | static_cast<unsigned char>(p[n / 2]) << 8 |
+                            static_cast<unsigned char>(p[n - 1]) << 16;
+            h = (h ^ tail) * 0xFF51AFD7ED558CCDULL;
+        }
+        h ^= h >> 32;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        return h ^ (h >> 29);
+    }
+
+    /**
+     * Retorna o ID do termo, inserindo-o se ainda não existe (o ID novo é size()).
+     */
+    uint32_t intern(string_view term) {
+        return intern(term, hashOf(term));
+    }
+
+    /**
+     * Igual a intern(term), com o hash (hashOf) já calculado.
+     */
+    uint32_t intern(string_view term, uint64_t hash) {
+        uint32_t found = find(term, hash);
+        if (found != NOT_FOUND) {
+            return found;
+        }
+        if ((size() + 1) * LOAD_DENOMINATOR > slots.size() * LOAD_NUMERATOR) {
+            rehash(max(MIN_CAPACITY, slots.size() * 2));
+        }
+        if (arena.size() + term.size() > UINT32_MAX || size() + 1 >= UINT32_MAX) {
+            throw runtime_error("Dicionário de termos excede 4 GB ou 2^32 termos");
+        }
+        uint32_t id = static_cast<uint32_t>(size());
+        arena.insert(arena.end(), term.begin(), term.end());
+        offsets.push_back(static_cast<uint32_t>(arena.size()));
+        place({id + 1, static_cast<uint32_t>(hash)});
+        return id;
+    }
+
+    /**
+     * Retorna o ID do termo, ou NOT_FOUND.
+     */
+    uint32_t find(string_view term) const {
+        return find(term, hashOf(term));
+    }
+
+    /**
+     * Igual a find(term), com o hash (hashOf) já calculado.
+     */
+    uint32_t find(string_view term, uint64_t hash) const {
+        if (slots.empty()) {
+            return NOT_FOUND;
+        }
+        size_t mask = slots.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(hash);
+        size_t position = tag & mask;
+        for (size_t distance = 0;; ++distance) {
+            const Slot& slot = slots[position];
+            if (slot.entry == 0 || ((position - slot.hash) & mask) < distance) {
+                return NOT_FOUND;
+            }
+            if (slot.hash == tag && this->term(slot.entry - 1) == term) {
+                return slot.entry - 1;
+            }
+            position = (position + 1) & mask;
+        }
+    }
+
+    /**
+     * Retorna o termo de um ID (válido até a próxima inserção).
+     */
+    string_view term(uint32_t id) const {
+        return string_view(arena.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    /**
+     * Quantidade de termos.
+     */
+    size_t size() const {
+        return offsets.size() - 1;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * Soma dos tamanhos de todos os termos, em bytes.
+     */
+    size_t byteCount() const {
+        return arena.size();
+    }
+
+    /**
+     * Reserva espaço para count termos com bytes bytes no total.
+     */
+    void reserve(size_t count, size_t bytes) {
+        arena.reserve(bytes);
+        offsets.reserve(count + 1);
+        size_t capacity = MIN_CAPACITY;
+        while (count * LOAD_DENOMINATOR > capacity * LOAD_NUMERATOR) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    /**
+     * Remove todos os termos e libera a memória.
+     */
+    void clear() {
+        arena = vector<char>();
+        offsets.assign(1, 0);
+        offsets.shrink_to_fit();
+        slots = vector<Slot>();
+    }
+
+    /**
+     * Memória ocupada pelo dicionário, em bytes (capacidade dos vetores).
+     */
+    size_t memoryBytes() const {
+        return arena.capacity() + offsets.capacity() * sizeof(uint32_t) + slots.capacity() * sizeof(Slot);
+    }
+
+private:
+    /**
+     * Insere uma entrada que ainda não está na tabela, cedendo posições pelo
+     * critério Robin Hood.
+     */
+    void place(Slot incoming) {
+        size_t mask = slots.size() - 1;
+        size_t position = incoming.hash & mask;
+        size_t distance = 0;
+        while (slots[position].entry != 0) {
+            size_t resident = (position - slots[position].hash) & mask;
+            if (resident < distance) {
+                swap(incoming, slots[position]);
+                distance = resident;
+            }
+            position = (position + 1) & mask;
+            ++distance;
+        }
+        slots[position] = incoming;
+    }
+
+    /**
+     * Reconstrói a tabela com a capacidade informada (potência de dois).
+     */
+    void rehash(size_t capacity) {
+        vector<Slot> old = move(slots);
+        slots.assign(capacity, Slot{0, 0});
+        for (const Slot& slot : old) {
+            if (slot.entry != 0) {
+                place(slot);
+            }
+        }
+    }
+};
+
+#endif
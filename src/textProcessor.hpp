@@ -2,12 +2,13 @@
 #define TEXTPROCESSOR_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_set>
+#include <array>
+#include "stopWords.hpp"
+#include "wordNormalizer.hpp"
 #include <fstream>
-#include <sstream>
-#include <algorithm>
-#include <cctype>
+#include <cstdint>
 
 using namespace std;
 
@@ -17,15 +18,16 @@ using namespace std;
  */
 class TextProcessor {
 private:
-    // Conjunto de stop words (palavras comuns a serem ignoradas)
-    unordered_set<string> stopWords;
+    // Stop words (palavras comuns a serem ignoradas); por padrão, a lista embutida
+    StopWords stopWords;
 
 public:
     TextProcessor() = default;
     
     /**
-     * Carrega as stop words de um arquivo.
-     * Retorna true se o arquivo foi carregado com sucesso, false caso contrário.
+     * Troca a lista de stop words embutida pelas palavras de um arquivo.
+     * Retorna true se o arquivo foi carregado com sucesso, false caso contrário
+     * (e a lista em uso não muda).
      */
     bool loadStopWords(const string& filename) {
         ifstream file(filename);
@@ -33,15 +35,15 @@ public:
             return false;
         }
         
+        vector<string> words;
         string word;
         while (file >> word) {
-            // Normaliza as stop words (minúsculas, sem acentos)
-            string normalized = normalizeWord(word);
-            if (!normalized.empty()) {
-                stopWords.insert(normalized);
+            // Normaliza as stop words (minúsculas, sem acentos) como o tokenizador
+            for (string& normalized : normalizeTerms(word)) {
+                words.push_back(move(normalized));
             }
         }
-        file.close();
+        stopWords.replace(move(words));
         return true;
     }
     
@@ -51,190 +53,110 @@ public:
      * Retorna um vetor de palavras processadas.
      */
     vector<string> process(const string& text) const {
-        vector<string> tokens = tokenize(text);
         vector<string> result;
-        
-        for (const string& token : tokens) {
-            string normalized = normalizeWord(token);
-            if (!normalized.empty() && stopWords.find(normalized) == stopWords.end()) {
-                result.push_back(normalized);
-            }
-        }
-        
+        forEachToken(text, [&](const string& token) {
+            result.push_back(token);
+        });
         return result;
     }
 
     /**
-     * Normaliza uma palavra: remove pontuações, converte para minúsculas e remove acentos.
-     * Esta função é estática para ser usada também na normalização dos termos de busca.
+     * Percorre o texto uma única vez, separando as palavras por espaços e, no
+     * mesmo laço, removendo pontuações, convertendo para minúsculas e removendo
+     * acentos. Para cada palavra normalizada que não é stop word, chama
+     * callback(palavra).
+     *
+     * A palavra é entregue em um buffer reutilizado entre as chamadas (válido
+     * apenas durante o callback), então não há alocação por palavra depois que
+     * o buffer atinge o tamanho da maior palavra. O resultado é o mesmo de process().
      */
-    static string normalizeWord(const string& word) {
-        string result;
-        
-        // Remove pontuações
-        for (char c : word) {
-            if (!isPunctuation(c)) {
-                result += c;  
+    template <typename Callback>
+    void forEachToken(string_view text, Callback callback) const {
+        forEachPositionedToken(text, [&](const string& token, uint32_t) { callback(token); });
+    }
+
+    /**
+     * Igual a forEachToken, mas chama callback(palavra, posição), em que a posição
+     * é o índice da palavra no texto contando todas as palavras não vazias após a
+     * normalização, inclusive as stop words. Assim a distância entre duas palavras
+     * de uma frase é a mesma no documento e na consulta.
+     *
+     * Para textos lidos em partes (cortadas em espaços), position é a posição
+     * da primeira palavra desta parte; retorna a posição seguinte à última.
+     */
+    template <typename Callback>
+    uint32_t forEachPositionedToken(string_view text, Callback callback, uint32_t position = 0) const {
+        return forEachTokenSpan(text, [&](const string& token, uint32_t at, size_t, size_t) {
+            callback(token, at);
+        }, position);
+    }
+
+    /**
+     * Igual a forEachPositionedToken, mas chama callback(palavra, posição,
+     * início, fim), em que [início, fim) são os bytes da palavra original em
+     * text (com as pontuações coladas a ela, sem o separador).
+     */
+    template <typename Callback>
+    uint32_t forEachTokenSpan(string_view text, Callback callback, uint32_t position = 0) const {
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(text.data());
+        const unsigned char* p = begin;
+        const unsigned char* end = p + text.size();
+        string token;
+        token.reserve(64);
+
+        while (p < end) {
+            token.clear();
+            const unsigned char* start = p;
+            const unsigned char* wordEnd = WordNormalizer::foldWord(p, end, token);
+
+            if (token.empty()) {
+                continue;
             }
+            if (!stopWords.contains(token)) {
+                callback(static_cast<const string&>(token), position, static_cast<size_t>(start - begin),
+                         static_cast<size_t>(wordEnd - begin));
+            }
+            ++position;
         }
-        
-        // Converte para minúsculas e remove acentos
-        result = toLowerAndRemoveAccents(result);
-        
-        return result;
+        return position;
     }
 
     /**
-     * Verifica se uma palavra é uma stop word.
+     * Indica se o byte separa palavras (ver WordNormalizer::isSeparator).
      */
-    bool isStopWord(const string& word) const {
-        string normalized = normalizeWord(word);
-        return stopWords.find(normalized) != stopWords.end();
+    static bool isSeparator(unsigned char c) {
+        return WordNormalizer::isSeparator(c);
     }
 
-private:
     /**
-     * Verifica se um caractere é de pontuação ASCII.
+     * Normaliza um texto como o tokenizador, sem filtrar stop words (ver
+     * WordNormalizer::normalizeTerms).
      */
-    static bool isPunctuation(char c) {
-        return (c >= 33 && c <= 47) ||    // !"#$%&'()*+,-./
-               (c >= 58 && c <= 64) ||    // :;<=>?@
-               (c >= 91 && c <= 96) ||    // [\]^_`
-               (c >= 123 && c <= 126);    // {|}~
+    static vector<string> normalizeTerms(const string& text) {
+        return WordNormalizer::normalizeTerms(text);
     }
-    
+
     /**
-     * Converte uma string para minúsculas e remove acentos (UTF-8).
+     * Normaliza uma palavra dos termos de busca (ver WordNormalizer::normalizeWord).
      */
-    static string toLowerAndRemoveAccents(const string& str) {
-        string result;
-        
-        for (size_t i = 0; i < str.size(); i++) {
-            unsigned char c = str[i];
-            
-            // Verifica se é um caractere UTF-8 multibyte (inicia com 0xC3)
-            if (c == 0xC3 && i + 1 < str.size()) {
-                unsigned char next = str[i + 1];
-                
-                // Mapeia caracteres acentuados (maiúsculos e minúsculos) para sem acento
-                switch (next) {
-                    // Letras minúsculas acentuadas -> sem acento
-                    case 0xA1: // á
-                    case 0xA0: // à
-                    case 0xA2: // â
-                    case 0xA3: // ã
-                    case 0xA4: // ä
-                        result += 'a';
-                        i++;
-                        break;
-                    case 0xA9: // é
-                    case 0xA8: // è
-                    case 0xAA: // ê
-                    case 0xAB: // ë
-                        result += 'e';
-                        i++;
-                        break;
-                    case 0xAD: // í
-                    case 0xAC: // ì
-                    case 0xAE: // î
-                    case 0xAF: // ï
-                        result += 'i';
-                        i++;
-                        break;
-                    case 0xB3: // ó
-                    case 0xB2: // ò
-                    case 0xB4: // ô
-                    case 0xB5: // õ
-                    case 0xB6: // ö
-                        result += 'o';
-                        i++;
-                        break;
-                    case 0xBA: // ú
-                    case 0xB9: // ù
-                    case 0xBB: // û
-                    case 0xBC: // ü
-                        result += 'u';
-                        i++;
-                        break;
-                    case 0xA7: // ç
-                        result += 'c';
-                        i++;
-                        break;
-                    // Letras maiúsculas acentuadas -> sem acento
-                    case 0x81: // Á
-                    case 0x80: // À
-                    case 0x82: // Â
-                    case 0x83: // Ã
-                    case 0x84: // Ä
-                        result += 'a';
-                        i++;
-                        break;
-                    case 0x89: // É
-                    case 0x88: // È
-                    case 0x8A: // Ê
-                    case 0x8B: // Ë
-                        result += 'e';
-                        i++;
-                        break;
-                    case 0x8D: // Í
-                    case 0x8C: // Ì
-                    case 0x8E: // Î
-                    case 0x8F: // Ï
-                        result += 'i';
-                        i++;
-                        break;
-                    case 0x93: // Ó
-                    case 0x92: // Ò
-                    case 0x94: // Ô
-                    case 0x95: // Õ
-                    case 0x96: // Ö
-                        result += 'o';
-                        i++;
-                        break;
-                    case 0x9A: // Ú
-                    case 0x99: // Ù
-                    case 0x9B: // Û
-                    case 0x9C: // Ü
-                        result += 'u';
-                        i++;
-                        break;
-                    case 0x87: // Ç
-                        result += 'c';
-                        i++;
-                        break;
-                    default:
-                        // Se não for um caractere acentuado conhecido, mantém original
-                        result += static_cast<char>(c);
-                        break;
-                }
-            }
-            // Converte letras ASCII maiúsculas para minúsculas
-            else if (c >= 'A' && c <= 'Z') {
-                result += static_cast<char>(c + 32);
-            }
-            // Mantém outros caracteres (minúsculos, números, etc.)
-            else {
-                result += static_cast<char>(c);
-            }
-        }
-        
-        return result;
+    static string normalizeWord(const string& word) {
+        return WordNormalizer::normalizeWord(word);
     }
-    
+
     /**
-     * Tokeniza o texto em palavras (split por espaços).
+     * Indica se o texto tem algum separador de palavras (ver WordNormalizer::hasSeparator).
      */
-    vector<string> tokenize(const string& text) const {
-        vector<string> tokens;
-        istringstream iss(text);
-        string token;
-        
-        while (iss >> token) {
-            tokens.push_back(token);
-        }
-        
-        return tokens;
+    static bool hasSeparator(const string& text) {
+        return WordNormalizer::hasSeparator(text);
+    }
+
+    /**
+     * Verifica se uma palavra já normalizada (por normalizeWord ou pelo
+     * tokenizador) é uma stop word.
+     */
+    bool isStopWord(const string& word) const {
+        return stopWords.contains(word);
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,100 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+using namespace std;
+
+/**
+ * Conjunto fixo de threads que executa tarefas de uma fila compartilhada.
+ * O destrutor espera todas as tarefas já enviadas terminarem.
+ */
+class ThreadPool {
+private:
+    // Threads de trabalho
+    vector<thread> workers;
+    // Tarefas aguardando execução
+    queue<function<void()>> tasks;
+    // Protege a fila e a flag de encerramento
+    mutex queueMutex;
+    // Acorda as threads quando chega tarefa ou o conjunto é encerrado
+    condition_variable available;
+    // Indica que não haverá novas tarefas
+    bool stopping;
+
+public:
+    explicit ThreadPool(unsigned numThreads) : stopping(false) {
+        if (numThreads == 0) {
+            numThreads = 1;
+        }
+        for (unsigned i = 0; i < numThreads; ++i) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Enfileira uma tarefa e retorna um future com o seu resultado.
+     */
+    template <typename Function>
+    auto submit(Function function) -> future<decltype(function())> {
+        using Result = decltype(function());
+        auto task = make_shared<packaged_task<Result()>>(move(function));
+        future<Result> result = task->get_future();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            tasks.emplace([task]() { (*task)(); });
+        }
+        available.notify_one();
+        return result;
+    }
+
+    /**
+     * Retorna a quantidade de threads do conjunto.
+     */
+    size_t size() const {
+        return workers.size();
+    }
+
+private:
+    /**
+     * Laço de cada thread: executa tarefas até o encerramento com a fila vazia.
+     */
+    void workerLoop() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+
+#endif
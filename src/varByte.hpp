@@ -0,0 +1,47 @@
+#ifndef VARBYTE_HPP
+#define VARBYTE_HPP
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Codificação de inteiros sem sinal em tamanho variável (varint / VByte).
+ * Cada byte carrega 7 bits do valor; o bit mais alto indica que há mais bytes.
+ * Valores pequenos (como diferenças entre IDs consecutivos) ocupam um único byte.
+ */
+class VarByte {
+public:
+    /**
+     * Acrescenta a codificação do valor ao final de out.
+     */
+    static void encode(uint64_t value, string& out) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    /**
+     * Decodifica um valor a partir de p e avança p para o byte seguinte.
+     * Lança uma exceção se a codificação ultrapassar end (arquivo corrompido).
+     */
+    static uint64_t decode(const unsigned char*& p, const unsigned char* end) {
+        uint64_t value = 0;
+        unsigned shift = 0;
+        while (p < end && shift < 64) {
+            unsigned char byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+            shift += 7;
+        }
+        throw runtime_error("Codificação varint inválida ou truncada");
+    }
+};
+
+#endif
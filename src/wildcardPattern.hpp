@@ -0,0 +1,120 @@
+#ifndef WILDCARDPATTERN_HPP
+#define WILDCARDPATTERN_HPP
+
+#include "textProcessor.hpp"
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+/**
+ * Padrão de busca com curingas: '*' casa qualquer sequência (inclusive vazia)
+ * e '?' casa exatamente um caractere. Os trechos entre os curingas são
+ * normalizados como as palavras do índice (minúsculas, sem acentos nem
+ * pontuação).
+ *
+ * O prefixo literal (antes do primeiro curinga) delimita o intervalo do
+ * dicionário ordenado que precisa ser lido; o restante do padrão só filtra
+ * as palavras desse intervalo. Um padrão que começa com curinga percorre o
+ * dicionário inteiro.
+ */
+class WildcardPattern {
+private:
+    // Padrão normalizado
+    string pattern;
+    // Trecho antes do primeiro curinga
+    string literalPrefix;
+    // Indica se o padrão é só o prefixo seguido de '*' (dispensa o filtro)
+    bool prefixOnly;
+
+public:
+    explicit WildcardPattern(const string& text) : prefixOnly(false) {
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t wildcard = text.find_first_of("*?", start);
+            size_t stop = wildcard == string::npos ? text.size() : wildcard;
+            pattern += TextProcessor::normalizeWord(text.substr(start, stop - start));
+            if (wildcard == string::npos) {
+                break;
+            }
+            // "**" equivale a "*"
+            if (text[wildcard] == '?' || pattern.empty() || pattern.back() != '*') {
+                pattern += text[wildcard];
+            }
+            start = wildcard + 1;
+        }
+        literalPrefix = pattern.substr(0, pattern.find_first_of("*?"));
+        prefixOnly = pattern.size() == literalPrefix.size() + 1 && pattern.back() == '*';
+    }
+
+    /**
+     * Indica se o texto tem curingas.
+     */
+    static bool hasWildcard(const string& text) {
+        return text.find_first_of("*?") != string::npos;
+    }
+
+    /**
+     * Retorna o padrão normalizado.
+     */
+    const string& text() const {
+        return pattern;
+    }
+
+    /**
+     * Retorna o trecho literal antes do primeiro curinga.
+     */
+    const string& prefix() const {
+        return literalPrefix;
+    }
+
+    /**
+     * Verifica se a palavra casa com o padrão. '?' consome um caractere UTF-8
+     * inteiro. Em caso de falha, volta ao último '*' e tenta consumir mais um
+     * caractere com ele.
+     */
+    bool matches(string_view word) const {
+        if (prefixOnly) {
+            return word.compare(0, literalPrefix.size(), literalPrefix) == 0;
+        }
+        size_t p = 0;
+        size_t w = 0;
+        size_t starP = string::npos;
+        size_t starW = 0;
+        while (w < word.size()) {
+            if (p < pattern.size() && pattern[p] == '?') {
+                ++p;
+                w = nextCharacter(word, w);
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                starP = ++p;
+                starW = w;
+            } else if (p < pattern.size() && pattern[p] == word[w]) {
+                ++p;
+                ++w;
+            } else if (starP != string::npos) {
+                p = starP;
+                w = starW = nextCharacter(word, starW);
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+private:
+    /**
+     * Retorna o início do caractere UTF-8 seguinte ao que começa em i.
+     */
+    static size_t nextCharacter(string_view word, size_t i) {
+        ++i;
+        while (i < word.size() && (static_cast<unsigned char>(word[i]) & 0xC0) == 0x80) {
+            ++i;
+        }
+        return i;
+    }
+};
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef WORDNORMALIZER_HPP
+#define WORDNORMALIZER_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/**
+ * Normalização das palavras: separa o texto em palavras, remove pontuações,
+ * converte para minúsculas e remove acentos. É usada pelo tokenizador
+ * (TextProcessor), pela normalização dos termos de busca e pelo gerador da
+ * lista de stop words embutida (tools/stopWordsGenerator), que por isso não
+ * pode depender dessa lista: este arquivo não inclui stopWords.hpp.
+ */
+class WordNormalizer {
+public:
+    /**
+     * Indica se o byte separa palavras (espaço ASCII). Um texto cortado logo
+     * depois de um separador não divide nenhuma palavra nem caractere UTF-8.
+     */
+    static bool isSeparator(unsigned char c) {
+        return charClass()[c] == SPACE;
+    }
+
+    /**
+     * Normaliza um texto exatamente como o tokenizador, mas sem filtrar stop
+     * words: retorna as palavras, na ordem. Um termo de busca com separadores
+     * no meio (espaços, travessões, espaço não separável) vira várias
+     * palavras, como no texto indexado.
+     */
+    static vector<string> normalizeTerms(const string& text) {
+        vector<string> words;
+        string word;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+        const unsigned char* end = p + text.size();
+        while (p < end) {
+            word.clear();
+            foldWord(p, end, word);
+            if (!word.empty()) {
+                words.push_back(word);
+            }
+        }
+        return words;
+    }
+
+    /**
+     * Normaliza uma palavra: remove pontuações, converte para minúsculas e remove acentos.
+     * Esta função é estática para ser usada também na normalização dos termos de busca.
+     * Retorna uma string vazia se o texto não formar exatamente uma palavra do
+     * tokenizador (ver normalizeTerms): com separadores no meio, ele seria
+     * dividido na indexação, e a junção não existiria no índice.
+     */
+    static string normalizeWord(const string& word) {
+        vector<string> words = normalizeTerms(word);
+        return words.size() == 1 ? words[0] : string();
+    }
+
+    /**
+     * Indica se o texto tem algum separador de palavras do tokenizador
+     * (espaço, travessão, espaço não separável etc.).
+     */
+    static bool hasSeparator(const string& text) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+        const unsigned char* end = p + text.size();
+        string ignored;
+        while (p < end) {
+            // foldWord só para antes do fim do texto ao consumir um separador
+            if (foldWord(p, end, ignored) != p) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Normaliza os bytes a partir de p até o próximo separador (ou o fim),
+     * acrescentando o resultado a out: descarta pontuações, converte letras
+     * maiúsculas para minúsculas e troca letras acentuadas pela letra sem
+     * acento. Deixa p logo depois do separador e retorna onde o separador
+     * começa (o fim da palavra original). Trechos só de letras e dígitos
+     * ASCII são convertidos em blocos (asciiRun).
+     */
+    static const unsigned char* foldWord(const unsigned char*& p, const unsigned char* end, string& out) {
+        const array<unsigned char, 256>& classes = charClass();
+        while (p < end) {
+            size_t run = asciiRun(p, end, out);
+            p += run;
+            if (p == end) {
+                return p;
+            }
+            unsigned char c = *p;
+            switch (classes[c]) {
+                case REGULAR:
+                    out += static_cast<char>(c);
+                    ++p;
+                    break;
+                case UPPER:
+                    out += static_cast<char>(c + 32);
+                    ++p;
+                    break;
+                case PUNCTUATION:
+                    ++p;
+                    break;
+                case SPACE:
+                    return p++;
+                default: {
+                    uint32_t cp;
+                    size_t length = decodeUtf8(p, end, cp);
+                    if (length == 0) {
+                        out += static_cast<char>(c);
+                        ++p;
+                        break;
+                    }
+                    const char* letters = nullptr;
+                    switch (foldCodePoint(cp, letters)) {
+                        case SEPARATE: {
+                            const unsigned char* separator = p;
+                            p += length;
+                            return separator;
+                        }
+                        case STRIP:
+                            break;
+                        case LETTERS:
+                            out += letters[0];
+                            if (letters[1] != ' ') {
+                                out += letters[1];
+                            }
+                            break;
+                        case KEEP:
+                            out.append(reinterpret_cast<const char*>(p), length);
+                            break;
+                    }
+                    p += length;
+                    break;
+                }
+            }
+        }
+        return p;
+    }
+
+private:
+    // Classes de bytes usadas pelo tokenizador (bytes >= 0x80 são de caracteres UTF-8 multibyte)
+    enum CharClass : unsigned char { REGULAR = 0, SPACE = 1, PUNCTUATION = 2, UPPER = 3, MULTIBYTE = 4 };
+
+    /**
+     * Monta a tabela de classes: espaços (os mesmos de isspace no locale "C"),
+     * pontuações ASCII !"#$%&'()*+,-./ :;<=>?@ [\]^_` {|}~, maiúsculas ASCII e
+     * bytes não ASCII.
+     */
+    static constexpr array<unsigned char, 256> buildCharClass() {
+        array<unsigned char, 256> table = {};
+        const char spaces[] = " \t\n\v\f\r";
+        for (size_t i = 0; spaces[i] != '\0'; ++i) {
+            table[static_cast<unsigned char>(spaces[i])] = SPACE;
+        }
+        for (int c = 33; c <= 126; ++c) {
+            if ((c <= 47) || (c >= 58 && c <= 64) || (c >= 91 && c <= 96) || (c >= 123)) {
+                table[c] = PUNCTUATION;
+            }
+        }
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            table[c] = UPPER;
+        }
+        for (int c = 0x80; c <= 0xFF; ++c) {
+            table[c] = MULTIBYTE;
+        }
+        return table;
+    }
+
+    /**
+     * Tabela de classes dos bytes (calculada em tempo de compilação).
+     */
+    static const array<unsigned char, 256>& charClass() {
+        static constexpr array<unsigned char, 256> table = buildCharClass();
+        return table;
+    }
+
+    /**
+     * Tratamento de U+0080 a U+017F (Latin-1 Supplement e Latin Extended-A), dois
+     * caracteres por código: a letra ASCII minúscula sem acento (seguida de um
+     * espaço, ou de uma segunda letra: ß -> ss, æ -> ae, œ -> oe), ".." para
+     * pontuações e símbolos (removidos), "__" para espaços (separam palavras)
+     * e "==" para caracteres mantidos como estão (µ, ¼, ½, ¾).
+     * Gerada a partir da decomposição Unicode (NFKD) de cada letra; letras sem
+     * decomposição (ø, ł, đ, þ, ...) usam a transliteração usual.
+     */
+    static constexpr const char* LATIN_FOLD =
+        "..........__...................................................."  // U+0080
+        "__..................a ..............2 3 ..==......1 o ..======.."  // U+00A0
+        "a a a a a a aec e e e e i i i i d n o o o o o ..o u u u u y thss"  // U+00C0
+        "a a a a a a aec e e e e i i i i d n o o o o o ..o u u u u y thy "  // U+00E0
+        "a a a a a a c c c c c c c c d d d d e e e e e e e e e e g g g g "  // U+0100
+        "g g g g h h h h i i i i i i i i i i ijijj j k k k l l l l l l l "  // U+0120
+        "l l l n n n n n n n n n o o o o o o oeoer r r r r r s s s s s s "  // U+0140
+        "s s t t t t t t u u u u u u u u u u u u w w y y y z z z z z z s "; // U+0160
+
+    // Tratamento de um caractere não ASCII
+    enum Fold : unsigned char { KEEP, STRIP, SEPARATE, LETTERS };
+
+    /**
+     * Classifica o código cp. Para LETTERS, escreve em letters as letras que o
+     * substituem (a segunda é ' ' se for só uma).
+     * Fora das tabelas: espaços Unicode, travessões (‒ – — ―) e U+3000 separam
+     * palavras; o restante da pontuação geral (U+2000 a U+206F: aspas curvas,
+     * reticências, marcas invisíveis) e o BOM são removidos; os demais
+     * caracteres (outros alfabetos) são mantidos.
+     */
+    static Fold foldCodePoint(uint32_t cp, const char*& letters) {
+        if (cp < 0x180) {
+            letters = LATIN_FOLD + 2 * (cp - 0x80);
+            switch (letters[0]) {
+                case '.': return STRIP;
+                case '_': return SEPARATE;
+                case '=': return KEEP;
+                default: return LETTERS;
+            }
+        }
+        if (cp >= 0x2000 && cp <= 0x206F) {
+            bool space = cp <= 0x200A || cp == 0x2028 || cp == 0x2029 || cp == 0x202F || cp == 0x205F;
+            bool dash = cp >= 0x2012 && cp <= 0x2015;
+            return space || dash ? SEPARATE : STRIP;
+        }
+        if (cp == 0x3000) {
+            return SEPARATE;
+        }
+        return cp == 0xFEFF ? STRIP : KEEP;
+    }
+
+    /**
+     * Decodifica o caractere UTF-8 que começa em p. Retorna a quantidade de
+     * bytes, ou 0 se a sequência for inválida (o byte é então mantido como está).
+     */
+    static size_t decodeUtf8(const unsigned char* p, const unsigned char* end, uint32_t& cp) {
+        unsigned char lead = *p;
+        size_t length;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+            cp = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            cp = lead & 0x0F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            cp = lead & 0x07;
+        } else {
+            return 0;
+        }
+        if (static_cast<size_t>(end - p) < length) {
+            return 0;
+        }
+        for (size_t i = 1; i < length; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                return 0;
+            }
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        return length;
+    }
+
+    /**
+     * Converte para minúsculas o trecho inicial de [p, end) formado só por
+     * letras e dígitos ASCII, acrescentando-o a out, e retorna o tamanho do
+     * trecho. Com AVX2 (ou SSE2), examina 32 (ou 16) bytes por vez: x | 0x20
+     * leva as maiúsculas para as minúsculas, então duas comparações de
+     * intervalo acham as letras e outras duas os dígitos; o primeiro byte que
+     * não é nenhum dos dois encerra o trecho. Sem SIMD retorna 0 e o laço byte
+     * a byte de foldWord cuida de tudo.
+     */
+    static size_t asciiRun(const unsigned char* p, const unsigned char* end, string& out) {
+        size_t total = 0;
+#if defined(__AVX2__)
+        const __m256i caseBit = _mm256_set1_epi8(0x20);
+        while (end - p >= 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i folded = _mm256_or_si256(bytes, caseBit);
+            // Bytes >= 0x80 são negativos e ficam fora dos dois intervalos
+            __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                              _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+            __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('0' - 1)),
+                                             _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bytes));
+            uint32_t keep = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(letter, digit)));
+            __m256i lower = _mm256_or_si256(bytes, _mm256_and_si256(letter, caseBit));
+            alignas(32) char buffer[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(buffer), lower);
+            size_t length = keep == 0xFFFFFFFFu ? 32 : static_cast<size_t>(__builtin_ctz(~keep));
+            out.append(buffer, length);
+            total += length;
+            p += length;
+            if (length < 32) {
+                return total;
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+        while (end - p >= 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i folded = _mm_or_si128(bytes, caseBit);
+            // Bytes >= 0x80 são negativos e ficam fora dos dois intervalos
+            __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                                           _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+                                          _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)));
+            uint32_t keep = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(letter, digit)));
+            __m128i lower = _mm_or_si128(bytes, _mm_and_si128(letter, caseBit));
+            alignas(16) char buffer[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(buffer), lower);
+            size_t length = keep == 0xFFFFu ? 16 : static_cast<size_t>(__builtin_ctz(~keep));
+            out.append(buffer, length);
+            total += length;
+            p += length;
+            if (length < 16) {
+                return total;
+            }
+        }
+#else
+        (void)p;
+        (void)end;
+        (void)out;
+#endif
+        return total;
+    }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "src/queryCache.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+/*
+Teste do cache de consultas (LruCache e QueryCache):
+- com uma thread, confere a ordem LRU: a entrada lida por último sobrevive e a
+  menos recente sai quando o limite de memória é ultrapassado;
+- com várias threads e uma carga enviesada (poucas consultas muito repetidas
+  e muitas raras, como nos registros de busca), confere que cada valor lido é
+  o da sua chave, que acertos + faltas = leituras, que houve acertos, faltas e
+  remoções, e que a memória estimada nunca passa do limite.
+
+Uso: tests/queryCacheTest (retorna 1 se alguma verificação falhar)
+*/
+
+using namespace std;
+
+// Threads e leituras por thread da carga concorrente
+static const size_t THREADS = 8;
+static const size_t LOOKUPS = 20000;
+// Consultas distintas da carga
+static const size_t KEYS = 2000;
+
+/**
+ * Resultado esperado da consulta de número k.
+ */
+static QueryCache::FileList expected(size_t k) {
+    return {"doc" + to_string(k) + ".txt", "doc" + to_string(k + 1) + ".txt"};
+}
+
+int main() {
+    int failures = 0;
+
+    // Ordem LRU com uma thread: cabem duas entradas
+    LruCache<string> lru(2 * (LruCache<string>::ENTRY_OVERHEAD + 2 + 10) + 1);
+    lru.insert("a", make_shared<const string>("1"), 10);
+    lru.insert("b", make_shared<const string>("2"), 10);
+    lru.find("a");
+    lru.insert("c", make_shared<const string>("3"), 10);
+    if (!lru.find("a") || lru.find("b") || !lru.find("c") || lru.statistics().evictions != 1) {
+        cerr << "FALHA: a entrada menos recente não foi a removida\n";
+        ++failures;
+    }
+
+    // Carga concorrente enviesada, com limite menor que o conjunto de consultas
+    QueryCache cache(64 * 1024);
+    atomic<size_t> wrong(0);
+    atomic<size_t> overBudget(0);
+    vector<thread> threads;
+    for (size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t]() {
+            mt19937_64 random(t + 1);
+            // Metade das leituras vai para 1% das consultas
+            uniform_int_distribution<size_t> hot(0, KEYS / 100 - 1);
+            uniform_int_distribution<size_t> any(0, KEYS - 1);
+            for (size_t i = 0; i < LOOKUPS; ++i) {
+                size_t k = random() % 2 ? hot(random) : any(random);
+                string key = QueryCache::key({"palavra" + to_string(k), "outra"});
+                if (auto cached = cache.findResult(key)) {
+                    if (*cached != expected(k)) {
+                        ++wrong;
+                    }
+                } else {
+                    cache.storeResult(key, expected(k));
+                }
+                CacheStatistics statistics = cache.resultStatistics();
+                if (statistics.bytes > statistics.budget) {
+                    ++overBudget;
+                }
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+
+    CacheStatistics statistics = cache.resultStatistics();
+    if (wrong > 0) {
+        cerr << "FALHA: " << wrong << " leituras devolveram o valor de outra chave\n";
+        ++failures;
+    }
+    if (overBudget > 0) {
+        cerr << "FALHA: a memória estimada passou do limite " << overBudget << " vezes\n";
+        ++failures;
+    }
+    if (statistics.hits + statistics.misses != THREADS * LOOKUPS) {
+        cerr << "FALHA: acertos (" << statistics.hits << ") + faltas (" << statistics.misses
+             << ") diferente das leituras (" << THREADS * LOOKUPS << ")\n";
+        ++failures;
+    }
+    if (statistics.hits == 0 || statistics.misses == 0 || statistics.evictions == 0) {
+        cerr << "FALHA: esperados acertos, faltas e remoções; obtidos " << statistics.hits << ", "
+             << statistics.misses << " e " << statistics.evictions << "\n";
+        ++failures;
+    }
+
+    if (failures > 0) {
+        cerr << failures << " verificação(ões) falharam\n";
+        return 1;
+    }
+    cout << "queryCacheTest: " << THREADS << " threads, " << statistics.hits << " acertos, " << statistics.misses
+         << " faltas, " << statistics.evictions << " remoções, " << statistics.entries << " entradas\n";
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "src/queryServer.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+Teste do servidor de socket (QueryServer::serveSocket) com um índice pequeno
+em memória e duas threads:
+- abre mais conexões ociosas do que threads e confere que uma conexão nova
+  ainda recebe resposta (conexões ociosas não podem prender as threads);
+- envia várias consultas de uma vez pela mesma conexão e confere que todas
+  são respondidas;
+- "desligar" encerra o servidor depois que as conexões abertas fecham.
+
+Uso: tests/queryServerTest (retorna 1 se alguma verificação falhar)
+*/
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Threads do servidor e conexões ociosas abertas antes da consulta
+static const unsigned THREADS = 2;
+static const size_t IDLE = 4 * THREADS;
+// Tempo máximo de espera por uma resposta
+static const int TIMEOUT_MS = 5000;
+
+/**
+ * Conecta ao socket; tenta de novo enquanto o servidor ainda não escuta.
+ * Retorna -1 se não conseguir.
+ */
+static int connectTo(const string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+/**
+ * Envia as linhas e lê até receber count linhas "FIM".
+ * Retorna o texto recebido, ou o que chegou até o tempo máximo de espera.
+ */
+static string request(int fd, const string& lines, size_t count) {
+    if (send(fd, lines.data(), lines.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(lines.size())) {
+        return "";
+    }
+    string received;
+    char chunk[4096];
+    size_t found = 0;
+    while (found < count) {
+        pollfd readable = {fd, POLLIN, 0};
+        if (poll(&readable, 1, TIMEOUT_MS) <= 0) {
+            break;
+        }
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            break;
+        }
+        received.append(chunk, static_cast<size_t>(n));
+        found = 0;
+        for (size_t at = received.find("FIM "); at != string::npos; at = received.find("FIM ", at + 1)) {
+            if (at == 0 || received[at - 1] == '\n') {
+                ++found;
+            }
+        }
+    }
+    return received;
+}
+
+int main() {
+    int failures = 0;
+
+    Index index;
+    int first = index.addDocument("capitu.txt");
+    index.addWordToDocument("capitu", first);
+    index.addWordToDocument("olhos", first);
+    int second = index.addDocument("bentinho.txt");
+    index.addWordToDocument("bentinho", second);
+    index.addWordToDocument("olhos", second);
+    index.freeze();
+    TextProcessor textProcessor;
+    SearchEngine engine(index, textProcessor);
+
+    QueryServer server(engine, THREADS);
+    string path = (fs::temp_directory_path() / ("queryServerTest." + to_string(getpid()) + ".sock")).string();
+    thread serving([&]() { server.serveSocket(path); });
+
+    vector<int> idle;
+    for (size_t i = 0; i < IDLE; ++i) {
+        idle.push_back(connectTo(path));
+    }
+    int client = connectTo(path);
+    if (client < 0 || find(idle.begin(), idle.end(), -1) != idle.end()) {
+        cerr << "FALHA: não foi possível conectar ao servidor em " << path << "\n";
+        return 1;
+    }
+
+    string response = request(client, "capitu\n", 1);
+    if (response.find("capitu.txt") == string::npos || response.find("FIM ") == string::npos) {
+        cerr << "FALHA: com " << IDLE << " conexões ociosas e " << THREADS
+             << " threads, a consulta não foi respondida; recebido: '" << response << "'\n";
+        ++failures;
+    }
+
+    response = request(client, "capitu\nolhos\n\nbentinho\n", 3);
+    size_t capitu = response.find("capitu.txt");
+    size_t bentinho = response.rfind("bentinho.txt");
+    if (capitu == string::npos || bentinho == string::npos || capitu > bentinho) {
+        cerr << "FALHA: consultas enviadas juntas não foram respondidas em ordem; recebido: '" << response << "'\n";
+        ++failures;
+    }
+
+    request(client, "desligar\n", 0);
+    close(client);
+    for (int fd : idle) {
+        close(fd);
+    }
+    serving.join();
+
+    if (failures > 0) {
+        cerr << failures << " verificação(ões) falharam\n";
+        return 1;
+    }
+    cout << "queryServerTest: " << IDLE << " conexões ociosas, " << THREADS << " threads, consultas respondidas\n";
+    return 0;
+}
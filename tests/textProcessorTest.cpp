@@ -0,0 +1,85 @@
+#include "src/textProcessor.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+Teste da normalização dos termos de busca: cada texto passa pelo tokenizador
+da indexação (forEachToken) e pela normalização das buscas
+(TextProcessor::normalizeTerms sem as stop words), e as palavras dos dois
+caminhos precisam ser as mesmas. Os textos cobrem os separadores que não são
+espaços ASCII (travessões, espaço não separável, espaço ideográfico), que a
+normalização antiga juntava ("dom—casmurro" virava "domcasmurro", palavra que
+o índice nunca tem). Confere também que normalizeWord rejeita esses termos.
+
+Uso: tests/textProcessorTest (retorna 1 se alguma verificação falhar)
+*/
+
+using namespace std;
+
+static string join(const vector<string>& words) {
+    string text;
+    for (const string& word : words) {
+        text += (text.empty() ? "" : "|") + word;
+    }
+    return text;
+}
+
+int main() {
+    TextProcessor textProcessor;
+    int failures = 0;
+
+    const vector<string> texts = {
+        "Capitu",
+        "Dom Casmurro",
+        "dom—casmurro",
+        "dom–casmurro",
+        "dom casmurro",
+        "olhos　de ressaca",
+        "—Capitu!",
+        "Bentinho—",
+        "guarda-chuva",
+        "pão e água",
+        " — ",
+    };
+    for (const string& text : texts) {
+        vector<string> indexed;
+        textProcessor.forEachToken(text, [&](const string& token) {
+            indexed.push_back(token);
+        });
+        vector<string> searched;
+        for (const string& word : TextProcessor::normalizeTerms(text)) {
+            if (!textProcessor.isStopWord(word)) {
+                searched.push_back(word);
+            }
+        }
+        if (indexed != searched) {
+            cerr << "FALHA: '" << text << "': indexação [" << join(indexed) << "], busca [" << join(searched)
+                 << "]\n";
+            ++failures;
+        }
+    }
+
+    // normalizeWord só aceita textos que o tokenizador não divide
+    if (TextProcessor::normalizeWord("Capitu!") != "capitu") {
+        cerr << "FALHA: normalizeWord(\"Capitu!\")\n";
+        ++failures;
+    }
+    for (const string& text : {string("dom—casmurro"), string("dom casmurro")}) {
+        if (!TextProcessor::normalizeWord(text).empty() || !TextProcessor::hasSeparator(text)) {
+            cerr << "FALHA: '" << text << "' não foi rejeitado por normalizeWord\n";
+            ++failures;
+        }
+    }
+    if (TextProcessor::hasSeparator("guarda-chuva")) {
+        cerr << "FALHA: hasSeparator(\"guarda-chuva\")\n";
+        ++failures;
+    }
+
+    if (failures > 0) {
+        cerr << failures << " verificação(ões) falharam\n";
+        return 1;
+    }
+    cout << "textProcessorTest: " << texts.size() << " textos, normalização da busca igual à da indexação\n";
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "src/wordNormalizer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+Gera src/defaultStopWords.hpp, a lista de stop words embutida no executável:
+lê o arquivo de stop words (uma ou mais palavras por linha), normaliza as
+palavras como o tokenizador (WordNormalizer) e escreve a lista ordenada e sem
+repetições. O hash perfeito da lista é montado pelo compilador (PerfectWordSet).
+
+Chamado pelo Makefile quando o arquivo muda; o arquivo gerado não é versionado.
+Inclui só a normalização (wordNormalizer.hpp), e não o TextProcessor, que
+depende da lista gerada.
+
+Uso: tools/stopWordsGenerator <arquivo_de_stop_words> > src/defaultStopWords.hpp
+*/
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "Uso: tools/stopWordsGenerator <arquivo_de_stop_words>\n";
+        return 1;
+    }
+    ifstream file(argv[1]);
+    if (!file.is_open()) {
+        cerr << "Erro: Não foi possível abrir o arquivo " << argv[1] << "\n";
+        return 1;
+    }
+
+    vector<string> words;
+    for (string word; file >> word;) {
+        for (string& normalized : WordNormalizer::normalizeTerms(word)) {
+            words.push_back(move(normalized));
+        }
+    }
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+    if (words.empty()) {
+        cerr << "Erro: O arquivo " << argv[1] << " não tem stop words\n";
+        return 1;
+    }
+
+    cout << "// Gerado por tools/stopWordsGenerator a partir de " << argv[1] << "; não edite.\n";
+    cout << "#ifndef DEFAULTSTOPWORDS_HPP\n";
+    cout << "#define DEFAULTSTOPWORDS_HPP\n\n";
+    cout << "#include <array>\n";
+    cout << "#include <string_view>\n\n";
+    cout << "using namespace std;\n\n";
+    cout << "/**\n";
+    cout << " * Stop words padrão, normalizadas, ordenadas e sem repetições.\n";
+    cout << " */\n";
+    cout << "constexpr array<string_view, " << words.size() << "> DEFAULT_STOP_WORDS = {{\n";
+    string line = "   ";
+    for (size_t i = 0; i < words.size(); ++i) {
+        string item = " \"" + words[i] + "\"" + (i + 1 < words.size() ? "," : "");
+        if (line.size() + item.size() > 100) {
+            cout << line << "\n";
+            line = "   ";
+        }
+        line += item;
+    }
+    cout << line << "\n";
+    cout << "}};\n\n";
+    cout << "#endif\n";
+    return 0;
+}